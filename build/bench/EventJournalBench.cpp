@@ -0,0 +1,122 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  EventJournalBench.cpp
+ *  @brief Measure the per-update cost that EventJournal adds to a run shaped like NK.mabe.
+ *
+ *  Replays the signals EventJournal sees each update of settings/NK.mabe: 'pop_size' births
+ *  into next_pop (each with a random parent in main_pop), the death of every organism in
+ *  main_pop when MovePopulation empties it, and a swap for each organism moved back into
+ *  main_pop.  Each is handled exactly as EventJournal does (ID table lookups, EventFileWriter,
+ *  and blocks handed to an AsyncWriter).  Only this journaling work is timed; compare the
+ *  reported us_per_update with the time of an NK.mabe update (see journal_overhead.sh).
+ *
+ *  Usage: bench/EventJournalBench [POP_SIZE=1000] [UPDATES=1000] [COMPRESS=0] [FILENAME=bench_events.bin]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "emp/base/vector.hpp"
+
+#include "core/AsyncWriter.hpp"
+#include "tools/EventFile.hpp"
+
+int main(int argc, char * argv[]) {
+  const size_t pop_size = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  const size_t num_updates = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000;
+  const bool compress = (argc > 3) ? std::atoi(argv[3]) != 0 : false;
+  const std::string filename = (argc > 4) ? argv[4] : "bench_events.bin";
+
+  using Type = mabe::EventFileWriter::Type;
+  constexpr size_t MAIN_POP = 0;
+  constexpr size_t NEXT_POP = 1;
+
+  mabe::AsyncWriter async_writer;
+  mabe::EventFileWriter writer;
+  std::string out;
+  const int file_id = async_writer.Open(filename, false);
+  if (file_id < 0) {
+    std::cerr << "Unable to open '" << filename << "'." << std::endl;
+    return 1;
+  }
+  writer.SetCompress(compress);
+  writer.WriteHeader(out);
+  async_writer.Write((size_t) file_id, std::move(out));
+  out.clear();
+
+  emp::vector<emp::vector<uint64_t>> org_ids(2, emp::vector<uint64_t>(pop_size, 0));
+  uint64_t next_id = 1;
+  size_t update = 0;
+  size_t num_events = 0;
+
+  auto add_event = [&](Type type, uint64_t org_id, uint64_t parent_id, size_t pos, size_t pop_id) {
+    num_events++;
+    if (writer.AddEvent(type, update, org_id, parent_id, pos, pop_id)) {
+      writer.WriteBlock(out);
+      async_writer.Write((size_t) file_id, std::move(out));
+      out.clear();
+    }
+  };
+
+  // Inject the initial population.
+  for (size_t pos = 0; pos < pop_size; pos++) {
+    org_ids[MAIN_POP][pos] = next_id++;
+    add_event(Type::BIRTH, org_ids[MAIN_POP][pos], 0, pos, MAIN_POP);
+  }
+
+  // Parents are chosen before timing starts; selection is not part of the journal's cost.
+  std::mt19937_64 rng(1);
+  emp::vector<size_t> parents(pop_size);
+  double seconds = 0.0;
+
+  for (update = 1; update <= num_updates; update++) {
+    for (size_t & parent_pos : parents) parent_pos = rng() % pop_size;
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Births into next_pop (BeforePlacement + OnPlacement).
+    for (size_t pos = 0; pos < pop_size; pos++) {
+      const uint64_t parent_id = org_ids[MAIN_POP][parents[pos]];
+      const uint64_t org_id = next_id++;
+      org_ids[NEXT_POP][pos] = org_id;
+      add_event(Type::BIRTH, org_id, parent_id, pos, NEXT_POP);
+    }
+
+    // MovePopulation empties main_pop (BeforeDeath)...
+    for (size_t pos = 0; pos < pop_size; pos++) {
+      uint64_t & org_id = org_ids[MAIN_POP][pos];
+      add_event(Type::DEATH, org_id, 0, pos, MAIN_POP);
+      org_id = 0;
+    }
+
+    // ...and moves next_pop into it (OnSwap, with record_moves off).
+    for (size_t pos = 0; pos < pop_size; pos++) {
+      std::swap(org_ids[MAIN_POP][pos], org_ids[NEXT_POP][pos]);
+    }
+
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  }
+
+  // Time the final flush separately; it happens once per run (in BeforeExit).
+  const auto exit_start = std::chrono::steady_clock::now();
+  writer.WriteBlock(out);
+  if (out.size()) async_writer.Write((size_t) file_id, std::move(out));
+  const uint64_t file_size = async_writer.GetFilePos((size_t) file_id);
+  async_writer.Close((size_t) file_id);
+  async_writer.Stop();
+  const double exit_seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - exit_start).count();
+
+  std::cout << "pop_size=" << pop_size << " updates=" << num_updates << " compress=" << compress
+            << "\nevents=" << num_events << " file_mb=" << (double) file_size / 1048576.0
+            << "\ntotal_s=" << seconds << " exit_s=" << exit_seconds
+            << " ns_per_event=" << seconds * 1e9 / (double) (num_events - pop_size)
+            << " us_per_update=" << seconds * 1e6 / (double) num_updates << std::endl;
+}
@@ -0,0 +1,78 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  PairwiseDistanceBench.cpp
+ *  @brief Measure how long Systematics takes to compute pairwise phylogenetic distances.
+ *
+ *  Evolves a fixed-size population descended from one ancestor (as in SystematicsBench), in
+ *  which every birth founds a new taxon, so the number of active taxa equals 'pop_size'.  Then times
+ *  GetMeanPairwiseDistance() once after a tree change (which includes any index rebuild)
+ *  and once more on the unchanged tree, and GetPairwiseDistances() for all pairs.
+ *
+ *  Usage: bench/PairwiseDistanceBench [POP_SIZE=2000] [GENERATIONS=50] [SEED=1]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+
+#include "analyze/Systematics.hpp"
+
+template <typename FUN_T>
+double TimeMS(FUN_T && fun) {
+  const auto start_time = std::chrono::steady_clock::now();
+  fun();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+int main(int argc, char * argv[]) {
+  const size_t pop_size = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000;
+  const size_t generations = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 50;
+  const size_t seed = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 1;
+
+  using sys_t = emp::Systematics<uint64_t, uint64_t>;
+  using taxon_t = emp::Taxon<uint64_t>;
+  sys_t sys([](const uint64_t & genome){ return genome; }, true, true, false, false);
+
+  std::mt19937_64 rng(seed);
+  uint64_t next_genome = 0;
+  int update = 0;
+
+  // Start with the offspring of a single ancestor, so all taxa are in the same tree.
+  emp::vector<emp::Ptr<taxon_t>> taxa(pop_size);
+  for (size_t pos = 0; pos < pop_size; pos++) {
+    taxa[pos] = sys.AddOrg(next_genome++, -1, pos ? taxa[0] : nullptr, update);
+  }
+
+  for (size_t gen = 0; gen < generations * pop_size; gen++) {
+    const size_t parent_pos = rng() % pop_size;
+    const size_t victim_pos = rng() % pop_size;
+    emp::Ptr<taxon_t> taxon = sys.AddOrg(next_genome++, -1, taxa[parent_pos], update);
+    sys.RemoveOrg(taxa[victim_pos]);
+    taxa[victim_pos] = taxon;
+    if (gen % pop_size == pop_size - 1) {
+      sys.Update();
+      update++;
+    }
+  }
+
+  double mean = 0.0;
+  double mean_again = 0.0;
+  size_t num_pairs = 0;
+  const double mean_ms = TimeMS([&](){ mean = sys.GetMeanPairwiseDistance(); });
+  const double mean_again_ms = TimeMS([&](){ mean_again = sys.GetMeanPairwiseDistance(); });
+  const double all_ms = TimeMS([&](){ num_pairs = sys.GetPairwiseDistances().size(); });
+
+  std::cout << "pop_size=" << pop_size << " generations=" << generations
+            << "\nactive=" << sys.GetNumActive() << " ancestors=" << sys.GetNumAncestors()
+            << " mean_distance=" << mean << " (" << mean_again << ") pairs=" << num_pairs
+            << "\nmean_ms=" << mean_ms << " mean_again_ms=" << mean_again_ms
+            << " all_pairs_ms=" << all_ms << std::endl;
+}
@@ -0,0 +1,66 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  SimpleProgramVMBench.cpp
+ *  @brief Measure how many instructions per second SimpleProgramVM executes.
+ *
+ *  Decodes a set of random genomes (as SimpleProgramOrg would after mutation) and then runs
+ *  each of them from a reset VM for up to 'max_cycles' instructions, 'reps' times over.  Only
+ *  the Reset() and Run() calls are timed.  Build with -DMABE_NO_COMPUTED_GOTO (the
+ *  bench/SimpleProgramVMBench-switch target) to measure switch dispatch instead.
+ *
+ *  Usage: bench/SimpleProgramVMBench [NUM_PROGS=1000] [REPS=20] [MAX_CYCLES=5000] [SEED=1]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "emp/base/vector.hpp"
+
+#include "tools/SimpleProgramVM.hpp"
+
+int main(int argc, char * argv[]) {
+  const size_t num_progs = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  const size_t reps = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 20;
+  const size_t max_cycles = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : 5000;
+  const size_t seed = (argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 1;
+
+  using VM = mabe::SimpleProgramVM;
+  std::mt19937_64 rng(seed);
+
+  emp::vector<VM::program_t> progs(num_progs);
+  VM::genome_t genome;
+  for (VM::program_t & prog : progs) {
+    for (unsigned char & byte : genome) byte = (unsigned char) rng();
+    VM::Decode(genome, prog);
+  }
+
+  VM vm;
+  size_t num_insts = 0;
+  size_t num_halted = 0;
+  const auto start_time = std::chrono::steady_clock::now();
+  for (size_t rep = 0; rep < reps; rep++) {
+    for (const VM::program_t & prog : progs) {
+      vm.Reset();
+      num_insts += vm.Run(prog, max_cycles);
+      num_halted += vm.IsHalted();
+    }
+  }
+  const double seconds =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+#ifdef MABE_SPVM_COMPUTED_GOTO
+  const char * dispatch = "computed-goto";
+#else
+  const char * dispatch = "switch";
+#endif
+  std::cout << "dispatch=" << dispatch << " progs=" << num_progs << " reps=" << reps
+            << " max_cycles=" << max_cycles
+            << "\ninsts=" << num_insts << " halted=" << num_halted
+            << "\ntotal_s=" << seconds
+            << " M_inst_per_s=" << (double) num_insts / seconds / 1e6 << std::endl;
+}
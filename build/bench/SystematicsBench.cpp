@@ -0,0 +1,90 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  SystematicsBench.cpp
+ *  @brief Measure the per-birth cost of phylogeny tracking in Systematics.
+ *
+ *  Drives a Systematics manager the same way TrackSystematics does: a fixed-size population
+ *  in which each birth picks a random parent and a random victim, the offspring gets a new
+ *  taxon with probability 'mut_prob' (otherwise it joins its parent's), and the victim is
+ *  removed.  Update() is called once per 'pop_size' births, and unifurcations are collapsed
+ *  every 100 updates.  Only the Systematics calls are timed.  Set METRICS to 1 to also
+ *  maintain the balance indices and mean distinctiveness (SetTrackMetrics).
+ *
+ *  Usage: bench/SystematicsBench [POP_SIZE=1000] [BIRTHS=5000000] [MUT_PROB=0.1] [SEED=1] [METRICS=0]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+
+#include "analyze/Systematics.hpp"
+
+int main(int argc, char * argv[]) {
+  const size_t pop_size = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  const size_t num_births = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 5000000;
+  const double mut_prob = (argc > 3) ? std::strtod(argv[3], nullptr) : 0.1;
+  const size_t seed = (argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 1;
+  const bool metrics = (argc > 5) ? std::atoi(argv[5]) != 0 : false;
+
+  using sys_t = emp::Systematics<uint64_t, uint64_t>;
+  using taxon_t = emp::Taxon<uint64_t>;
+  sys_t sys([](const uint64_t & genome){ return genome; }, true, true, false, false);
+  sys.SetTrackMetrics(metrics);
+
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  uint64_t next_genome = 0;
+  int update = 0;
+
+  // Start the population as a single genotype.
+  emp::vector<emp::Ptr<taxon_t>> taxa(pop_size);
+  emp::vector<uint64_t> genomes(pop_size, next_genome++);
+  for (size_t pos = 0; pos < pop_size; pos++) {
+    taxa[pos] = sys.AddOrg(genomes[pos], -1, pos ? taxa[0] : nullptr, update);
+  }
+
+  // Random choices for each batch of births are made before timing starts, so that only
+  // the work done by Systematics (plus trivial bookkeeping) is measured.
+  struct Birth { size_t parent_pos; size_t victim_pos; bool mutate; };
+  emp::vector<Birth> batch(pop_size);
+  double seconds = 0.0;
+
+  for (size_t births = 0; births < num_births; births += batch.size()) {
+    batch.resize(std::min(pop_size, num_births - births));
+    for (Birth & birth : batch) {
+      birth.parent_pos = rng() % pop_size;
+      birth.victim_pos = rng() % pop_size;
+      birth.mutate = coin(rng) < mut_prob;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    for (const Birth & birth : batch) {
+      uint64_t genome = birth.mutate ? next_genome++ : genomes[birth.parent_pos];
+      emp::Ptr<taxon_t> taxon = sys.AddOrg(genome, -1, taxa[birth.parent_pos], update);
+      sys.RemoveOrg(taxa[birth.victim_pos]);
+      taxa[birth.victim_pos] = taxon;
+      genomes[birth.victim_pos] = genome;
+    }
+    sys.Update();
+    update++;
+    if (update % 100 == 0) sys.CollapseUnifurcations();
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  }
+
+  std::cout << "pop_size=" << pop_size << " births=" << num_births << " mut_prob=" << mut_prob
+            << " metrics=" << metrics
+            << "\nactive=" << sys.GetNumActive() << " ancestors=" << sys.GetNumAncestors()
+            << " outside=" << sys.GetNumOutside()
+            << " memory_kb=" << (double) sys.GetMemoryUse() / 1024.0
+            << "\ntotal_s=" << seconds
+            << " ns_per_birth=" << seconds * 1e9 / (double) num_births << std::endl;
+}
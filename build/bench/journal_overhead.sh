@@ -0,0 +1,52 @@
+#!/bin/bash
+# Time a MABE run with and without the EventJournal overlay and report the overhead.
+#
+# Usage (from the build directory, after 'make'):
+#   bench/journal_overhead.sh [CONFIG_FILE] [REPS] [EXTRA_SETTINGS...]
+#
+#   CONFIG_FILE    : Config file to run (default: settings/NK.mabe)
+#   REPS           : Number of runs of each variant; they alternate (default: 5)
+#   EXTRA_SETTINGS : Further -s settings for both variants, e.g. journal.compress=1
+#
+# Both variants use the same random seed.  The median wall-clock time of each is reported,
+# along with the journal's overhead relative to the plain run.
+
+CONFIG_FILE=${1:-settings/NK.mabe}
+REPS=${2:-5}
+shift $(( $# < 2 ? $# : 2 ))
+OVERLAY=settings/EventJournal.mabe
+
+SETTINGS=(-s "random_seed=1")
+for setting in "$@"; do
+  SETTINGS+=(-s "$setting")
+done
+
+if [ ! -x ./MABE ]; then
+  echo "Build MABE first (run 'make' in the build directory)."
+  exit 1
+fi
+
+run_timed() {
+  local start end
+  start=$(date +%s.%N)
+  ./MABE "$@" > /dev/null || { echo "MABE run failed: ./MABE $*" >&2; exit 1; }
+  end=$(date +%s.%N)
+  awk -v s="$start" -v e="$end" 'BEGIN { printf "%.3f\n", e - s }'
+}
+
+median() {
+  printf '%s\n' "$@" | sort -g | awk '{ v[NR] = $1 } END { print (NR % 2) ? v[(NR+1)/2] : (v[NR/2] + v[NR/2+1]) / 2 }'
+}
+
+BASE_TIMES=()
+JOURNAL_TIMES=()
+for (( i=0; i<REPS; i++ )); do
+  BASE_TIMES+=("$(run_timed -f "$CONFIG_FILE" "${SETTINGS[@]}")")
+  JOURNAL_TIMES+=("$(run_timed -f "$CONFIG_FILE" "$OVERLAY" "${SETTINGS[@]}")")
+done
+
+BASE=$(median "${BASE_TIMES[@]}")
+JOURNAL=$(median "${JOURNAL_TIMES[@]}")
+echo "without journal: ${BASE_TIMES[*]} (median $BASE s)"
+echo "with journal:    ${JOURNAL_TIMES[*]} (median $JOURNAL s)"
+awk -v b="$BASE" -v j="$JOURNAL" 'BEGIN { printf "overhead: %.2f%%\n", 100 * (j - b) / b }'
@@ -0,0 +1,44 @@
+#!/bin/bash
+# Launch several MABE worker processes locally that exchange migrants through a
+# ProcessMigration module (see source/schema/ProcessMigration.hpp).
+#
+# Usage: ./launch_islands.sh NUM_WORKERS CONFIG_FILE [MODULE_NAME] [BASE_SEED]
+#
+#   NUM_WORKERS : Number of worker processes to start.
+#   CONFIG_FILE : Config file that includes a ProcessMigration module.
+#   MODULE_NAME : Name given to the ProcessMigration module in the config (default: migrate)
+#   BASE_SEED   : Worker i uses random_seed = BASE_SEED + i (default: 1)
+#
+# Each worker writes its console output to worker_<i>.log and its migration statistics to
+# migration_<i>.csv.  The script waits for all workers and reports any that failed.
+
+if [ $# -lt 2 ]; then
+  echo "Usage: $0 NUM_WORKERS CONFIG_FILE [MODULE_NAME] [BASE_SEED]"
+  exit 1
+fi
+
+NUM_WORKERS=$1
+CONFIG_FILE=$2
+MODULE_NAME=${3:-migrate}
+BASE_SEED=${4:-1}
+
+PIDS=()
+for (( i=0; i<NUM_WORKERS; i++ )); do
+  ./MABE -f "$CONFIG_FILE" \
+    -s "random_seed=$((BASE_SEED + i))" \
+    -s "$MODULE_NAME.worker_id=$i" \
+    -s "$MODULE_NAME.num_workers=$NUM_WORKERS" \
+    -s "$MODULE_NAME.log_file=\"migration_$i.csv\"" \
+    > "worker_$i.log" 2>&1 &
+  PIDS+=($!)
+done
+
+STATUS=0
+for (( i=0; i<NUM_WORKERS; i++ )); do
+  if ! wait "${PIDS[$i]}"; then
+    echo "Worker $i (pid ${PIDS[$i]}) exited with an error; see worker_$i.log"
+    STATUS=1
+  fi
+done
+
+exit $STATUS
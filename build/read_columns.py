@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+# Read a binary column file written by FileOutput (format_type = "binary").
+#
+# File layout (version 1, little-endian; see source/tools/ColumnFile.hpp):
+#
+#   Header : char[8] "MABECOLS", uint32 version, uint32 column count,
+#            then for each column: uint32 type (0 = int64, 1 = double),
+#                                  uint32 name length, name bytes;
+#            zero padding to the next multiple of 8 bytes.
+#   Chunks : char[4] "CHNK", uint32 row count (R),
+#            then for each column in order: R values of 8 bytes each.
+#
+# Usage: ./read_columns.py FILE [--csv]
+#
+# As a module, read_columns(filename) returns a dict mapping each column name to a list of
+# values (or to a numpy array, if numpy is available).
+
+import struct
+import sys
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+TYPE_CODES = {0: 'q', 1: 'd'}
+NUMPY_TYPES = {0: '<i8', 1: '<f8'}
+
+
+def read_columns(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    magic, version, num_cols = struct.unpack_from('<8sII', data, 0)
+    if magic != b'MABECOLS':
+        raise ValueError(filename + ' is not a MABE column file.')
+    if version != 1:
+        raise ValueError('Unknown column file version %d.' % version)
+
+    pos = 16
+    names, types = [], []
+    for _ in range(num_cols):
+        col_type, name_size = struct.unpack_from('<II', data, pos)
+        pos += 8
+        names.append(data[pos:pos + name_size].decode())
+        types.append(col_type)
+        pos += name_size
+    pos += (8 - pos % 8) % 8
+
+    blocks = [[] for _ in names]
+    while pos < len(data):
+        tag, num_rows = struct.unpack_from('<4sI', data, pos)
+        if tag != b'CHNK':
+            raise ValueError('Corrupt chunk at byte %d.' % pos)
+        pos += 8
+        for i, col_type in enumerate(types):
+            if np is not None:
+                blocks[i].append(np.frombuffer(data, NUMPY_TYPES[col_type], num_rows, pos))
+            else:
+                blocks[i].extend(struct.unpack_from('<%d%s' % (num_rows, TYPE_CODES[col_type]), data, pos))
+            pos += 8 * num_rows
+
+    if np is not None:
+        return {name: (np.concatenate(block) if block else np.array([], NUMPY_TYPES[t]))
+                for name, t, block in zip(names, types, blocks)}
+    return dict(zip(names, blocks))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('Usage: %s FILE [--csv]' % sys.argv[0])
+        sys.exit(1)
+
+    columns = read_columns(sys.argv[1])
+    names = list(columns)
+    num_rows = len(columns[names[0]]) if names else 0
+
+    if '--csv' in sys.argv[2:]:
+        print(', '.join(names))
+        for row in range(num_rows):
+            print(', '.join(str(columns[name][row]) for name in names))
+    else:
+        print('%d columns, %d rows' % (len(names), num_rows))
+        for name in names:
+            print('  ' + name)
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+# Read a binary event journal written by the EventJournal module.
+#
+# File layout (version 1, little-endian; see source/tools/EventFile.hpp):
+#
+#   Header : char[8] "MABEEVNT", uint32 version, uint32 flags (bit 0 = compressed),
+#            uint32 record size (32), uint32 zero padding.
+#   Blocks : char[4] "EVBK", uint32 record count (R), uint64 payload size in bytes,
+#            then the payload.
+#
+#   Raw records are: uint64 update, uint64 org id, uint64 parent id, uint32 position,
+#   uint16 population id, uint8 event type, uint8 zero padding.
+#   Compressed records are varints, delta-encoded against the previous record in the block.
+#
+# Event types are 0 = birth, 1 = death, 2 = move.  A parent id of 0 means none.
+#
+# Usage: ./read_events.py FILE [--csv]
+#
+# As a module, read_events(filename) returns a dict mapping each field name to a list of
+# values (or to a numpy array, if numpy is available).
+
+import struct
+import sys
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+FIELDS = ['update', 'type', 'org_id', 'parent_id', 'pop_id', 'pos']
+EVENT_NAMES = {0: 'birth', 1: 'death', 2: 'move'}
+RECORD = struct.Struct('<QQQIHBx')
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_block(data, pos, num_records, columns):
+    update = org_id = record_pos = 0
+    for _ in range(num_records):
+        delta, pos = read_varint(data, pos)
+        update += delta
+        event_type = data[pos]
+        pos += 1
+        delta, pos = read_varint(data, pos)
+        org_id += unzigzag(delta)
+        parent_delta, pos = read_varint(data, pos)
+        delta, pos = read_varint(data, pos)
+        record_pos += unzigzag(delta)
+        pop_id, pos = read_varint(data, pos)
+        for name, value in zip(FIELDS, (update, event_type, org_id,
+                                        org_id - parent_delta if parent_delta else 0,
+                                        pop_id, record_pos)):
+            columns[name].append(value)
+    return pos
+
+
+def read_events(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    magic, version, flags, record_size = struct.unpack_from('<8sIII', data, 0)
+    if magic != b'MABEEVNT':
+        raise ValueError(filename + ' is not a MABE event journal.')
+    if version != 1:
+        raise ValueError('Unknown event journal version %d.' % version)
+    if record_size != RECORD.size:
+        raise ValueError('Unexpected record size %d.' % record_size)
+    compressed = bool(flags & 1)
+
+    columns = {name: [] for name in FIELDS}
+    pos = 24
+    while pos < len(data):
+        tag, num_records, payload_size = struct.unpack_from('<4sIQ', data, pos)
+        if tag != b'EVBK':
+            raise ValueError('Corrupt block at byte %d.' % pos)
+        pos += 16
+        end = pos + payload_size
+        if compressed:
+            if decode_block(data, pos, num_records, columns) != end:
+                raise ValueError('Corrupt compressed block ending at byte %d.' % end)
+        else:
+            for update, org_id, parent_id, record_pos, pop_id, event_type in \
+                    RECORD.iter_unpack(data[pos:end]):
+                for name, value in zip(FIELDS, (update, event_type, org_id, parent_id,
+                                                pop_id, record_pos)):
+                    columns[name].append(value)
+        pos = end
+
+    if np is not None:
+        columns = {name: np.array(values, dtype='<u8') for name, values in columns.items()}
+    return columns
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('Usage: %s FILE [--csv]' % sys.argv[0])
+        sys.exit(1)
+
+    columns = read_events(sys.argv[1])
+    num_events = len(columns['update'])
+    if '--csv' in sys.argv[2:]:
+        print(','.join(FIELDS))
+        for i in range(num_events):
+            row = [columns[name][i] for name in FIELDS]
+            row[1] = EVENT_NAMES.get(int(row[1]), row[1])
+            print(','.join(str(value) for value in row))
+    else:
+        counts = {}
+        for event_type in columns['type']:
+            counts[int(event_type)] = counts.get(int(event_type), 0) + 1
+        print('%d events:' % num_events,
+              ', '.join('%d %s' % (count, EVENT_NAMES.get(event_type, event_type))
+                        for event_type, count in sorted(counts.items())))
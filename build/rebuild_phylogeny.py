@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+# Rebuild a phylogeny from the taxa stream written by TrackSystematics (export_file).
+#
+# Taxa are appended to the stream as they leave the tree, so rows are not in ID order and
+# the file may be much larger than memory.  It is sorted by ID in chunks of --chunk-rows
+# rows, each sorted chunk is written to a temporary file, and the chunks are then merged.
+#
+#   alife  : (default) a CSV in the ALife phylogeny standard, sorted by ID; the merge is
+#            streamed straight to the output, so memory use is bounded by the chunk size.
+#   newick : one Newick tree per root, with branch lengths equal to the difference in
+#            origination time between each taxon and its parent.  The tree structure is held
+#            in compact arrays (about 40 bytes per taxon); taxon info is not loaded.
+#
+# Usage: ./rebuild_phylogeny.py STREAM OUTPUT [--format alife|newick] [--chunk-rows N]
+#                               [--tmpdir DIR]
+
+import argparse
+import array
+import bisect
+import csv
+import heapq
+import os
+import sys
+import tempfile
+
+csv.field_size_limit(sys.maxsize)
+
+
+def parse_parent(ancestor_list):
+    ancestor_list = ancestor_list.strip('[]')
+    return 0 if ancestor_list in ('', 'NONE') else int(ancestor_list)
+
+
+def write_sorted_runs(filename, chunk_rows, tmpdir):
+    """Split the stream into sorted temporary files; return (header, run filenames)."""
+    runs = []
+
+    def write_run(rows):
+        rows.sort(key=lambda row: int(row[0]))
+        run = tempfile.NamedTemporaryFile('w', newline='', dir=tmpdir, delete=False, suffix='.csv')
+        csv.writer(run).writerows(rows)
+        run.close()
+        runs.append(run.name)
+
+    with open(filename, newline='') as f:
+        reader = csv.reader(f)
+        header = next(reader)
+        rows = []
+        for row in reader:
+            if not row:
+                continue
+            rows.append(row)
+            if len(rows) >= chunk_rows:
+                write_run(rows)
+                rows = []
+        if rows:
+            write_run(rows)
+    return header, runs
+
+
+def merged_rows(runs):
+    """All rows from the sorted runs, in ID order, with duplicate IDs dropped."""
+    files = [open(run, newline='') for run in runs]
+    try:
+        last_id = None
+        for row in heapq.merge(*(csv.reader(f) for f in files), key=lambda row: int(row[0])):
+            if row[0] != last_id:
+                last_id = row[0]
+                yield row
+    finally:
+        for f in files:
+            f.close()
+
+
+def write_alife(header, rows, output):
+    with open(output, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(header)
+        writer.writerows(rows)
+
+
+def write_newick(header, rows, output):
+    id_col = header.index('id')
+    parent_col = header.index('ancestor_list')
+    time_col = header.index('origin_time')
+
+    ids = array.array('q')
+    parent_ids = array.array('q')
+    times = array.array('d')
+    for row in rows:
+        ids.append(int(row[id_col]))
+        parent_ids.append(parse_parent(row[parent_col]))
+        times.append(float(row[time_col]))
+
+    # Convert parent IDs to positions (ids are sorted) and group children by parent.
+    num_taxa = len(ids)
+    parents = array.array('q', [-1]) * num_taxa
+    num_children = array.array('q', [0]) * (num_taxa + 1)
+    for i in range(num_taxa):
+        pos = bisect.bisect_left(ids, parent_ids[i])
+        if parent_ids[i] and pos < num_taxa and ids[pos] == parent_ids[i]:
+            parents[i] = pos
+            num_children[pos + 1] += 1
+    for i in range(num_taxa):
+        num_children[i + 1] += num_children[i]
+    child_start = num_children
+    children = array.array('q', [0]) * num_taxa
+    next_child = array.array('q', child_start[:num_taxa])
+    for i in range(num_taxa):
+        if parents[i] >= 0:
+            children[next_child[parents[i]]] = i
+            next_child[parents[i]] += 1
+
+    def branch(node):
+        if parents[node] < 0:
+            return ''
+        return ':%g' % (times[node] - times[parents[node]])
+
+    with open(output, 'w') as f:
+        for root in range(num_taxa):
+            if parents[root] >= 0:
+                continue
+            # Depth-first, writing '(' before a node's children and its label after them.
+            stack = [(root, child_start[root])]
+            if child_start[root] < child_start[root + 1]:
+                f.write('(')
+            while stack:
+                node, child_pos = stack.pop()
+                if child_pos < child_start[node + 1]:
+                    if child_pos > child_start[node]:
+                        f.write(',')
+                    stack.append((node, child_pos + 1))
+                    child = children[child_pos]
+                    if child_start[child] < child_start[child + 1]:
+                        f.write('(')
+                    stack.append((child, child_start[child]))
+                    continue
+                if child_start[node] < child_start[node + 1]:
+                    f.write(')')
+                f.write('%d%s' % (ids[node], branch(node)))
+            f.write(';\n')
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Rebuild a phylogeny from a TrackSystematics taxa stream.')
+    parser.add_argument('stream')
+    parser.add_argument('output')
+    parser.add_argument('--format', choices=['alife', 'newick'], default='alife')
+    parser.add_argument('--chunk-rows', type=int, default=1000000)
+    parser.add_argument('--tmpdir', default=None)
+    args = parser.parse_args()
+
+    header, runs = write_sorted_runs(args.stream, args.chunk_rows, args.tmpdir)
+    try:
+        if args.format == 'alife':
+            write_alife(header, merged_rows(runs), args.output)
+        else:
+            write_newick(header, merged_rows(runs), args.output)
+    finally:
+        for run in runs:
+            os.remove(run)
@@ -0,0 +1,221 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  EventJournal.hpp
+ *  @brief Module to record every organism birth and death in a compact binary journal.
+ *
+ *  A much cheaper alternative to TrackSystematics when only "who begat whom" is needed:
+ *  nothing is analyzed during the run.  Each organism is given a unique ID (starting at 1)
+ *  when it is placed, and a fixed-size record is journaled for each birth (with the parent's
+ *  ID, or 0 for injected organisms) and each death.  If 'record_moves' is set, organisms
+ *  moved between positions (e.g., by MovePopulation) are journaled as well; IDs follow
+ *  organisms as they move either way.
+ *
+ *  Records are buffered into blocks of 'block_records' and handed to the AsyncWriter, so file
+ *  I/O happens off the main thread.  Setting 'compress' delta/varint-encodes each block,
+ *  shrinking the journal about four-fold.  See tools/EventFile.hpp for the file layout and
+ *  build/read_events.py for a Python reader.
+ *
+ *  Checkpoints save the journal's length along with the organism IDs.  The file is opened at
+ *  the first update, so a restored run can first truncate it to that length and then append,
+ *  without journaling the organisms that the restore places back into the populations.
+ */
+
+#ifndef MABE_EVENT_JOURNAL_H
+#define MABE_EVENT_JOURNAL_H
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "emp/base/vector.hpp"
+
+#include "../core/MABE.hpp"
+#include "../core/Module.hpp"
+#include "../tools/EventFile.hpp"
+
+namespace mabe {
+
+  class EventJournal : public Module {
+  private:
+    using Type = EventFileWriter::Type;
+
+    std::string filename = "events.bin"; ///< File to write the journal to.
+    bool compress = false;               ///< Should blocks be delta/varint compressed?
+    size_t block_records = 4096;         ///< Number of records to buffer per block.
+    bool record_moves = false;           ///< Should moves between positions be journaled?
+
+    EventFileWriter writer;
+    int file_id = -1;                    ///< ID of the journal file in the AsyncWriter.
+    bool init = false;                   ///< Has the file been opened (or failed to)?
+    std::string out;                     ///< Encoded data waiting to be written.
+    bool resume = false;                 ///< Are we continuing a journal from a checkpoint?
+    bool restoring = false;              ///< Is a checkpoint restore placing organisms?
+    uint64_t resume_pos = 0;             ///< Size of the journal when the checkpoint was saved.
+
+    emp::vector<emp::vector<uint64_t>> org_ids;  ///< ID of organism at each [pop][pos].
+    uint64_t next_id = 1;                ///< ID to give the next organism placed.
+    uint64_t parent_id = 0;              ///< Parent of organism between BeforePlacement and OnPlacement.
+
+    uint64_t & IDAt(OrgPosition pos) {
+      const size_t pop_id = (size_t) pos.PopID();
+      if (pop_id >= org_ids.size()) org_ids.resize(pop_id + 1);
+      emp::vector<uint64_t> & pop_ids = org_ids[pop_id];
+      if (pos.Pos() >= pop_ids.size()) pop_ids.resize(pos.PopPtr()->GetSize(), 0);
+      return pop_ids[pos.Pos()];
+    }
+
+    /// Send any encoded data to the file (once it is open).
+    void SendOutput() {
+      if (file_id < 0 || out.empty()) return;
+      control.GetAsyncWriter().Write((size_t) file_id, std::move(out));
+      out.clear();
+    }
+
+    void AddEvent(Type type, uint64_t org_id, uint64_t parent, OrgPosition pos) {
+      if (init && file_id < 0) return;
+      if (writer.AddEvent(type, control.GetUpdate(), org_id, parent, pos.Pos(), (size_t) pos.PopID())) {
+        writer.WriteBlock(out);
+        SendOutput();
+      }
+    }
+
+    // Open the journal right before the first update, so that a checkpoint can be restored
+    // first.  If resuming, drop anything written after the checkpoint and continue from there.
+    void InitializeFile() {
+      init = true;
+      if (resume) {
+        std::error_code ec;
+        std::filesystem::resize_file(filename, resume_pos, ec);
+        if (ec) AddWarning("Unable to truncate '", filename, "' to checkpoint: ", ec.message());
+      }
+      file_id = control.GetAsyncWriter().Open(filename, resume);
+      if (file_id < 0) {
+        AddError("EventJournal unable to open file '", filename, "'.");
+        return;
+      }
+      SendOutput();
+    }
+
+  public:
+    EventJournal(mabe::MABE & control,
+                 const std::string & name="EventJournal",
+                 const std::string & desc="Module to record all births and deaths in a binary journal.")
+      : Module(control, name, desc)
+    {
+      SetAnalyzeMod();
+    }
+    ~EventJournal() { }
+
+    uint64_t GetNumOrgsPlaced() const { return next_id - 1; }
+
+    void SetupConfig() override {
+      LinkVar(filename, "filename", "Name of file to write the event journal to.");
+      LinkVar(compress, "compress", "Should blocks of events be delta/varint compressed?");
+      LinkVar(block_records, "block_records", "Number of events to buffer per block.");
+      LinkVar(record_moves, "record_moves", "Should organisms moving between positions be journaled?");
+    }
+
+    void SetupModule() override {
+      writer.SetCompress(compress);
+      writer.SetBlockRecords(block_records);
+      writer.WriteHeader(out);
+    }
+
+    /// Record how much of the journal was written and the ID of every organism.
+    void SerializeState(std::ostream & os) override {
+      uint64_t file_pos = 0;
+      if (file_id >= 0) {
+        writer.WriteBlock(out);
+        SendOutput();
+        control.GetAsyncWriter().Flush();
+        file_pos = control.GetAsyncWriter().GetFilePos((size_t) file_id);
+      }
+      WriteBinary(os, file_pos);
+      WriteBinary(os, next_id);
+      WriteBinary<uint64_t>(os, org_ids.size());
+      for (const emp::vector<uint64_t> & pop_ids : org_ids) {
+        WriteBinary<uint64_t>(os, pop_ids.size());
+        os.write((const char *) pop_ids.data(), (std::streamsize) (pop_ids.size() * sizeof(uint64_t)));
+      }
+    }
+
+    bool DeserializeState(std::istream & is) override {
+      uint64_t num_pops = 0;
+      ReadBinary(is, resume_pos);
+      ReadBinary(is, next_id);
+      if (!ReadBinary(is, num_pops) || num_pops > (uint64_t) -1 / sizeof(uint64_t) ||
+          !HasBytesLeft(is, num_pops * sizeof(uint64_t))) return false;   // Each pop has a size.
+      org_ids.resize(num_pops);
+      for (emp::vector<uint64_t> & pop_ids : org_ids) {
+        uint64_t pop_size = 0;
+        if (!ReadBinary(is, pop_size) || pop_size > (uint64_t) -1 / sizeof(uint64_t) ||
+            !HasBytesLeft(is, pop_size * sizeof(uint64_t))) return false;
+        pop_ids.resize(pop_size);
+        is.read((char *) pop_ids.data(), (std::streamsize) (pop_size * sizeof(uint64_t)));
+      }
+
+      // Anything journaled during setup is replaced by the restored run.
+      writer.WriteBlock(out);
+      out.clear();
+      resume = (resume_pos > 0);
+      if (!resume) writer.WriteHeader(out);
+      restoring = true;
+      return (bool) is;
+    }
+
+    void BeforeUpdate(size_t) override {
+      restoring = false;
+      if (!init) InitializeFile();
+    }
+
+    void BeforePlacement(Organism &, OrgPosition, OrgPosition ppos) override {
+      if (restoring) return;
+      // Look the parent up now; placement may replace it.
+      parent_id = ppos.IsValid() ? IDAt(ppos) : 0;
+    }
+
+    void OnPlacement(OrgPosition pos) override {
+      if (restoring) return;   // Restored organisms keep the IDs saved with the checkpoint.
+      const uint64_t org_id = next_id++;
+      IDAt(pos) = org_id;
+      AddEvent(Type::BIRTH, org_id, parent_id, pos);
+      parent_id = 0;
+    }
+
+    void BeforeDeath(OrgPosition pos) override {
+      if (restoring) return;
+      uint64_t & org_id = IDAt(pos);
+      AddEvent(Type::DEATH, org_id, 0, pos);
+      org_id = 0;
+    }
+
+    void OnSwap(OrgPosition pos1, OrgPosition pos2) override {
+      if (restoring) return;
+      // Copy the IDs out first; looking up a new population may reallocate org_ids.
+      const uint64_t id1 = IDAt(pos1);
+      const uint64_t id2 = IDAt(pos2);
+      IDAt(pos1) = id2;
+      IDAt(pos2) = id1;
+      if (!record_moves) return;
+      if (id2) AddEvent(Type::MOVE, id2, 0, pos1);
+      if (id1) AddEvent(Type::MOVE, id1, 0, pos2);
+    }
+
+    void BeforeExit() override {
+      if (!init) InitializeFile();
+      if (file_id < 0) return;
+      writer.WriteBlock(out);
+      SendOutput();
+      control.GetAsyncWriter().Close((size_t) file_id);
+      file_id = -1;
+    }
+  };
+
+  MABE_REGISTER_MODULE(EventJournal, "Record all births and deaths in a compact binary journal.");
+}
+
+#endif
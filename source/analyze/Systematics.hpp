@@ -25,20 +25,28 @@
 #ifndef EMP_EVO_SYSTEMATICS_H
 #define EMP_EVO_SYSTEMATICS_H
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
 #include <ostream>
 #include <set>
 #include <unordered_set>
-#include <map>
 
-#include "../base/Ptr.hpp"
-#include "../control/Signal.hpp"
-#include "../data/DataManager.hpp"
-#include "../data/DataNode.hpp"
-#include "../datastructs/map_utils.h"
-#include "../datastructs/set_utils.h"
-#include "../math/info_theory.h"
-#include "../math/stats.h"
-#include "../tools/string_utils.h"
+#include "emp/base/assert.hpp"
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/control/Signal.hpp"
+#include "emp/data/DataManager.hpp"
+#include "emp/data/DataNode.hpp"
+#include "emp/datastructs/map_utils.hpp"
+#include "emp/datastructs/set_utils.hpp"
+#include "emp/math/info_theory.hpp"
+#include "emp/math/Random.hpp"
+#include "emp/math/stats.hpp"
+#include "emp/tools/string_utils.hpp"
 
 namespace emp {
 
@@ -49,6 +57,40 @@ namespace emp {
   /// just gives you a place to store your data.
 
   namespace datastruct {
+    /// Mutation type names are interned to small IDs (shared by all taxa) so that per-taxon
+    /// counts can be kept in vectors rather than string-keyed maps.
+    struct MutationTypes {
+      static std::unordered_map<std::string, size_t> & GetMap() {
+        static std::unordered_map<std::string, size_t> type_ids;
+        return type_ids;
+      }
+
+      /// Get the ID for a mutation type, adding it if it is new.
+      static size_t GetID(const std::string & type) {
+        auto & type_ids = GetMap();
+        auto it = type_ids.find(type);
+        if (it != type_ids.end()) return it->second;
+        const size_t id = type_ids.size();
+        type_ids[type] = id;
+        return id;
+      }
+
+      /// Find the ID for a mutation type without adding it; returns -1 if it has never been used.
+      static int FindID(const std::string & type) {
+        auto & type_ids = GetMap();
+        auto it = type_ids.find(type);
+        return (it == type_ids.end()) ? -1 : (int) it->second;
+      }
+    };
+
+    /// Give a new taxon's data the chance to build on its parent's, if it supports Inherit().
+    template <typename T>
+    auto InheritData(T & data, const T & parent_data, int) -> decltype(data.Inherit(parent_data), void()) {
+      data.Inherit(parent_data);
+    }
+    template <typename T>
+    void InheritData(T &, const T &, ...) { }
+
     struct no_data {
         using has_fitness_t = std::false_type;
         using has_mutations_t = std::false_type;
@@ -69,6 +111,62 @@ namespace emp {
       DataNode<double, data::Current, data::Range> fitness; /// This taxon's fitness (for assessing deleterious mutational steps)
       PHEN_TYPE phenotype; /// This taxon's phenotype (for assessing phenotypic change)
 
+      // Lineage totals are built from the parent when a taxon is created (see Inherit()), so
+      // lineage queries take constant time.  Each ancestor's contribution is therefore fixed
+      // as of the creation of its descendant; later changes to an ancestor are not included.
+      emp::vector<int> type_muts;          ///< Mutations of each interned type in this taxon.
+      emp::vector<int> lineage_muts;       ///< Mutations of each type in all ancestors.
+      emp::vector<int> lineage_mut_steps;  ///< Ancestors with mutations of each type.
+      int lineage_deleterious = 0;         ///< Deleterious steps between ancestors.
+      int lineage_phen_changes = 0;        ///< Phenotype changes between ancestors.
+      bool has_parent = false;
+      double parent_fitness = 0.0;         ///< Parent's fitness when this taxon was created.
+      PHEN_TYPE parent_phenotype;          ///< Parent's phenotype when this taxon was created.
+
+      /// Start the lineage totals of a new taxon from its parent's.
+      void Inherit(const mut_landscape_info & parent) {
+        lineage_muts = parent.lineage_muts;
+        lineage_mut_steps = parent.lineage_mut_steps;
+        const size_t num_types = std::max(lineage_muts.size(), parent.type_muts.size());
+        lineage_muts.resize(num_types, 0);
+        lineage_mut_steps.resize(num_types, 0);
+        for (size_t id = 0; id < parent.type_muts.size(); id++) {
+          lineage_muts[id] += parent.type_muts[id];
+          lineage_mut_steps[id] += (int) (parent.type_muts[id] > 0);
+        }
+        lineage_deleterious = parent.CountDeleteriousSteps();
+        lineage_phen_changes = parent.CountPhenotypeChanges();
+        has_parent = true;
+        parent_fitness = parent.GetFitness();
+        parent_phenotype = parent.phenotype;
+      }
+
+      /// Mutations of a type (by ID) in this taxon and all of its ancestors.
+      int CountMuts(size_t type_id) const {
+        int count = 0;
+        if (type_id < type_muts.size()) count += type_muts[type_id];
+        if (type_id < lineage_muts.size()) count += lineage_muts[type_id];
+        return count;
+      }
+
+      /// Taxa on this lineage (including this one) with at least one mutation of a type (by ID).
+      int CountMutSteps(size_t type_id) const {
+        int count = 0;
+        if (type_id < type_muts.size()) count += (int) (type_muts[type_id] > 0);
+        if (type_id < lineage_mut_steps.size()) count += lineage_mut_steps[type_id];
+        return count;
+      }
+
+      /// Steps on this lineage where fitness decreased.
+      int CountDeleteriousSteps() const {
+        return lineage_deleterious + (int) (has_parent && GetFitness() < parent_fitness);
+      }
+
+      /// Steps on this lineage where the phenotype changed.
+      int CountPhenotypeChanges() const {
+        return lineage_phen_changes + (int) (has_parent && phenotype != parent_phenotype);
+      }
+
       const PHEN_TYPE & GetPhenotype() const {
         return phenotype;
       }
@@ -84,6 +182,9 @@ namespace emp {
           } else {
             mut_counts[mut.first] = mut.second;
           }
+          const size_t type_id = MutationTypes::GetID(mut.first);
+          if (type_id >= type_muts.size()) type_muts.resize(type_id+1, 0);
+          type_muts[type_id] += mut.second;
         }
       }
 
@@ -119,6 +220,13 @@ namespace emp {
     size_t total_offspring;   ///<  How many total extant offspring taxa exist from this one (i.e. including indirect)
     size_t depth;             ///<  How deep in tree is this node? (Root is 0)
     double origination_time;  ///<  When did this taxon first appear in the population?
+    double destruction_time;  ///<  When did this taxon go extinct? (infinity if still alive)
+    size_t parent_id;         ///<  ID of the original parent (0 if none), even if collapsed away.
+    size_t num_leaves;        ///<  How many leaves (taxa with no offspring) are in this subtree?
+    size_t leaf_sq_sum;       ///<  Sum of the squared leaf counts of each offspring's subtree.
+    uint32_t arena_id;        ///<  Slot holding this taxon in its Systematics manager's arena.
+    uint32_t set_pos;         ///<  Index of this taxon within the TaxonSet that holds it.
+    uint8_t set_id;           ///<  Which TaxonSet holds this taxon (0 for none).
 
     DATA_STRUCT data;         ///< A struct for storing additional information about this taxon
 
@@ -128,7 +236,13 @@ namespace emp {
     Taxon(size_t _id, const info_t & _info, Ptr<this_t> _parent=nullptr)
      : id (_id), info(_info), parent(_parent)
      , num_orgs(0), tot_orgs(0), num_offspring(0), total_offspring(0)
-     , depth(parent ? (parent->depth+1) : 0) { ; }
+     , depth(parent ? (parent->depth+1) : 0)
+     , destruction_time(std::numeric_limits<double>::infinity())
+     , parent_id(parent ? parent->id : 0)
+     , num_leaves(1), leaf_sq_sum(0), arena_id(0), set_pos(0), set_id(0)
+    {
+      if (parent) datastruct::InheritData(data, parent->data, 0);
+    }
     Taxon(const Taxon &) = delete;
     Taxon(Taxon &&) = default;
     Taxon & operator=(const Taxon &) = delete;
@@ -143,6 +257,9 @@ namespace emp {
     /// Retrieve a pointer to the parent Taxon.
     Ptr<this_t> GetParent() const { return parent; }
 
+    /// Change the parent Taxon (used when collapsing extinct, non-branching ancestors).
+    void SetParent(Ptr<this_t> _parent) { parent = _parent; }
+
     /// Get the number of living organisms currently associated with this Taxon.
     size_t GetNumOrgs() const { return num_orgs; }
 
@@ -161,6 +278,29 @@ namespace emp {
     double GetOriginationTime() const {return origination_time;}
     void SetOriginationTime(double time) {origination_time = time;}
 
+    double GetDestructionTime() const {return destruction_time;}
+    void SetDestructionTime(double time) {destruction_time = time;}
+
+    /// Get the ID of the parent this taxon was created with (0 if none); unlike GetParent(),
+    /// this is unchanged if the parent is later removed by collapsing unifurcations.
+    size_t GetParentID() const { return parent_id; }
+
+    /// Get the number of leaves (taxa with no offspring taxa) in the subtree rooted here.
+    size_t GetNumLeaves() const { return num_leaves; }
+
+    /// Get the sum of the squared number of leaves below each offspring taxon.
+    size_t GetLeafSquareSum() const { return leaf_sq_sum; }
+
+    /// Leaf counts are maintained by the Systematics manager as the tree changes.
+    void SetLeafCounts(size_t _leaves, size_t _sq_sum) { num_leaves = _leaves; leaf_sq_sum = _sq_sum; }
+
+    /// Bookkeeping for the Systematics manager that stores this taxon.
+    uint32_t GetArenaID() const { return arena_id; }
+    void SetArenaID(uint32_t _id) { arena_id = _id; }
+    uint8_t GetSetID() const { return set_id; }
+    uint32_t GetSetPos() const { return set_pos; }
+    void SetSetPos(uint8_t _set_id, uint32_t _pos) { set_id = _set_id; set_pos = _pos; }
+
     /// Add a new organism to this Taxon.
     void AddOrg() { ++num_orgs; ++tot_orgs; }
 
@@ -210,6 +350,346 @@ namespace emp {
   };
 
 
+  /// @brief Slab storage for taxa, addressed by 32-bit indices.
+  /// Taxa are built in place in fixed-size slabs, so they never move (and Ptrs to them remain
+  /// valid) while slots freed by deleted taxa are reused by new ones.  This avoids a separate
+  /// heap allocation for every taxon and keeps taxa that are created together close in memory.
+  template <typename T>
+  class TaxonArena {
+  private:
+    static constexpr size_t SLAB_BITS = 10;
+    static constexpr size_t SLAB_SIZE = 1 << SLAB_BITS;
+    struct Slot { alignas(T) unsigned char bytes[sizeof(T)]; };
+
+    std::vector< std::unique_ptr<Slot[]> > slabs;
+    emp::vector<uint32_t> free_ids;   ///< Slots whose taxa have been deleted.
+    uint32_t num_ids = 0;             ///< Slots ever used.
+
+    T * GetRaw(uint32_t id) const {
+      emp_assert(id < num_ids, id, num_ids);
+      return std::launder(reinterpret_cast<T *>(slabs[id >> SLAB_BITS][id & (SLAB_SIZE-1)].bytes));
+    }
+
+  public:
+    TaxonArena() = default;
+    TaxonArena(const TaxonArena &) = delete;
+    TaxonArena(TaxonArena &&) = default;
+    TaxonArena & operator=(const TaxonArena &) = delete;
+    TaxonArena & operator=(TaxonArena &&) = default;
+
+    /// How many objects are currently stored?
+    size_t GetSize() const { return num_ids - free_ids.size(); }
+
+    /// One more than the highest index ever used.
+    size_t GetNumIDs() const { return num_ids; }
+
+    /// Bytes allocated for slabs and bookkeeping.
+    size_t GetMemoryUse() const {
+      return slabs.size() * SLAB_SIZE * sizeof(Slot)
+           + slabs.capacity() * sizeof(std::unique_ptr<Slot[]>)
+           + free_ids.capacity() * sizeof(uint32_t);
+    }
+
+    /// Build a new object from the provided arguments and return its index.
+    template <typename... ARGS>
+    uint32_t New(ARGS &&... args) {
+      uint32_t id;
+      if (free_ids.size()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+      } else {
+        emp_assert(num_ids < std::numeric_limits<uint32_t>::max(), "Too many taxa for arena.");
+        id = num_ids++;
+        if ((id >> SLAB_BITS) >= slabs.size()) slabs.emplace_back(new Slot[SLAB_SIZE]);
+      }
+      new (GetRaw(id)) T(std::forward<ARGS>(args)...);
+      return id;
+    }
+
+    Ptr<T> Get(uint32_t id) const { return Ptr<T>(GetRaw(id)); }
+
+    /// Destroy the object at an index; its slot will be reused.
+    void Delete(uint32_t id) {
+      GetRaw(id)->~T();
+      free_ids.push_back(id);
+    }
+  };
+
+  /// @brief An unordered collection of taxa stored as a flat vector.
+  /// Each taxon records which set holds it and at what index, so membership tests, insertion,
+  /// and removal (by swapping the last taxon into the vacated slot) are constant time with no
+  /// hashing.  A taxon can be in at most one TaxonSet at a time.
+  template <typename TAXON>
+  class TaxonSet {
+  private:
+    emp::vector< Ptr<TAXON> > taxa;
+    uint8_t set_id;   ///< Non-zero ID recorded in each member taxon.
+
+  public:
+    TaxonSet(uint8_t _id) : set_id(_id) { emp_assert(set_id != 0); }
+
+    size_t size() const { return taxa.size(); }
+    size_t capacity() const { return taxa.capacity(); }
+    bool empty() const { return taxa.size() == 0; }
+    auto begin() const { return taxa.begin(); }
+    auto end() const { return taxa.end(); }
+    Ptr<TAXON> operator[](size_t id) const { return taxa[id]; }
+    const emp::vector< Ptr<TAXON> > & GetTaxa() const { return taxa; }
+
+    bool Has(Ptr<TAXON> taxon) const { return taxon->GetSetID() == set_id; }
+
+    void insert(Ptr<TAXON> taxon) {
+      emp_assert(taxon->GetSetID() == 0, "Taxon is already in a set.", (int) taxon->GetSetID());
+      taxon->SetSetPos(set_id, (uint32_t) taxa.size());
+      taxa.push_back(taxon);
+    }
+
+    /// Remove a taxon if it is in this set; the last taxon takes its place.
+    void erase(Ptr<TAXON> taxon) {
+      if (!Has(taxon)) return;
+      const uint32_t pos = taxon->GetSetPos();
+      emp_assert(pos < taxa.size() && taxa[pos] == taxon);
+      taxa[pos] = taxa.back();
+      taxa[pos]->SetSetPos(set_id, pos);
+      taxa.pop_back();
+      taxon->SetSetPos(0, 0);
+    }
+
+    void clear() {
+      for (Ptr<TAXON> taxon : taxa) taxon->SetSetPos(0, 0);
+      taxa.resize(0);
+    }
+  };
+
+
+  /// @brief Lowest-common-ancestor index over the current phylogeny.
+  /// Built from the active taxa and all of their ancestors in O(n log n) time: an Euler tour
+  /// of each tree is recorded along with a sparse table of the shallowest node in every
+  /// power-of-two range of the tour, so the LCA (and hence the distance) of any two indexed
+  /// taxa is found in constant time.  Sums of distances over all pairs of active taxa are
+  /// calculated in linear time from subtree counts, without enumerating the pairs.
+  ///
+  /// Distances count the parent links between taxa.  With branch_only, runs of extinct taxa
+  /// that have a single child are contracted, so only living taxa and branch points count.
+  template <typename TAXON>
+  class TaxonLCAIndex {
+  private:
+    static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+    emp::vector<uint32_t> node_of;         ///< Node for each taxon arena ID (or NO_NODE).
+    emp::vector< Ptr<TAXON> > nodes;       ///< Taxon for each node.
+    emp::vector<uint32_t> parent;          ///< Parent node (NO_NODE for roots).
+    emp::vector<uint32_t> child_start;     ///< Start of each node's children in child_list.
+    emp::vector<uint32_t> child_list;      ///< Children of all nodes, grouped by parent.
+    emp::vector<uint32_t> preorder;        ///< All nodes, each before its descendants.
+    emp::vector<uint32_t> tree_id;         ///< Which tree (by root) is each node in?
+    emp::vector<uint32_t> depth;           ///< Links from the root.
+    emp::vector<uint32_t> branch_depth;    ///< Links from the root, counting only kept nodes.
+    emp::vector<char> active;              ///< Is each node an active (living) taxon?
+    emp::vector<uint32_t> first_visit;     ///< First position of each node in the Euler tour.
+    emp::vector<uint8_t> log2_floor;       ///< floor(log2(i)) for each range length i.
+    emp::vector< emp::vector<uint32_t> > table;  ///< table[k][i]: shallowest node in tour[i, i+2^k).
+
+    /// Would this node remain if extinct, non-branching taxa were contracted?
+    bool IsKept(uint32_t node) const {
+      return active[node] || child_start[node+1] - child_start[node] != 1;
+    }
+
+    /// Length of the link from a node to its parent.
+    uint32_t LinkLength(uint32_t node, bool branch_only) const {
+      return (!branch_only || IsKept(parent[node])) ? 1 : 0;
+    }
+
+    uint32_t Shallower(uint32_t n1, uint32_t n2) const { return depth[n1] <= depth[n2] ? n1 : n2; }
+
+    uint32_t FindNode(Ptr<TAXON> taxon) const {
+      const uint32_t arena_id = taxon->GetArenaID();
+      if (arena_id >= node_of.size()) return NO_NODE;
+      const uint32_t node = node_of[arena_id];
+      return (node != NO_NODE && nodes[node] == taxon) ? node : NO_NODE;
+    }
+
+    /// Lowest common ancestor of two nodes in the same tree.
+    uint32_t FindLCA(uint32_t n1, uint32_t n2) const {
+      size_t pos1 = first_visit[n1], pos2 = first_visit[n2];
+      if (pos1 > pos2) std::swap(pos1, pos2);
+      const size_t k = log2_floor[pos2 - pos1 + 1];
+      return Shallower(table[k][pos1], table[k][pos2 + 1 - ((size_t) 1 << k)]);
+    }
+
+  public:
+    size_t GetSize() const { return nodes.size(); }
+    bool Has(Ptr<TAXON> taxon) const { return FindNode(taxon) != NO_NODE; }
+
+    /// Rebuild the index from a set of active taxa; num_arena_ids must exceed all arena IDs.
+    template <typename SET_T>
+    void Build(const SET_T & active_taxa, size_t num_arena_ids) {
+      node_of.assign(num_arena_ids, NO_NODE);
+      nodes.resize(0);
+      parent.resize(0);
+
+      // Collect the active taxa and every ancestor, giving each a node ID.
+      for (Ptr<TAXON> taxon : active_taxa) {
+        uint32_t prev_node = NO_NODE;
+        while (taxon) {
+          uint32_t & node = node_of[taxon->GetArenaID()];
+          const bool is_new = (node == NO_NODE);
+          if (is_new) {
+            node = (uint32_t) nodes.size();
+            nodes.push_back(taxon);
+            parent.push_back(NO_NODE);
+          }
+          if (prev_node != NO_NODE) parent[prev_node] = node;
+          if (!is_new) break;
+          prev_node = node;
+          taxon = taxon->GetParent();
+        }
+      }
+      const size_t num_nodes = nodes.size();
+      active.assign(num_nodes, 0);
+      for (size_t node = 0; node < num_nodes; node++) active[node] = nodes[node]->GetNumOrgs() > 0;
+
+      // Group children by parent (counting sort).
+      child_start.assign(num_nodes + 1, 0);
+      for (uint32_t p : parent) if (p != NO_NODE) child_start[p+1]++;
+      for (size_t node = 0; node < num_nodes; node++) child_start[node+1] += child_start[node];
+      child_list.resize(child_start[num_nodes]);
+      emp::vector<uint32_t> next_child(child_start.begin(), child_start.end() - 1);
+      for (size_t node = 0; node < num_nodes; node++) {
+        if (parent[node] != NO_NODE) child_list[next_child[parent[node]]++] = (uint32_t) node;
+      }
+
+      // Walk each tree depth-first, recording the Euler tour.
+      emp::vector<uint32_t> tour;
+      tour.reserve(2 * num_nodes);
+      preorder.resize(0);
+      tree_id.assign(num_nodes, NO_NODE);
+      depth.assign(num_nodes, 0);
+      branch_depth.assign(num_nodes, 0);
+      first_visit.assign(num_nodes, 0);
+      emp::vector< std::pair<uint32_t, uint32_t> > stack;  // Node and next child offset.
+      for (uint32_t root = 0; root < num_nodes; root++) {
+        if (parent[root] != NO_NODE) continue;
+        stack.emplace_back(root, child_start[root]);
+        tree_id[root] = root;
+        first_visit[root] = (uint32_t) tour.size();
+        tour.push_back(root);
+        preorder.push_back(root);
+        while (stack.size()) {
+          const uint32_t node = stack.back().first;
+          const uint32_t child_pos = stack.back().second;
+          if (child_pos == child_start[node+1]) {
+            stack.pop_back();
+            if (stack.size()) tour.push_back(stack.back().first);
+            continue;
+          }
+          stack.back().second++;
+          const uint32_t child = child_list[child_pos];
+          tree_id[child] = root;
+          depth[child] = depth[node] + 1;
+          branch_depth[child] = branch_depth[node] + LinkLength(child, true);
+          first_visit[child] = (uint32_t) tour.size();
+          tour.push_back(child);
+          preorder.push_back(child);
+          stack.emplace_back(child, child_start[child]);
+        }
+      }
+
+      // Build the sparse table of shallowest nodes over the tour.
+      const size_t tour_size = tour.size();
+      log2_floor.assign(tour_size + 1, 0);
+      for (size_t i = 2; i <= tour_size; i++) log2_floor[i] = log2_floor[i/2] + 1;
+      table.resize(tour_size ? log2_floor[tour_size] + 1 : 0);
+      if (table.size()) table[0] = tour;
+      for (size_t k = 1; k < table.size(); k++) {
+        const size_t half = (size_t) 1 << (k-1);
+        const size_t level_size = tour_size - 2*half + 1;
+        table[k].resize(level_size);
+        for (size_t i = 0; i < level_size; i++) {
+          table[k][i] = Shallower(table[k-1][i], table[k-1][i+half]);
+        }
+      }
+    }
+
+    /// Distance between two indexed taxa; -1 if either is not indexed or they are in different trees.
+    int GetDistance(Ptr<TAXON> taxon1, Ptr<TAXON> taxon2, bool branch_only=false) const {
+      const uint32_t n1 = FindNode(taxon1);
+      const uint32_t n2 = FindNode(taxon2);
+      if (n1 == NO_NODE || n2 == NO_NODE || tree_id[n1] != tree_id[n2]) return -1;
+      const emp::vector<uint32_t> & d = branch_only ? branch_depth : depth;
+      return (int) (d[n1] + d[n2] - 2 * d[FindLCA(n1, n2)]);
+    }
+
+    /// Append the distance between each pair of indexed taxa that are in the same tree.
+    /// Taxa are visited in Euler-tour order, where the LCA of any two taxa is the shallowest
+    /// of the LCAs of the adjacent taxa between them; each row is then a running minimum, so
+    /// every pair takes constant, sequential work (and no sparse-table lookups).
+    template <typename SET_T>
+    void AppendPairDistances(const SET_T & taxa, bool branch_only, emp::vector<double> & dists) const {
+      emp::vector<uint32_t> taxa_nodes;
+      taxa_nodes.reserve(taxa.size());
+      for (Ptr<TAXON> taxon : taxa) {
+        const uint32_t node = FindNode(taxon);
+        if (node != NO_NODE) taxa_nodes.push_back(node);
+      }
+      const size_t num_taxa = taxa_nodes.size();
+      if (num_taxa < 2) return;
+      std::sort(taxa_nodes.begin(), taxa_nodes.end(),
+                [this](uint32_t n1, uint32_t n2){ return first_visit[n1] < first_visit[n2]; });
+
+      // Depth of each taxon and of its LCA with the next taxon (NO_NODE if in another tree).
+      const emp::vector<uint32_t> & d = branch_only ? branch_depth : depth;
+      emp::vector<uint32_t> taxa_depth(num_taxa), next_lca_depth(num_taxa, NO_NODE);
+      for (size_t i = 0; i < num_taxa; i++) {
+        const uint32_t node = taxa_nodes[i];
+        taxa_depth[i] = d[node];
+        if (i + 1 < num_taxa && tree_id[node] == tree_id[taxa_nodes[i+1]]) {
+          next_lca_depth[i] = d[FindLCA(node, taxa_nodes[i+1])];
+        }
+      }
+
+      dists.reserve(dists.size() + num_taxa * (num_taxa - 1) / 2);
+      for (size_t i = 0; i < num_taxa; i++) {
+        uint32_t lca_depth = taxa_depth[i];
+        for (size_t j = i+1; j < num_taxa && next_lca_depth[j-1] != NO_NODE; j++) {
+          lca_depth = std::min(lca_depth, next_lca_depth[j-1]);
+          dists.push_back((double) (taxa_depth[i] + taxa_depth[j] - 2 * lca_depth));
+        }
+      }
+    }
+
+    /// Count the pairs of active taxa in the same tree, with the sum and sum of squares of
+    /// their distances, in a single pass over the tree.
+    void CalcPairSums(bool branch_only, double & num_pairs, double & sum, double & sum_sq) const {
+      num_pairs = sum = sum_sq = 0.0;
+      // For each node: active taxa in its subtree, and the sum (and sum of squares) of
+      // their distances to it.
+      emp::vector<double> count(nodes.size()), dist(nodes.size()), dist_sq(nodes.size());
+      for (size_t i = preorder.size(); i-- > 0;) {
+        const uint32_t node = preorder[i];
+        double cnt = active[node] ? 1.0 : 0.0, s1 = 0.0, s2 = 0.0;
+        for (uint32_t pos = child_start[node]; pos < child_start[node+1]; pos++) {
+          const uint32_t child = child_list[pos];
+          const double w = (double) LinkLength(child, branch_only);
+          const double c_cnt = count[child];
+          const double c_s1 = dist[child] + w * c_cnt;
+          const double c_s2 = dist_sq[child] + 2.0 * w * dist[child] + w * w * c_cnt;
+          // Pairs with one taxon in this child's subtree and one seen earlier meet here.
+          num_pairs += cnt * c_cnt;
+          sum += cnt * c_s1 + c_cnt * s1;
+          sum_sq += cnt * c_s2 + 2.0 * s1 * c_s1 + c_cnt * s2;
+          cnt += c_cnt;
+          s1 += c_s1;
+          s2 += c_s2;
+        }
+        count[node] = cnt;
+        dist[node] = s1;
+        dist_sq[node] = s2;
+      }
+    }
+  };
+
+
   /// A base class for Systematics, maintaining information common to all systematics managers
   /// and providing virtual functaions.
 
@@ -274,6 +754,9 @@ namespace emp {
     /// Are we tracking organisms evolving in synchronous generations?
     void SetTrackSynchronous(bool new_val) {track_synchronous = new_val; }
 
+    /// Set the current update directly, rather than counting calls to Update().
+    void SetUpdate(size_t ud) { curr_update = ud; }
+
     /// Are we storing all taxa that are still alive in the population?
     void SetStoreActive(bool new_val) { store_active = new_val; }
 
@@ -359,7 +842,6 @@ namespace emp {
   private:
     using parent_t = SystematicsBase<ORG>;
     using taxon_t = Taxon<ORG_INFO, DATA_STRUCT>;
-    using hash_t = typename Ptr<taxon_t>::hash_t;
     using fun_calc_info_t = std::function<ORG_INFO(ORG &)>;
 
     fun_calc_info_t calc_info_fun;
@@ -416,18 +898,34 @@ namespace emp {
     using parent_t::AddUniqueTaxaDataNode;
     using parent_t::AddMutationCountDataNode;
 
-    std::unordered_set< Ptr<taxon_t>, hash_t > active_taxa;   ///< A set of all living taxa.
-    std::unordered_set< Ptr<taxon_t>, hash_t > ancestor_taxa; ///< A set of all dead, ancestral taxa.
-    std::unordered_set< Ptr<taxon_t>, hash_t > outside_taxa;  ///< A set of all dead taxa w/o descendants.
+    static constexpr uint32_t NO_TAXON = std::numeric_limits<uint32_t>::max();
+
+    TaxonArena<taxon_t> arena;          ///< Storage for all taxa.
+    TaxonSet<taxon_t> active_taxa;      ///< A set of all living taxa.
+    TaxonSet<taxon_t> ancestor_taxa;    ///< A set of all dead, ancestral taxa.
+    TaxonSet<taxon_t> outside_taxa;     ///< A set of all dead taxa w/o descendants.
 
-    emp::vector<Ptr<taxon_t> > taxon_locations;
-    emp::vector<Ptr<taxon_t> > next_taxon_locations;
+    emp::vector<uint32_t> taxon_locations;       ///< Arena index of taxon at each position.
+    emp::vector<uint32_t> next_taxon_locations;  ///< Arena index of taxon at each next position.
 
     Signal<void(Ptr<taxon_t>)> on_new_sig; ///< Trigger when any organism is pruned from tree
     Signal<void(Ptr<taxon_t>)> on_prune_sig; ///< Trigger when any organism is pruned from tree
 
     mutable Ptr<taxon_t> mrca;  ///< Most recent common ancestor in the population.
 
+    size_t tree_version = 1;                    ///< Changes whenever the tree does.
+    mutable size_t lca_version = 0;             ///< Tree version lca_index was built from.
+    mutable TaxonLCAIndex<taxon_t> lca_index;   ///< Built on demand for distance queries.
+
+    // Tree statistics maintained as taxa are added and pruned (only if track_metrics is set).
+    bool track_metrics = false;         ///< Maintain the statistics below? (walks to the root)
+    double sackin_index = 0.0;          ///< See GetSackinIndex()
+    double colless_index = 0.0;         ///< See GetCollessIndex()
+    double cophenetic_index = 0.0;      ///< See GetCopheneticIndex()
+    double total_branch_length = 0.0;   ///< Sum of time between each taxon's and its parent's origination.
+    double ed_weight = 0.0;             ///< Sum over active taxa of 1/(total offspring + 1).
+    double ed_weighted_origin = 0.0;    ///< Sum over active taxa of origination time/(total offspring + 1).
+
     /// Called wheneven a taxon has no organisms AND no descendants.
     void Prune(Ptr<taxon_t> taxon);
 
@@ -437,6 +935,67 @@ namespace emp {
     /// Called when there are no more living members of a taxon.  There may be descendants.
     void MarkExtinct(Ptr<taxon_t> taxon);
 
+    /// Build a new taxon in the arena.
+    template <typename... ARGS>
+    Ptr<taxon_t> NewTaxon(ARGS &&... args) {
+      const uint32_t arena_id = arena.New(std::forward<ARGS>(args)...);
+      Ptr<taxon_t> taxon = arena.Get(arena_id);
+      taxon->SetArenaID(arena_id);
+      return taxon;
+    }
+
+    /// Destroy a taxon (which must not be in any set) and free its arena slot.
+    void DeleteTaxon(Ptr<taxon_t> taxon) {
+      emp_assert(taxon->GetSetID() == 0);
+      arena.Delete(taxon->GetArenaID());
+    }
+
+    /// Add (sign=1) or remove (sign=-1) a taxon's contribution to the balance indices, given
+    /// how many offspring taxa it has.
+    void CountBalance(Ptr<taxon_t> taxon, size_t num_off, double sign) {
+      if (num_off == 0) return;  // Leaves do not contribute.
+      const double leaves = (double) taxon->GetNumLeaves();
+      sackin_index += sign * leaves;
+      colless_index += sign * ((double) num_off * (double) taxon->GetLeafSquareSum() - leaves * leaves);
+      if (taxon->GetParent()) cophenetic_index += sign * leaves * (leaves - 1.0) / 2.0;
+    }
+
+    /// Update leaf counts and balance indices for a leaf taxon being added below (or removed
+    /// from) a parent; must be called before the parent's offspring count changes.
+    void UpdateLeafCounts(Ptr<taxon_t> parent, bool add);
+
+    /// Add (sign=1) or remove (sign=-1) an active taxon's share of the mean evolutionary
+    /// distinctiveness, given its total offspring count.
+    void CountDistinctiveness(Ptr<taxon_t> taxon, size_t total_off, double sign) {
+      const double weight = 1.0 / (double) (total_off + 1);
+      ed_weight += sign * weight;
+      ed_weighted_origin += sign * weight * taxon->GetOriginationTime();
+    }
+
+    /// Update the distinctiveness sums for a taxon and its ancestors, whose total offspring
+    /// counts are about to increase (or decrease) by one.
+    void UpdateDistinctiveness(Ptr<taxon_t> taxon, bool add) {
+      for (; taxon; taxon = taxon->GetParent()) {
+        if (taxon->GetNumOrgs() == 0) continue;
+        const size_t total_off = (size_t) taxon->GetTotalOffspring();
+        CountDistinctiveness(taxon, total_off, -1.0);
+        CountDistinctiveness(taxon, add ? total_off + 1 : total_off - 1, 1.0);
+      }
+    }
+
+    /// Convert an entry from taxon_locations into a taxon pointer (nullptr for none).
+    Ptr<taxon_t> LocationTaxon(uint32_t arena_id) const {
+      if (arena_id == NO_TAXON) return nullptr;
+      return arena.Get(arena_id);
+    }
+
+    /// Record a taxon (or nullptr) at a position in a location vector, growing it if needed.
+    static void SetLocation(emp::vector<uint32_t> & locations, int pos, Ptr<taxon_t> taxon) {
+      emp_assert(pos >= 0, pos);
+      if (pos >= (int) locations.size()) locations.resize(pos+1, NO_TAXON);
+      locations[pos] = taxon ? taxon->GetArenaID() : NO_TAXON;
+    }
+
 
   public:
 
@@ -450,17 +1009,16 @@ namespace emp {
     Systematics(fun_calc_info_t calc_taxon, bool _active=true, bool _anc=true, bool _all=false, bool _pos=true)
       : parent_t(_active, _anc, _all, _pos)
       , calc_info_fun(calc_taxon)
-      , active_taxa(), ancestor_taxa(), outside_taxa()
+      , arena(), active_taxa(1), ancestor_taxa(2), outside_taxa(3)
       , mrca(nullptr) { ; }
     Systematics(const Systematics &) = delete;
     Systematics(Systematics &&) = default;
     ~Systematics() {
-      for (auto x : active_taxa) x.Delete();
-      for (auto x : ancestor_taxa) x.Delete();
-      for (auto x : outside_taxa) x.Delete();
-      active_taxa.clear();
-      ancestor_taxa.clear();
-      outside_taxa.clear();
+      for (TaxonSet<taxon_t> * taxa : { &active_taxa, &ancestor_taxa, &outside_taxa }) {
+        emp::vector< Ptr<taxon_t> > to_delete(taxa->GetTaxa());
+        taxa->clear();
+        for (Ptr<taxon_t> x : to_delete) DeleteTaxon(x);
+      }
     }
 
 
@@ -474,10 +1032,21 @@ namespace emp {
 
     void SetCalcInfoFun(fun_calc_info_t f) {calc_info_fun = f;}
 
+    /// Are the balance indices and mean distinctiveness being maintained?
+    bool GetTrackMetrics() const { return track_metrics; }
+
+    /// Maintain the balance indices and mean distinctiveness as the tree changes?  Each birth
+    /// and death then walks up to the root, so this is off by default; it must be set before
+    /// any organisms are added.
+    void SetTrackMetrics(bool new_val) {
+      emp_assert(org_count == 0 && num_roots == 0, "Set metric tracking before adding organisms.");
+      track_metrics = new_val;
+    }
+
     // Currently using raw pointers because of a weird bug in emp::Ptr. Should switch when fixed.
-    std::unordered_set< Ptr<taxon_t>, hash_t > * GetActivePtr() { return &active_taxa; }
-    const std::unordered_set< Ptr<taxon_t>, hash_t > & GetActive() const { return active_taxa; }
-    const std::unordered_set< Ptr<taxon_t>, hash_t > & GetAncestors() const { return ancestor_taxa; }
+    TaxonSet<taxon_t> * GetActivePtr() { return &active_taxa; }
+    const TaxonSet<taxon_t> & GetActive() const { return active_taxa; }
+    const TaxonSet<taxon_t> & GetAncestors() const { return ancestor_taxa; }
 
     /// How many taxa are still active in the population?
     size_t GetNumActive() const { return active_taxa.size(); }
@@ -500,7 +1069,7 @@ namespace emp {
         next_parent = nullptr;
       } else {
         emp_assert(pos >= 0, "Invalid parent", pos);
-        next_parent = taxon_locations[pos];
+        next_parent = LocationTaxon(taxon_locations[pos]);
       }
     }
 
@@ -648,14 +1217,44 @@ namespace emp {
 
     Ptr<taxon_t> GetTaxonAt(int id) {
       emp_assert(id < (int) taxon_locations.size(), "Invalid taxon location", id, taxon_locations.size());
-      emp_assert(taxon_locations[id], "No taxon at specified location");
-      return taxon_locations[id];
+      emp_assert(taxon_locations[id] != NO_TAXON, "No taxon at specified location");
+      return LocationTaxon(taxon_locations[id]);
+    }
+    /// Is there a taxon recorded at the given position?
+    bool HasTaxonAt(int pos) const {
+      return pos >= 0 && pos < (int) taxon_locations.size() && taxon_locations[pos] != NO_TAXON;
+    }
+
+    /// Record which taxon occupies a position (nullptr to clear it).
+    void SetTaxonAt(int pos, Ptr<taxon_t> taxon) {
+      SetLocation(taxon_locations, pos, taxon);
     }
+
+    /// Exchange the taxa at two positions (either may be empty).
+    void SwapPositions(int pos1, int pos2) {
+      const int max_pos = std::max(pos1, pos2);
+      if (max_pos >= (int) taxon_locations.size()) taxon_locations.resize(max_pos+1, NO_TAXON);
+      std::swap(taxon_locations[pos1], taxon_locations[pos2]);
+    }
+
+    /// Remove extinct ancestors that have exactly one offspring taxon, connecting that offspring
+    /// directly to the removed taxon's parent; only branch points and living taxa remain.
+    /// Depths are unchanged (they still count all taxonomic steps since the root).
+    /// @return the number of taxa removed.
+    size_t CollapseUnifurcations();
+
+    /// Estimate the number of bytes used to store the phylogeny.
+    size_t GetMemoryUse() const {
+      return arena.GetMemoryUse()
+           + (active_taxa.capacity() + ancestor_taxa.capacity() + outside_taxa.capacity()) * sizeof(Ptr<taxon_t>)
+           + (taxon_locations.capacity() + next_taxon_locations.capacity()) * sizeof(uint32_t);
+    }
+
     Ptr<taxon_t> GetNextTaxonAt(int id) {
       emp_assert(id < (int)next_taxon_locations.size(), "Invalid taxon location");
-      emp_assert(next_taxon_locations[id], "No taxon at specified location");
+      emp_assert(next_taxon_locations[id] != NO_TAXON, "No taxon at specified location");
 
-      return next_taxon_locations[id];
+      return LocationTaxon(next_taxon_locations[id]);
     }
 
     /** From (Faith 1992, reviewed in Winters et al., 2013), phylogenetic diversity is
@@ -676,6 +1275,24 @@ namespace emp {
       return ancestor_taxa.size() + active_taxa.size() - 1;
     }
 
+    /** Sackin's index of tree imbalance: the sum, over all leaves (taxa without offspring
+     *  taxa), of the number of ancestors between each leaf and its root.  Like the other
+     *  balance indices, it is summed over all trees and updated in O(depth) time as taxa are
+     *  added and pruned.  Requires SetTrackMetrics(true).
+     */
+    double GetSackinIndex() const { emp_assert(track_metrics); return sackin_index; }
+
+    /** The quadratic Colless index (Bartoszek et al., 2021), extended to multifurcations: for
+     *  each taxon, the sum over all pairs of its offspring of the squared difference in the
+     *  number of leaves below them.  In a bifurcating tree this is the sum of (n_l - n_r)^2.
+     */
+    double GetCollessIndex() const { emp_assert(track_metrics); return colless_index; }
+
+    /** The total cophenetic index (Mir et al., 2013): the sum, over all pairs of leaves, of
+     *  the depth of their most recent common ancestor.
+     */
+    double GetCopheneticIndex() const { emp_assert(track_metrics); return cophenetic_index; }
+
     /** This is a metric of how distinct @param tax is from the rest of the population.
      *
      * (From Vane-Wright et al., 1991; reviewed in Winter et al., 2013)
@@ -747,6 +1364,30 @@ namespace emp {
       return -1;
     }
 
+    /** Mean of GetEvolutionaryDistinctiveness() over all active taxa.  Distinctiveness
+     *  shares out the time along each branch below the MRCA among the active taxa descended
+     *  from it (plus each taxon's share of its own lifetime), so this is calculated from sums
+     *  maintained as taxa change, in the O(depth) time needed to find the MRCA and root.
+     *  Like GetEvolutionaryDistinctiveness(), this assumes that all active taxa descend from
+     *  the MRCA.  Returns -1 if there is no single MRCA.
+     */
+    double GetMeanEvolutionaryDistinctiveness(double time) const {
+      emp_assert(track_metrics);
+      GetMRCA();
+      if (!mrca || active_taxa.size() == 0) return -1.0;
+      Ptr<taxon_t> root = mrca;
+      while (root->GetParent()) root = root->GetParent();
+
+      // Branches above the MRCA form a single line, so their lengths sum to the time between.
+      double total = total_branch_length - (mrca->GetOriginationTime() - root->GetOriginationTime())
+                   + time * ed_weight - ed_weighted_origin;
+      // The MRCA has no distinctiveness, so remove its share if it is active.
+      if (mrca->GetNumOrgs() > 0) {
+        total -= (time - mrca->GetOriginationTime()) / (double) (mrca->GetTotalOffspring() + 1);
+      }
+      return total / (double) active_taxa.size();
+    }
+
     /** Calculates mean pairwise distance between extant taxa (Webb and Losos, 2000).
      * This measurement is also called Average Taxonomic Diversity (Warwick and Clark, 1998)
      * (for demonstration of equivalence see Tucker et al, 2016). This measurment tells
@@ -756,12 +1397,12 @@ namespace emp {
      * between two extant taxa (poentially useful for comparison to biological data, where
      * non-branching nodes generally cannot be inferred).
      *
-     * This measurement assumes that the tree is fully connected. Will return -1
-     * if this is not the case.
+     * If there is more than one tree, only pairs of taxa within the same tree are included.
      * */
     double GetMeanPairwiseDistance(bool branch_only=false) const {
-      emp::vector<double> dists = GetPairwiseDistances(branch_only);
-      return (double)Sum(dists)/dists.size();
+      double num_pairs, sum, sum_sq;
+      GetLCAIndex().CalcPairSums(branch_only, num_pairs, sum, sum_sq);
+      return sum / num_pairs;
     }
 
     /** Calculates summed pairwise distance between extant taxa. Tucker et al 2017 points
@@ -771,12 +1412,12 @@ namespace emp {
      * between two extant taxa (poentially useful for comparison to biological data, where
      * non-branching nodes generally cannot be inferred).
      *
-     * This measurement assumes that the tree is fully connected. Will return -1
-     * if this is not the case.
+     * If there is more than one tree, only pairs of taxa within the same tree are included.
      * */
     double GetSumPairwiseDistance(bool branch_only=false) const {
-      emp::vector<double> v = GetPairwiseDistances(branch_only);
-      return Sum(v);
+      double num_pairs, sum, sum_sq;
+      GetLCAIndex().CalcPairSums(branch_only, num_pairs, sum, sum_sq);
+      return sum;
     }
 
     /** Calculates variance of pairwise distance between extant taxa. Tucker et al 2017 points
@@ -786,120 +1427,63 @@ namespace emp {
      * between two extant taxa (poentially useful for comparison to biological data, where
      * non-branching nodes generally cannot be inferred).
      *
-     * This measurement assumes that the tree is fully connected. Will return -1
-     * if this is not the case.
+     * If there is more than one tree, only pairs of taxa within the same tree are included.
      * */
     double GetVariancePairwiseDistance(bool branch_only=false) const {
-      emp::vector<double> v = GetPairwiseDistances(branch_only);
-      return Variance(v);
+      double num_pairs, sum, sum_sq;
+      GetLCAIndex().CalcPairSums(branch_only, num_pairs, sum, sum_sq);
+      const double mean = sum / num_pairs;
+      return sum_sq / num_pairs - mean * mean;
     }
 
-    /** Calculates a vector of all pairwise distances between extant taxa.
+    /** Calculates a vector of all pairwise distances between extant taxa (in no particular
+     *  order).
      *
      * @param branch_only only counts distance in terms of nodes that represent a branch
      * between two extant taxa (poentially useful for comparison to biological data, where
      * non-branching nodes generally cannot be inferred).
      *
-     * This method assumes that the tree is fully connected. Will return -1
-     * if this is not the case.
+     * If there is more than one tree, only pairs of taxa within the same tree are included.
      * */
     emp::vector<double> GetPairwiseDistances(bool branch_only=false) const {
-      // The overarching approach here is to start with a bunch of pointers to all
-      // extant organisms (since that will include all leaves). Then we trace back up
-      // the tree, keeping track of distances. When things meet up, we calculate
-      // distances between the nodes on the sides that just met up.
-
       emp::vector<double> dists;
+      GetLCAIndex().AppendPairDistances(active_taxa, branch_only, dists);
+      return dists;
+    }
 
-      std::map< Ptr<taxon_t>, emp::vector<emp::vector<int>> > curr_pointers;
-      std::map< Ptr<taxon_t>, emp::vector<emp::vector<int>> > next_pointers;
-
-
-      for (Ptr<taxon_t> tax : active_taxa) {
-        curr_pointers[tax] = emp::vector<emp::vector<int>>({{0}});
-      }
-
-      // std::cout << "Starting curr_pointers size: " << curr_pointers.size() << std::endl;
-
-      while (curr_pointers.size() > 0) {
-        for (auto & tax : curr_pointers) {
-          bool alive = tax.first->GetNumOrgs() > 0;
-          // std::cout << tax.first << " has " << to_string(tax.second) << "and is waiting for " << tax.first->GetNumOff() + int(alive) << std::endl;
-          if ( tax.second.size() < tax.first->GetNumOff() + int(alive)) {
-            if (Has(next_pointers, tax.first)) {
-              // In case an earlier iteration added this node to next_pointers
-              for (auto vec : tax.second) {
-                next_pointers[tax.first].push_back(vec);
-              }
-            } else {
-              next_pointers[tax.first] = curr_pointers[tax.first];
-            }
-            continue;
-          }
-          emp_assert(tax.first->GetNumOff() + int(alive) == tax.second.size(), tax.first->GetNumOff(), alive, to_string(tax.second), tax.second.size());
-
-          // Okay, things should have just met up. Let's compute the distances
-          // between everything that just met.
-
-          if (tax.second.size() > 1) {
-
-            for (size_t i = 0; i < tax.second.size(); i++ ) {
-              for (size_t j = i+1; j < tax.second.size(); j++) {
-                for (int disti : tax.second[i]) {
-                  for (int distj : tax.second[j]) {
-                    // std::cout << "Adding " << disti << " and " << distj << std::endl;
-                    dists.push_back(disti+distj);
-                  }
-                }
-              }
-            }
-          }
-          // std::cout << "dists " << to_string(dists) << std::endl;
-          // Increment distances and stick them in new vector
-          emp::vector<int> new_dist_vec;
-          for (auto & vec : tax.second) {
-            for (int el : vec) {
-              new_dist_vec.push_back(el+1);
-            }
-          }
-
-          // std::cout << "new_dist_vec " << to_string(new_dist_vec) << std::endl;
-
-          next_pointers.erase(tax.first);
-
-          Ptr<taxon_t> test_taxon = tax.first->GetParent();
-          while (test_taxon && test_taxon->GetNumOff() == 1 && test_taxon->GetNumOrgs() < 0) {
-            if (!branch_only) {
-              for (size_t i = 0; i < new_dist_vec.size(); i++){
-                new_dist_vec[i]++;
-              }
-            }
-            test_taxon = test_taxon->GetParent();
-          }
-
-          if (!test_taxon) {
-            continue;
-          } else if (!Has(next_pointers, test_taxon)) {
-            next_pointers[test_taxon] = emp::vector<emp::vector<int> >({new_dist_vec});
-          } else {
-            next_pointers[test_taxon].push_back(new_dist_vec);
-          }
-        }
-        curr_pointers = next_pointers;
-        next_pointers.clear();
-        // std::cout << curr_pointers.size() << std::endl;
-      }
+    /** Calculates the distance between two active taxa in constant time (once the LCA index
+     *  is built).  Returns -1 if they are not in the same tree.
+     * */
+    int GetPairwiseDistance(Ptr<taxon_t> tax1, Ptr<taxon_t> tax2, bool branch_only=false) const {
+      return GetLCAIndex().GetDistance(tax1, tax2, branch_only);
+    }
 
-      if (dists.size() != (active_taxa.size()*(active_taxa.size()-1))/2) {
-        // The tree is not connected
-        // It's possible we should do something different here...
-        return dists;
+    /** Calculates distances between randomly chosen pairs of distinct active taxa, to estimate
+     *  pairwise statistics when enumerating all pairs is too slow.  Pairs in different trees
+     *  are skipped, so fewer than @param num_pairs distances may be returned.
+     * */
+    emp::vector<double> SamplePairwiseDistances(Random & random, size_t num_pairs, bool branch_only=false) const {
+      const TaxonLCAIndex<taxon_t> & index = GetLCAIndex();
+      emp::vector<double> dists;
+      const size_t num_taxa = active_taxa.size();
+      if (num_taxa < 2) return dists;
+      for (size_t i = 0; i < num_pairs; i++) {
+        const size_t id1 = random.GetUInt(num_taxa);
+        size_t id2 = random.GetUInt(num_taxa - 1);
+        if (id2 >= id1) id2++;
+        const int dist = index.GetDistance(active_taxa[id1], active_taxa[id2], branch_only);
+        if (dist >= 0) dists.push_back(dist);
       }
-
-      // std::cout << "Total: " << total << "Dists: " << dists.size() << std::endl;
-
       return dists;
+    }
 
+    /// Index for constant-time distance queries, rebuilt if the tree has changed.
+    const TaxonLCAIndex<taxon_t> & GetLCAIndex() const {
+      if (lca_version != tree_version) {
+        lca_index.Build(active_taxa, arena.GetNumIDs());
+        lca_version = tree_version;
+      }
+      return lca_index;
     }
 
 
@@ -997,10 +1581,17 @@ namespace emp {
   template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
   void Systematics<ORG, ORG_INFO, DATA_STRUCT>::Prune(Ptr<taxon_t> taxon) {
     on_prune_sig.Trigger(taxon);
+    tree_version++;
+    if (taxon == mrca) mrca = nullptr;
+    Ptr<taxon_t> parent = taxon->GetParent();
+    if (track_metrics && parent) {
+      UpdateLeafCounts(parent, false);
+      total_branch_length -= taxon->GetOriginationTime() - parent->GetOriginationTime();
+    }
     RemoveOffspring( taxon->GetParent() );           // Notify parent of the pruning.
     if (store_ancestors) ancestor_taxa.erase(taxon); // Clear from ancestors set (if there)
     if (store_outside) outside_taxa.insert(taxon);   // Add to outside set (if tracked)
-    else taxon.Delete();                             //  ...or else get rid of it.
+    else DeleteTaxon(taxon);                         //  ...or else get rid of it.
   }
 
   template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
@@ -1019,15 +1610,19 @@ namespace emp {
   void Systematics<ORG, ORG_INFO, DATA_STRUCT>::MarkExtinct(Ptr<taxon_t> taxon) {
     emp_assert(taxon);
     emp_assert(taxon->GetNumOrgs() == 0);
+    tree_version++;
+    taxon->SetDestructionTime((double) curr_update);
 
+    if (track_metrics) CountDistinctiveness(taxon, (size_t) taxon->GetTotalOffspring(), -1.0);
     if (taxon->GetParent()) {
       // Update extant descendant count for all ancestors
+      if (track_metrics) UpdateDistinctiveness(taxon->GetParent(), false);
       taxon->GetParent()->RemoveTotalOffspring();
     }
 
     if (store_active) active_taxa.erase(taxon);
     if (!archive) {   // If we don't archive taxa, delete them.
-      taxon.Delete();
+      DeleteTaxon(taxon);
       return;
     }
 
@@ -1036,6 +1631,76 @@ namespace emp {
   }
 
 
+  template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
+  size_t Systematics<ORG, ORG_INFO, DATA_STRUCT>::CollapseUnifurcations() {
+    emp_assert(store_ancestors, "Collapsing unifurcations requires stored ancestors.");
+
+    // Every collapsible taxon has exactly one offspring, which is active or an ancestor.
+    // Sets are reordered by removals, so work from a copy.
+    emp::vector<Ptr<taxon_t>> children(active_taxa.begin(), active_taxa.end());
+    children.insert(children.end(), ancestor_taxa.begin(), ancestor_taxa.end());
+    const size_t num_active = active_taxa.size();
+    emp::vector<Ptr<taxon_t>> removed;  // Deleted only after the pass, since children is checked.
+    size_t num_removed = 0;
+
+    for (size_t i = 0; i < children.size(); i++) {
+      Ptr<taxon_t> child = children[i];
+      // Skip any ancestor that was itself collapsed earlier in this pass.
+      if (i >= num_active && !ancestor_taxa.Has(child)) continue;
+      Ptr<taxon_t> parent = child->GetParent();
+      while (parent && parent->GetNumOrgs() == 0 && parent->GetNumOff() == 1 && parent != mrca) {
+        Ptr<taxon_t> grandparent = parent->GetParent();
+        // Child takes parent's place; offspring and leaf counts are unchanged, but the parent
+        // no longer counts in the balance indices (and the child may become a root).
+        if (track_metrics) {
+          CountBalance(parent, 1, -1.0);
+          CountBalance(child, child->GetNumOff(), -1.0);
+        }
+        child->SetParent(grandparent);
+        if (track_metrics) CountBalance(child, child->GetNumOff(), 1.0);
+        // Branch lengths add up along the line, unless the child is now a root with no branch.
+        if (track_metrics && !grandparent) total_branch_length -= child->GetOriginationTime() - parent->GetOriginationTime();
+        on_prune_sig.Trigger(parent);
+        ancestor_taxa.erase(parent);
+        if (store_outside) outside_taxa.insert(parent);
+        else removed.push_back(parent);
+        num_removed++;
+        parent = grandparent;
+      }
+    }
+    for (Ptr<taxon_t> taxon : removed) DeleteTaxon(taxon);
+    if (num_removed) tree_version++;
+    return num_removed;
+  }
+
+  template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
+  void Systematics<ORG, ORG_INFO, DATA_STRUCT>::UpdateLeafCounts(Ptr<taxon_t> parent, bool add) {
+    const size_t old_off = parent->GetNumOff();
+    const size_t new_off = add ? old_off + 1 : old_off - 1;
+    size_t old_leaves = parent->GetNumLeaves();
+
+    // The offspring being added or removed is a single leaf.  If the parent has no other
+    // offspring, it is itself a leaf on the other side of the change, so no counts above move.
+    const bool parent_is_leaf = (old_off == 0 || new_off == 0);
+    CountBalance(parent, old_off, -1.0);
+    parent->SetLeafCounts(parent_is_leaf ? 1 : (add ? old_leaves + 1 : old_leaves - 1),
+                          add ? parent->GetLeafSquareSum() + 1 : parent->GetLeafSquareSum() - 1);
+    CountBalance(parent, new_off, 1.0);
+    if (parent_is_leaf) return;
+
+    // Otherwise every further ancestor gains (or loses) a leaf below one of its offspring.
+    for (Ptr<taxon_t> taxon = parent->GetParent(); taxon; taxon = taxon->GetParent()) {
+      const size_t path_leaves = old_leaves;  // Old leaf count of the offspring on the path.
+      const size_t new_path_leaves = add ? path_leaves + 1 : path_leaves - 1;
+      old_leaves = taxon->GetNumLeaves();
+      CountBalance(taxon, taxon->GetNumOff(), -1.0);
+      taxon->SetLeafCounts(add ? old_leaves + 1 : old_leaves - 1,
+                           taxon->GetLeafSquareSum() + new_path_leaves * new_path_leaves
+                                                     - path_leaves * path_leaves);
+      CountBalance(taxon, taxon->GetNumOff(), 1.0);
+    }
+  }
+
   // Request a pointer to the Most-Recent Common Ancestor for the population.
   template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
   Ptr<typename Systematics<ORG, ORG_INFO, DATA_STRUCT>::taxon_t> Systematics<ORG, ORG_INFO, DATA_STRUCT>::GetMRCA() const {
@@ -1133,29 +1798,33 @@ namespace emp {
         mrca = nullptr;                                 // ...nix old common ancestor
       }
 
-      cur_taxon = NewPtr<taxon_t>(++next_id, info, parent);  // Build new taxon.
+      cur_taxon = NewTaxon(++next_id, info, parent);         // Build new taxon.
+      cur_taxon->SetOriginationTime(update);
+      tree_version++;
       on_new_sig.Trigger(cur_taxon);
       if (store_active) active_taxa.insert(cur_taxon);       // Store new taxon.
-      if (parent) parent->AddOffspring();                    // Track tree info.
-
-      cur_taxon->SetOriginationTime(update);
-    }
-
-    if (store_position && pos >= 0) {
-      if (next) {
-        if (pos >= (int)next_taxon_locations.size()) {
-          next_taxon_locations.resize(pos+1);
+      if (track_metrics) CountDistinctiveness(cur_taxon, 0, 1.0);
+      if (parent) {                                          // Track tree info.
+        if (track_metrics) {
+          UpdateLeafCounts(parent, true);
+          UpdateDistinctiveness(parent, true);
+          total_branch_length += update - parent->GetOriginationTime();
         }
-        next_taxon_locations[pos] = cur_taxon;
+        parent->AddOffspring();
 
-      } else {
-        if (pos >= (int)taxon_locations.size()) {
-          taxon_locations.resize(pos+1);
+        // All taxa shallower than the MRCA are its ancestors, so a new branch there replaces it.
+        if (mrca && (parent == mrca ? parent->GetNumOff() == 1
+                                    : parent->GetNumOff() == 2 && parent->GetDepth() < mrca->GetDepth())) {
+          mrca = nullptr;
         }
-        taxon_locations[pos] = cur_taxon;
       }
     }
 
+    if (store_position && pos >= 0) {
+      if (next) SetLocation(next_taxon_locations, pos, cur_taxon);
+      else SetLocation(taxon_locations, pos, cur_taxon);
+    }
+
     cur_taxon->AddOrg();                    // Record the current organism in its taxon.
     total_depth += cur_taxon->GetDepth();   // Track the total depth (for averaging)
     return cur_taxon;                       // Return the taxon used.
@@ -1166,8 +1835,8 @@ namespace emp {
   bool Systematics<ORG, ORG_INFO, DATA_STRUCT>::RemoveOrg(int pos) {
     emp_assert(store_position, "Trying to remove org based on position from systematics manager that doesn't track it.");
     emp_assert(pos < (int)taxon_locations.size(), "Invalid position requested for removal", pos, taxon_locations.size());
-    bool active = RemoveOrg(taxon_locations[pos]);
-    taxon_locations[pos] = nullptr;
+    bool active = RemoveOrg(LocationTaxon(taxon_locations[pos]));
+    taxon_locations[pos] = NO_TAXON;
     return active;
   }
 
@@ -1194,8 +1863,8 @@ namespace emp {
     emp_assert(store_position, "Trying to remove org based on position from systematics manager that doesn't track it.");
     emp_assert(pos < (int)next_taxon_locations.size(), "Invalid position requested for removal", pos, taxon_locations.size());
 
-    bool active = RemoveOrg(next_taxon_locations[pos]);
-    next_taxon_locations[pos] = nullptr;
+    bool active = RemoveOrg(LocationTaxon(next_taxon_locations[pos]));
+    next_taxon_locations[pos] = NO_TAXON;
     return active;
   }
 
@@ -1221,7 +1890,7 @@ namespace emp {
   template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
   Ptr<typename Systematics<ORG, ORG_INFO, DATA_STRUCT>::taxon_t> Systematics<ORG, ORG_INFO, DATA_STRUCT>::Parent(Ptr<taxon_t> taxon) const {
     emp_assert(taxon);
-    emp_assert(Has(active_taxa, taxon));
+    emp_assert(active_taxa.Has(taxon));
     return taxon->GetParent();
   }
 
@@ -1270,7 +1939,7 @@ namespace emp {
   // Calculate the genetic diversity of the population.
   template <typename ORG, typename ORG_INFO, typename DATA_STRUCT>
   double Systematics<ORG, ORG_INFO, DATA_STRUCT>::CalcDiversity() const {
-    return emp::Entropy(active_taxa, [](Ptr<taxon_t> x){ return x->GetNumOrgs(); }, (double) org_count);
+    return emp::Entropy(active_taxa.GetTaxa(), [](Ptr<taxon_t> x){ return x->GetNumOrgs(); }, (double) org_count);
   }
 
 }
@@ -20,36 +20,25 @@
 
 namespace emp {
 
-    /// Returns the total number of times a mutation of type @param type
-    /// that along @param taxon 's lineage. (Different from CountMuts in
-    /// that CountMuts sums them whereas CountMutSteps would count two
-    /// simultaneous mutations of the same type as one event)
+    /// Returns the number of taxa on @param taxon 's lineage, including itself.  (Taxa removed
+    /// by Systematics::CollapseUnifurcations() are still counted, since depth is unchanged.)
     template <typename taxon_t>
     int LineageLength(Ptr<taxon_t> taxon) {
-        int count = 0;
-
-        while (taxon) {
-            count++;
-            taxon = taxon->GetParent();
-        }
-
-        return count;
+        return (int) taxon->GetDepth() + 1;
     }
 
+    // The following lineage queries use totals that each taxon builds from its parent when
+    // it is created (see datastruct::mut_landscape_info), so they take constant time.
+
     /// Returns the total number of times a mutation of type @param type
     /// that along @param taxon 's lineage. (Different from CountMuts in
     /// that CountMuts sums them whereas CountMutSteps would count two
     /// simultaneous mutations of the same type as one event)
     template <typename taxon_t>
     int CountMutSteps(Ptr<taxon_t> taxon, std::string type="substitution") {
-        int count = 0;
-
-        while (taxon) {
-            count += (int)(taxon->GetData().mut_counts[type] > 0);
-            taxon = taxon->GetParent();
-        }
-
-        return count;
+        const int type_id = datastruct::MutationTypes::FindID(type);
+        if (type_id < 0) return 0;
+        return taxon->GetData().CountMutSteps((size_t) type_id);
     }
 
     /// Returns the total number of times a mutation of type @param type
@@ -59,14 +48,7 @@ namespace emp {
     template <typename taxon_t>
     int CountMutSteps(Ptr<taxon_t> taxon, emp::vector<std::string> types) {
         int count = 0;
-
-        while (taxon) {
-            for (std::string type : types) {
-                count += (int)(taxon->GetData().mut_counts[type] > 0);
-            }
-            taxon = taxon->GetParent();
-        }
-
+        for (const std::string & type : types) count += CountMutSteps(taxon, type);
         return count;
     }
 
@@ -74,14 +56,9 @@ namespace emp {
     /// along @param taxon 's lineage.
     template <typename taxon_t>
     int CountMuts(Ptr<taxon_t> taxon, std::string type="substitution") {
-        int count = 0;
-
-        while (taxon) {
-            count += taxon->GetData().mut_counts[type];
-            taxon = taxon->GetParent();
-        }
-
-        return count;
+        const int type_id = datastruct::MutationTypes::FindID(type);
+        if (type_id < 0) return 0;
+        return taxon->GetData().CountMuts((size_t) type_id);
     }
 
     /// Returns the total number of mutations of type @param type that occurred
@@ -89,14 +66,7 @@ namespace emp {
     template <typename taxon_t>
     int CountMuts(Ptr<taxon_t> taxon, emp::vector<std::string> types) {
         int count = 0;
-
-        while (taxon) {
-            for (std::string type : types) {
-                count += taxon->GetData().mut_counts[type];
-            }
-            taxon = taxon->GetParent();
-        }
-
+        for (const std::string & type : types) count += CountMuts(taxon, type);
         return count;
     }
 
@@ -106,36 +76,14 @@ namespace emp {
     /// that time point)
     template <typename taxon_t>
     int CountDeleteriousSteps(Ptr<taxon_t> taxon) {
-        int count = 0;
-        Ptr<taxon_t> parent = taxon->GetParent();
-
-        while (parent) {
-            if (taxon->GetData().GetFitness() < parent->GetData().GetFitness()) {
-                count++;
-            }
-            taxon = parent;
-            parent = taxon->GetParent();
-        }
-
-        return count;
+        return taxon->GetData().CountDeleteriousSteps();
     }
 
     /// Returns the total number of changes in phenotype that occurred
     /// along @param taxon 's lineage.
     template <typename taxon_t>
     int CountPhenotypeChanges(Ptr<taxon_t> taxon) {
-        int count = 0; // Start with current phenotype
-        Ptr<taxon_t> parent = taxon->GetParent();
-
-        while (parent) {
-            if (taxon->GetData().phenotype != parent->GetData().phenotype) {
-                count++;
-            }
-            taxon = parent;
-            parent = taxon->GetParent();
-        }
-
-        return count;
+        return taxon->GetData().CountPhenotypeChanges();
     }
 
     /// Returns the total number of unique phenotypes that occurred
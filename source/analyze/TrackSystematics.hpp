@@ -0,0 +1,240 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  TrackSystematics.hpp
+ *  @brief Module to maintain the phylogeny of all organisms as they are born and die.
+ *
+ *  Every placement, death, and swap in any population is recorded in a Systematics manager
+ *  (see Systematics.hpp).  Organisms are grouped into taxa by the value of 'taxon_trait' (or
+ *  by their full genome, from ToString(), if no trait is given); an offspring that differs
+ *  from its parent starts a new taxon.  Positions in all populations that exist at setup are
+ *  interleaved into a single position space (pos * num_pops + pop_id).
+ *
+ *  To keep memory bounded on long runs, taxa that are extinct and have no living descendants
+ *  are deleted (unless store_outside is set), and every 'collapse_updates' updates, extinct
+ *  taxa with only a single offspring taxon are removed from the tree, leaving only living
+ *  taxa and branch points.
+ *
+ *  Each update, the number of active, ancestral, and outside taxa, the number of independent
+ *  trees, and the estimated memory use (in KB) are recorded as time series named
+ *  "<module name>.num_active", etc. (see TimeSeries.hpp), and optionally printed, along with
+ *  phylogenetic diversity and MRCA depth.  If 'track_metrics' is set, the metrics that
+ *  Systematics maintains incrementally are recorded as well: mean evolutionary
+ *  distinctiveness and the Sackin, Colless, and cophenetic balance indices.  These require a
+ *  walk to the root on every birth and death, so they are off by default.
+ *
+ *  If 'export_file' is set, the full phylogeny can be kept on disk rather than in memory:
+ *  each taxon is appended to the file when it leaves the tree (when it is pruned or collapsed
+ *  away) and then freed, and all taxa still in the tree are appended at the end of the run.
+ *  Rows follow the ALife phylogeny standard (id, ancestor_list, origin_time,
+ *  destruction_time) followed by total_orgs, depth, and info; they are not in ID order.
+ *  build/rebuild_phylogeny.py sorts the stream (out of core) into an ALife-standard CSV or a
+ *  Newick tree.
+ */
+
+#ifndef MABE_TRACK_SYSTEMATICS_H
+#define MABE_TRACK_SYSTEMATICS_H
+
+#include <functional>
+#include <string>
+
+#include "emp/tools/string_utils.hpp"
+
+#include "../core/MABE.hpp"
+#include "../core/Module.hpp"
+#include "Systematics.hpp"
+
+namespace mabe {
+
+  class TrackSystematics : public Module {
+  public:
+    using sys_t = emp::Systematics<Organism, std::string>;
+    using taxon_t = emp::Taxon<std::string>;
+
+  private:
+    std::string taxon_trait = "";   ///< Trait that identifies taxa (empty for full genome).
+    bool store_outside = false;     ///< Keep taxa with no living descendants?
+    size_t collapse_updates = 10;   ///< Updates between collapsing unifurcations (0 for never).
+    bool print_status = false;      ///< Print taxa counts to the command line each update?
+    bool track_metrics = false;     ///< Record distinctiveness and balance indices each update?
+    std::string export_file = "";   ///< File to stream taxa to as they leave the tree.
+
+    sys_t systematics;
+    size_t taxon_trait_id = 0;
+    size_t num_pops = 0;                   ///< Populations being tracked.
+    emp::Ptr<taxon_t> new_taxon = nullptr; ///< Taxon of organism between BeforePlacement and OnPlacement.
+
+    int export_id = -1;                    ///< ID of export_file in the AsyncWriter.
+    std::string export_buffer;             ///< Rows waiting to be written to export_file.
+    std::function<void(emp::Ptr<taxon_t>)> export_fun;
+
+    /// Convert a position in any tracked population into a single systematics position.
+    int ToIndex(OrgPosition pos) const {
+      return (int) (pos.Pos() * num_pops + (size_t) pos.PopID());
+    }
+    bool IsTracked(OrgPosition pos) const {
+      return pos.IsValid() && (size_t) pos.PopID() < num_pops;
+    }
+
+    std::string CalcTaxonInfo(Organism & org) const {
+      if (taxon_trait.empty()) return org.ToString();
+      return org.GetTraitAsString(taxon_trait_id);
+    }
+
+    /// Add a row for a taxon to the export buffer.
+    void ExportTaxon(emp::Ptr<taxon_t> taxon) {
+      export_buffer += emp::to_string(taxon->GetID());
+      if (taxon->GetParentID()) export_buffer += ",[" + emp::to_string(taxon->GetParentID()) + "],";
+      else export_buffer += ",[NONE],";
+      export_buffer += emp::to_string(taxon->GetOriginationTime()) + ','
+                     + emp::to_string(taxon->GetDestructionTime()) + ','
+                     + emp::to_string(taxon->GetTotOrgs()) + ','
+                     + emp::to_string(taxon->GetDepth()) + ',';
+
+      // Quote the info if needed, doubling any quotes inside it.
+      const std::string & info = taxon->GetInfo();
+      if (info.find_first_of(",\"\n") == std::string::npos) export_buffer += info;
+      else {
+        export_buffer += '"';
+        for (char c : info) {
+          if (c == '"') export_buffer += '"';
+          export_buffer += c;
+        }
+        export_buffer += '"';
+      }
+      export_buffer += '\n';
+    }
+
+    void FlushExport() {
+      if (export_id < 0 || export_buffer.empty()) return;
+      control.GetAsyncWriter().Write((size_t) export_id, std::move(export_buffer));
+      export_buffer.clear();
+    }
+
+  public:
+    TrackSystematics(mabe::MABE & control,
+                     const std::string & name="TrackSystematics",
+                     const std::string & desc="Module to track the phylogeny of all organisms.")
+      : Module(control, name, desc)
+      , systematics([this](Organism & org){ return CalcTaxonInfo(org); })
+    {
+      SetAnalyzeMod();
+    }
+    ~TrackSystematics() { }
+
+    const sys_t & GetSystematics() const { return systematics; }
+    sys_t & GetSystematics() { return systematics; }
+
+    void SetupConfig() override {
+      LinkVar(taxon_trait, "taxon_trait", "Trait that identifies a taxon (empty to use the whole genome).");
+      LinkVar(store_outside, "store_outside", "Keep taxa with no living descendants? (memory grows with births)");
+      LinkVar(collapse_updates, "collapse_updates", "Updates between removing extinct, non-branching ancestors (0 = never).");
+      LinkVar(print_status, "print_status", "Print taxa counts and memory use each update?");
+      LinkVar(track_metrics, "track_metrics", "Record mean distinctiveness and balance indices? (slows births)");
+      LinkVar(export_file, "export_file", "File to stream taxa to as they leave the tree (empty for none).");
+    }
+
+    void SetupModule() override {
+      num_pops = control.GetNumPopulations();
+      systematics.SetStoreOutside(store_outside);
+      systematics.SetTrackMetrics(track_metrics);
+
+      if (export_file.size()) {
+        export_id = control.GetAsyncWriter().Open(export_file, false);
+        if (export_id < 0) {
+          AddError("TrackSystematics unable to open export_file '", export_file, "'.");
+          return;
+        }
+        control.GetAsyncWriter().Write((size_t) export_id,
+          "id,ancestor_list,origin_time,destruction_time,total_orgs,depth,info\n");
+        export_fun = [this](emp::Ptr<taxon_t> taxon){ ExportTaxon(taxon); };
+        systematics.OnPrune(export_fun);
+      }
+    }
+
+    void SetupDataMap(emp::DataMap & data_map) override {
+      if (taxon_trait.empty()) return;
+      if (!data_map.HasName(taxon_trait)) {
+        AddError("TrackSystematics: unknown taxon_trait '", taxon_trait, "'.");
+        return;
+      }
+      taxon_trait_id = data_map.GetID(taxon_trait);
+    }
+
+    void BeforePlacement(Organism & org, OrgPosition pos, OrgPosition ppos) override {
+      if (!IsTracked(pos)) return;
+      emp::Ptr<taxon_t> parent = nullptr;
+      if (IsTracked(ppos) && systematics.HasTaxonAt(ToIndex(ppos))) {
+        parent = systematics.GetTaxonAt(ToIndex(ppos));
+      }
+      // Add the organism now, while its parent's taxon is certain to exist (placement may
+      // replace the parent); its position is recorded once it is in place.
+      new_taxon = systematics.AddOrg(org, -1, parent, (int) control.GetUpdate());
+    }
+
+    void OnPlacement(OrgPosition pos) override {
+      if (!new_taxon) return;
+      systematics.SetTaxonAt(ToIndex(pos), new_taxon);
+      new_taxon = nullptr;
+    }
+
+    void BeforeDeath(OrgPosition pos) override {
+      if (IsTracked(pos) && systematics.HasTaxonAt(ToIndex(pos))) {
+        systematics.SetUpdate(control.GetUpdate());  // In case the taxon goes extinct.
+        systematics.RemoveOrg(ToIndex(pos));
+      }
+    }
+
+    void OnSwap(OrgPosition pos1, OrgPosition pos2) override {
+      if (IsTracked(pos1) && IsTracked(pos2)) {
+        systematics.SwapPositions(ToIndex(pos1), ToIndex(pos2));
+      }
+    }
+
+    void OnUpdate(size_t ud) override {
+      systematics.Update();
+      if (collapse_updates && ud % collapse_updates == 0) systematics.CollapseUnifurcations();
+
+      const double memory_kb = (double) systematics.GetMemoryUse() / 1024.0;
+      control.RecordSample(GetName() + ".num_active", (double) systematics.GetNumActive());
+      control.RecordSample(GetName() + ".num_ancestors", (double) systematics.GetNumAncestors());
+      control.RecordSample(GetName() + ".num_outside", (double) systematics.GetNumOutside());
+      control.RecordSample(GetName() + ".num_roots", (double) systematics.GetNumRoots());
+      control.RecordSample(GetName() + ".memory_kb", memory_kb);
+      control.RecordSample(GetName() + ".phylogenetic_diversity", (double) systematics.GetPhylogeneticDiversity());
+      control.RecordSample(GetName() + ".mrca_depth", (double) systematics.GetMRCADepth());
+      if (track_metrics) {
+        control.RecordSample(GetName() + ".mean_distinctiveness", systematics.GetMeanEvolutionaryDistinctiveness((double) ud));
+        control.RecordSample(GetName() + ".sackin", systematics.GetSackinIndex());
+        control.RecordSample(GetName() + ".colless", systematics.GetCollessIndex());
+        control.RecordSample(GetName() + ".cophenetic", systematics.GetCopheneticIndex());
+      }
+
+      FlushExport();
+
+      if (print_status) {
+        std::cout << "Systematics: active=" << systematics.GetNumActive()
+                  << " ancestors=" << systematics.GetNumAncestors()
+                  << " outside=" << systematics.GetNumOutside()
+                  << " roots=" << systematics.GetNumRoots()
+                  << " memory=" << memory_kb << "KB" << std::endl;
+      }
+    }
+
+    void BeforeExit() override {
+      if (export_id < 0) return;
+      // Taxa still in the tree complete the exported phylogeny.
+      for (emp::Ptr<taxon_t> taxon : systematics.GetActive()) ExportTaxon(taxon);
+      for (emp::Ptr<taxon_t> taxon : systematics.GetAncestors()) ExportTaxon(taxon);
+      FlushExport();
+      control.GetAsyncWriter().Close((size_t) export_id);
+      export_id = -1;
+    }
+  };
+
+  MABE_REGISTER_MODULE(TrackSystematics, "Track the phylogeny of all organisms.");
+}
+
+#endif
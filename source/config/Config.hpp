@@ -279,6 +279,33 @@ namespace mabe {
       events_map[name].TriggerAll();
     }
 
+    /// Save the state of all event queues in binary form.
+    void SaveEventState(std::ostream & os) const {
+      const uint64_t num_types = events_map.size();
+      os.write((const char *) &num_types, sizeof(num_types));
+      for (const auto & [name, events] : events_map) {
+        const uint64_t name_size = name.size();
+        os.write((const char *) &name_size, sizeof(name_size));
+        os.write(name.data(), (std::streamsize) name_size);
+        events.SaveState(os);
+      }
+    }
+
+    /// Restore the state of event queues saved with SaveEventState(); return success.
+    bool LoadEventState(std::istream & is) {
+      uint64_t num_types = 0;
+      is.read((char *) &num_types, sizeof(num_types));
+      for (uint64_t i = 0; i < num_types && is; i++) {
+        uint64_t name_size = 0;
+        is.read((char *) &name_size, sizeof(name_size));
+        std::string name(name_size, '\0');
+        is.read(name.data(), (std::streamsize) name_size);
+        if (!emp::Has(events_map, name)) return false;
+        if (!events_map[name].LoadState(is)) return false;
+      }
+      return (bool) is;
+    }
+
     /// Print all of the events to the provided stream.
     void PrintEvents(std::ostream & os) const {
       for (const auto & x : events_map) {
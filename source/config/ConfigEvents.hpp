@@ -15,10 +15,14 @@
 #ifndef MABE_CONFIG_EVENTS_H
 #define MABE_CONFIG_EVENTS_H
 
+#include <cstdint>
+#include <istream>
+#include <ostream>
 #include <string>
 
 #include "emp/base/map.hpp"
 #include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
 
 #include "ConfigAST.hpp"
 
@@ -136,6 +140,49 @@ namespace mabe {
       }
     }
 
+    /// Save the timing of all pending events in binary form.  Actions are not saved; they are
+    /// rebuilt (with the same IDs) when the same configuration is loaded again.
+    void SaveState(std::ostream & os) const {
+      const uint64_t num_events = queue.size();
+      os.write((const char *) &cur_value, sizeof(cur_value));
+      os.write((const char *) &num_events, sizeof(num_events));
+      for (const auto & x : queue) {
+        const uint64_t event_id = x.second->id;
+        os.write((const char *) &event_id, sizeof(event_id));
+        os.write((const char *) &(x.second->next), sizeof(x.second->next));
+      }
+    }
+
+    /// Restore event timings from SaveState(); events missing from the saved state had already
+    /// finished, so they are removed.
+    bool LoadState(std::istream & is) {
+      double in_value = 0.0;
+      uint64_t num_events = 0;
+      is.read((char *) &in_value, sizeof(in_value));
+      is.read((char *) &num_events, sizeof(num_events));
+      emp::map<size_t, double> next_map;
+      for (uint64_t i = 0; i < num_events && is; i++) {
+        uint64_t event_id = 0;
+        double next = 0.0;
+        is.read((char *) &event_id, sizeof(event_id));
+        is.read((char *) &next, sizeof(next));
+        next_map[(size_t) event_id] = next;
+      }
+      if (!is) return false;
+
+      // Pull all of the events out of the queue and put back only those still pending.
+      emp::vector<emp::Ptr<TimedEvent>> events;
+      while (queue.size()) events.push_back(PopEvent());
+      for (emp::Ptr<TimedEvent> cur_event : events) {
+        auto it = next_map.find(cur_event->id);
+        if (it == next_map.end()) { cur_event.Delete(); continue; }
+        cur_event->next = it->second;
+        AddEvent(cur_event);
+      }
+      cur_value = in_value;
+      return true;
+    }
+
     /// Print all of the events being tracked here.
     void Write(const std::string & command, std::ostream & os) const {
       for (const auto & x : queue) {
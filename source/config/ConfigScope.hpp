@@ -212,6 +212,33 @@ namespace mabe {
       return *this;
     }
 
+    /// Collect the current value of every variable in this scope (and all sub-scopes), named
+    /// by its full path (e.g., "select.tournament_size").
+    void CollectValues(emp::vector<std::pair<std::string,std::string>> & values,
+                       const std::string & prefix="") const {
+      for (auto x : entry_list) {
+        if (x->IsFunction() || x->IsError()) continue;
+        const std::string path = prefix + x->GetName();
+        if (x->IsScope()) x->AsScopePtr()->CollectValues(values, path + ".");
+        else values.emplace_back(path, x->AsString());
+      }
+    }
+
+    /// Set a variable using a path produced by CollectValues(); return false if not found.
+    bool SetValueByPath(const std::string & path, const std::string & value) {
+      const size_t dot_pos = path.find('.');
+      auto it = entry_map.find(path.substr(0, dot_pos));
+      if (it == entry_map.end()) return false;
+      emp::Ptr<ConfigEntry> entry = it->second;
+      if (dot_pos == std::string::npos) {
+        if (entry->IsScope() || entry->IsFunction()) return false;
+        entry->SetString(value);
+        return true;
+      }
+      if (!entry->IsScope()) return false;
+      return entry->AsScopePtr()->SetValueByPath(path.substr(dot_pos+1), value);
+    }
+
     /// Make a copy of this scope and all of the entries inside it.
     entry_ptr_t Clone() const override { return emp::NewPtr<ConfigScope>(*this); }
   };
@@ -0,0 +1,341 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  AsyncWriter.hpp
+ *  @brief A shared service that moves file output off of the update thread.
+ *
+ *  Modules open files through the writer and then hand it blocks of text or binary data.
+ *  Each block is placed in a fixed-size lock-free ring buffer; a dedicated I/O thread drains
+ *  the ring, gathers blocks for each file into large buffers, and writes those buffers out
+ *  when they fill, every `flush_ms` milliseconds, or when Flush() or Stop() is called.
+ *
+ *  The ring has a single producer: Open(), Write(), Flush(), and Close() must all be called
+ *  from the main (update) thread.  If the ring is full, the producer waits for the I/O thread
+ *  to catch up; these stalls are recorded in the statistics (along with the deepest the queue
+ *  has been) so that it is possible to see when the disk cannot keep up with the run.
+ */
+
+#ifndef MABE_ASYNC_WRITER_H
+#define MABE_ASYNC_WRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+
+namespace mabe {
+
+  class AsyncWriter {
+  public:
+    struct Stats {
+      size_t num_blocks = 0;       ///< Blocks handed to the writer.
+      size_t num_bytes = 0;        ///< Total bytes handed to the writer.
+      size_t num_stalls = 0;       ///< Times a block had to wait for space in the ring.
+      double stall_ms = 0.0;       ///< Total time spent waiting for space in the ring.
+      size_t max_depth = 0;        ///< Most blocks ever waiting in the ring.
+      double flush_wait_ms = 0.0;  ///< Total time spent waiting for requested flushes.
+      size_t num_writes = 0;       ///< Buffer writes performed by the I/O thread.
+      double write_ms = 0.0;       ///< Time the I/O thread spent writing.
+    };
+
+  private:
+    enum class CommandType { OPEN, WRITE, FLUSH, CLOSE, STOP };
+
+    struct Command {
+      CommandType type = CommandType::WRITE;
+      size_t file_id = 0;
+      std::string data;                     ///< Data to write (for WRITE).
+      emp::Ptr<std::ofstream> file;         ///< Newly opened file (for OPEN).
+      size_t flush_id = 0;                  ///< Which flush request is this (for FLUSH).
+    };
+
+    struct FileState {
+      emp::Ptr<std::ofstream> file;
+      std::string buffer;                   ///< Data waiting to be written.
+    };
+
+    // --- Ring buffer shared between the producer and the I/O thread ---
+    emp::vector<Command> ring;
+    size_t ring_mask = 0;
+    std::atomic<size_t> head{0};            ///< Next slot to fill (only changed by producer)
+    std::atomic<size_t> tail{0};            ///< Next slot to drain (only changed by I/O thread)
+
+    // --- Synchronization for sleeping and for blocking flushes ---
+    std::mutex mutex;
+    std::condition_variable wake_cv;        ///< Wake the I/O thread when new data arrives.
+    std::condition_variable done_cv;        ///< Notify the producer when a flush completes.
+    std::atomic<bool> io_sleeping{false};
+    size_t flush_requested = 0;             ///< Last flush requested (producer only).
+    size_t flush_done = 0;                  ///< Last flush completed (protected by mutex).
+
+    // --- Producer-side state ---
+    std::thread io_thread;
+    bool running = false;
+    size_t next_file_id = 0;
+    std::unordered_map<size_t, uint64_t> file_pos;  ///< Bytes in each file, once written.
+    Stats stats;
+
+    // --- I/O thread state ---
+    std::unordered_map<size_t, FileState> files;
+    size_t buffer_size = 1 << 20;           ///< Write a file's buffer out once this full.
+    double flush_ms = 1000.0;               ///< Write out all buffers at least this often.
+    std::atomic<size_t> num_writes{0};
+    std::atomic<uint64_t> write_ns{0};
+
+    using clock_t = std::chrono::steady_clock;
+
+    static double ElapsedMS(clock_t::time_point start) {
+      return std::chrono::duration<double, std::milli>(clock_t::now() - start).count();
+    }
+
+    /// Place a command in the ring, waiting for space if needed.
+    void Push(Command && cmd) {
+      if (!running) Start();
+
+      const size_t cur_head = head.load(std::memory_order_relaxed);
+      if (cur_head - tail.load(std::memory_order_acquire) >= ring.size()) {
+        stats.num_stalls++;
+        const auto stall_start = clock_t::now();
+        while (cur_head - tail.load(std::memory_order_acquire) >= ring.size()) {
+          Wake();
+          std::this_thread::yield();
+        }
+        stats.stall_ms += ElapsedMS(stall_start);
+      }
+
+      ring[cur_head & ring_mask] = std::move(cmd);
+      head.store(cur_head + 1);
+
+      const size_t depth = cur_head + 1 - tail.load(std::memory_order_relaxed);
+      if (depth > stats.max_depth) stats.max_depth = depth;
+      if (io_sleeping.load()) Wake();
+    }
+
+    void Wake() {
+      std::lock_guard<std::mutex> lock(mutex);
+      wake_cv.notify_one();
+    }
+
+    /// Write out any buffered data for a single file.
+    void WriteBuffer(FileState & state, bool flush_stream) {
+      if (state.buffer.size()) {
+        const auto write_start = clock_t::now();
+        state.file->write(state.buffer.data(), (std::streamsize) state.buffer.size());
+        if (flush_stream) state.file->flush();
+        state.buffer.resize(0);
+        num_writes++;
+        write_ns += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - write_start).count();
+      }
+      else if (flush_stream) state.file->flush();
+    }
+
+    void WriteAll(bool flush_stream) {
+      for (auto & [id, state] : files) WriteBuffer(state, flush_stream);
+    }
+
+    /// Main loop for the I/O thread.
+    void RunIO() {
+      auto last_flush = clock_t::now();
+      bool stop = false;
+
+      while (!stop) {
+        const size_t cur_tail = tail.load(std::memory_order_relaxed);
+        if (cur_tail == head.load(std::memory_order_acquire)) {
+          if (ElapsedMS(last_flush) >= flush_ms) {
+            WriteAll(true);
+            last_flush = clock_t::now();
+          }
+          // Nothing to do; sleep until more data arrives or it is time to flush.
+          std::unique_lock<std::mutex> lock(mutex);
+          io_sleeping = true;
+          if (cur_tail == head.load()) {
+            wake_cv.wait_for(lock, std::chrono::duration<double, std::milli>(flush_ms));
+          }
+          io_sleeping = false;
+          continue;
+        }
+
+        Command cmd = std::move(ring[cur_tail & ring_mask]);
+        ring[cur_tail & ring_mask] = Command();
+        tail.store(cur_tail + 1, std::memory_order_release);
+
+        switch (cmd.type) {
+        case CommandType::OPEN:
+          files[cmd.file_id].file = cmd.file;
+          break;
+        case CommandType::WRITE: {
+          FileState & state = files[cmd.file_id];
+          if (state.buffer.empty() && cmd.data.size() >= buffer_size) state.buffer = std::move(cmd.data);
+          else state.buffer += cmd.data;
+          if (state.buffer.size() >= buffer_size) WriteBuffer(state, false);
+          break;
+        }
+        case CommandType::FLUSH: {
+          WriteAll(true);
+          last_flush = clock_t::now();
+          std::lock_guard<std::mutex> lock(mutex);
+          flush_done = cmd.flush_id;
+          done_cv.notify_all();
+          break;
+        }
+        case CommandType::CLOSE: {
+          FileState & state = files[cmd.file_id];
+          WriteBuffer(state, true);
+          state.file->close();
+          state.file.Delete();
+          files.erase(cmd.file_id);
+          break;
+        }
+        case CommandType::STOP:
+          stop = true;
+          break;
+        }
+      }
+
+      // Close anything left open.
+      for (auto & [id, state] : files) {
+        WriteBuffer(state, true);
+        state.file.Delete();
+      }
+      files.clear();
+    }
+
+  public:
+    AsyncWriter(size_t ring_size=1024) {
+      size_t capacity = 1;
+      while (capacity < ring_size) capacity <<= 1;
+      ring.resize(capacity);
+      ring_mask = capacity - 1;
+    }
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter & operator=(const AsyncWriter &) = delete;
+    ~AsyncWriter() { Stop(); }
+
+    /// Bytes to gather for a file before writing it out (only changeable before starting)
+    void SetBufferSize(size_t in_size) { emp_assert(!running); buffer_size = in_size; }
+
+    /// Maximum time to hold data before writing it out (only changeable before starting)
+    void SetFlushInterval(double in_ms) { emp_assert(!running); flush_ms = in_ms; }
+
+    bool IsRunning() const { return running; }
+
+    /// Start the I/O thread (done automatically when first needed).
+    void Start() {
+      if (running) return;
+      running = true;
+      io_thread = std::thread([this](){ RunIO(); });
+    }
+
+    /// Write out everything, close all files, and end the I/O thread.
+    void Stop() {
+      if (!running) return;
+      Command cmd;
+      cmd.type = CommandType::STOP;
+      Push(std::move(cmd));
+      io_thread.join();
+      running = false;
+      stats.num_writes = num_writes;
+      stats.write_ms = (double) write_ns / 1000000.0;
+    }
+
+    /// Open a file for output, returning its ID (or -1 if it could not be opened).
+    int Open(const std::string & filename, bool append=false) {
+      auto mode = std::ios::binary | (append ? std::ios::app : std::ios::trunc);
+      emp::Ptr<std::ofstream> file = emp::NewPtr<std::ofstream>(filename, mode);
+      if (!*file) {
+        file.Delete();
+        return -1;
+      }
+
+      const size_t file_id = next_file_id++;
+      std::error_code ec;
+      file_pos[file_id] = append ? (uint64_t) std::filesystem::file_size(filename, ec) : 0;
+      if (ec) file_pos[file_id] = 0;
+
+      Command cmd;
+      cmd.type = CommandType::OPEN;
+      cmd.file_id = file_id;
+      cmd.file = file;
+      Push(std::move(cmd));
+      return (int) file_id;
+    }
+
+    /// Queue data to be written to a file.
+    void Write(size_t file_id, std::string data) {
+      emp_assert(file_pos.count(file_id), file_id);
+      if (data.empty()) return;
+      file_pos[file_id] += data.size();
+      stats.num_blocks++;
+      stats.num_bytes += data.size();
+
+      Command cmd;
+      cmd.type = CommandType::WRITE;
+      cmd.file_id = file_id;
+      cmd.data = std::move(data);
+      Push(std::move(cmd));
+    }
+
+    /// Wait until everything queued so far has been written out to all files.
+    void Flush() {
+      if (!running) return;
+      const auto flush_start = clock_t::now();
+      Command cmd;
+      cmd.type = CommandType::FLUSH;
+      cmd.flush_id = ++flush_requested;
+      Push(std::move(cmd));
+
+      std::unique_lock<std::mutex> lock(mutex);
+      done_cv.wait(lock, [this](){ return flush_done >= flush_requested; });
+      stats.flush_wait_ms += ElapsedMS(flush_start);
+    }
+
+    /// Write out any remaining data for a file and close it.
+    void Close(size_t file_id) {
+      emp_assert(file_pos.count(file_id), file_id);
+      file_pos.erase(file_id);
+      Command cmd;
+      cmd.type = CommandType::CLOSE;
+      cmd.file_id = file_id;
+      Push(std::move(cmd));
+    }
+
+    /// Size a file will have once everything queued for it so far has been written.
+    uint64_t GetFilePos(size_t file_id) const {
+      auto it = file_pos.find(file_id);
+      return (it == file_pos.end()) ? 0 : it->second;
+    }
+
+    /// Current statistics; the I/O thread counts are only final once the writer is stopped.
+    Stats GetStats() const {
+      Stats out = stats;
+      out.num_writes = num_writes;
+      out.write_ms = (double) write_ns / 1000000.0;
+      return out;
+    }
+
+    /// Print a summary of the output statistics.
+    void PrintStats(std::ostream & os) const {
+      const Stats cur = GetStats();
+      os << "Output: " << cur.num_blocks << " blocks (" << cur.num_bytes << " bytes) in "
+         << cur.num_writes << " writes taking " << cur.write_ms << " ms; "
+         << cur.num_stalls << " stalls waiting " << cur.stall_ms << " ms for the disk; "
+         << "max queue depth " << cur.max_depth << " of " << ring.size() << "; "
+         << "flushes waited " << cur.flush_wait_ms << " ms." << std::endl;
+    }
+  };
+
+}
+
+#endif
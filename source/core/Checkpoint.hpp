@@ -0,0 +1,411 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  Checkpoint.hpp
+ *  @brief Tools for reading and writing binary checkpoint files.
+ *
+ *  A checkpoint captures everything needed to continue a run exactly: the update, a fresh
+ *  random number seed (the master generator is reseeded at each checkpoint), the current
+ *  value of every config variable, the state of all config event queues, the internal state
+ *  of each module, and every organism (genome plus trait values) in every population.
+ *
+ *  File layout (version 1; values use the byte order of the machine that wrote them):
+ *
+ *    Header   : char[8] "MABECKPT", uint32 version, uint32 reserved,
+ *               uint64 update, int64 random seed, uint64 section count
+ *    Sections : char[4] tag, uint32 reserved, uint64 payload size, payload (padded to 8 bytes)
+ *
+ *  Section tags, in order:
+ *    "CONF" : Path and value of each config variable, followed by all event queue timings.
+ *    "TRTS" : Name and encoding of each organism trait.
+ *    "MODS" : Name of each module along with the blob written by its SerializeState().
+ *    "POPS" : One per population: name, size, names of the organism types present, a table
+ *             of record offsets (one uint64 per position, 8-byte aligned; ~0 for empty cells),
+ *             and then one 8-byte-aligned record per organism: uint32 type index,
+ *             uint32 reserved, uint64 genome size, genome (from Organism::Serialize()), and
+ *             then trait values in "TRTS" order.
+ *
+ *  Since each organism record can be located directly from the offset table, loading maps the
+ *  file into memory and deserializes organisms straight from the mapped pages.
+ *
+ *  Integer traits are stored as int64 or uint64 (so large counters and IDs are restored
+ *  exactly) and all other arithmetic traits as doubles; strings, BitVectors, and vectors of
+ *  doubles are also stored exactly.  Traits of any other type are not saved (and will have
+ *  their default value after a restore).
+ */
+
+#ifndef MABE_CHECKPOINT_H
+#define MABE_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "emp/base/vector.hpp"
+#include "emp/bits/BitVector.hpp"
+#include "emp/meta/TypeID.hpp"
+
+#include "Organism.hpp"
+
+namespace mabe {
+
+  constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+  /// Fixed-size header at the beginning of every checkpoint file.
+  struct CheckpointHeader {
+    char magic[8] = {'M','A','B','E','C','K','P','T'};
+    uint32_t version = CHECKPOINT_VERSION;
+    uint32_t reserved = 0;
+    uint64_t update = 0;
+    int64_t random_seed = 0;
+    uint64_t num_sections = 0;
+
+    bool IsValid() const { return std::memcmp(magic, "MABECKPT", 8) == 0; }
+  };
+
+  // ---=== Binary stream helpers ===---
+
+  template <typename T>
+  void WriteBinary(std::ostream & os, const T & value) {
+    static_assert(std::is_trivially_copyable<T>(), "WriteBinary requires a trivially copyable type.");
+    os.write((const char *) &value, sizeof(T));
+  }
+
+  template <typename T>
+  bool ReadBinary(std::istream & is, T & value) {
+    static_assert(std::is_trivially_copyable<T>(), "ReadBinary requires a trivially copyable type.");
+    return (bool) is.read((char *) &value, sizeof(T));
+  }
+
+  inline void WriteBinaryString(std::ostream & os, const std::string & str) {
+    WriteBinary<uint64_t>(os, str.size());
+    os.write(str.data(), (std::streamsize) str.size());
+  }
+
+  /// Are at least num_bytes left to read?  Checkpoints (and migrated organisms) are always read
+  /// from memory, so sizes stored in them can be checked before anything is allocated.
+  inline bool HasBytesLeft(std::istream & is, uint64_t num_bytes) {
+    const std::streamsize avail = is.rdbuf()->in_avail();
+    if (avail >= 0 && num_bytes <= (uint64_t) avail) return true;
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+
+  inline bool ReadBinaryString(std::istream & is, std::string & str) {
+    uint64_t str_size = 0;
+    if (!ReadBinary(is, str_size) || !HasBytesLeft(is, str_size)) return false;
+    str.resize(str_size);
+    return (bool) is.read(str.data(), (std::streamsize) str_size);
+  }
+
+  /// Pad the output with zeros to the next 8-byte boundary.
+  inline void WriteAlignment(std::ostream & os) {
+    const size_t pos = (size_t) os.tellp();
+    for (size_t i = pos; i % 8; i++) os.put('\0');
+  }
+
+  inline size_t AlignCheckpointPos(size_t pos) { return (pos + 7) & ~((size_t) 7); }
+
+  /// Start a new section; returns the position where its payload begins.
+  inline std::streampos BeginCheckpointSection(std::ostream & os, const char * tag) {
+    os.write(tag, 4);
+    WriteBinary<uint32_t>(os, 0);
+    WriteBinary<uint64_t>(os, 0);        // Payload size; filled in by EndCheckpointSection()
+    return os.tellp();
+  }
+
+  /// Finish a section by filling in its payload size and padding its end.
+  inline void EndCheckpointSection(std::ostream & os, std::streampos payload_start) {
+    const std::streampos payload_end = os.tellp();
+    os.seekp(payload_start - (std::streamoff) sizeof(uint64_t));
+    WriteBinary<uint64_t>(os, (uint64_t) (payload_end - payload_start));
+    os.seekp(payload_end);
+    WriteAlignment(os);
+  }
+
+  /// A read-only stream buffer over a region of memory (such as a mapped checkpoint file).
+  class MemoryInBuf : public std::streambuf {
+  public:
+    MemoryInBuf(const char * start, size_t size) {
+      char * ptr = const_cast<char *>(start);
+      setg(ptr, ptr, ptr + size);
+    }
+
+    /// How many bytes have been read so far?
+    size_t GetPos() const { return (size_t) (gptr() - eback()); }
+  };
+
+
+  /// Current resident memory of this process in kilobytes (or 0 if unavailable).
+  inline size_t GetResidentMemoryKB() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) return 0;
+    return resident_pages * (size_t) sysconf(_SC_PAGESIZE) / 1024;
+  }
+
+
+  // ---=== Organism trait encoding ===---
+
+  enum class TraitEncoding : uint8_t { NUMERIC=0, STRING, BITS, VALUES, UNSUPPORTED,
+                                       SIGNED, UNSIGNED };
+
+  /// Is the provided type one of those listed?
+  template <typename... Ts>
+  bool IsTypeOneOf(emp::TypeID type) { return ((type == emp::GetTypeID<Ts>()) || ...); }
+
+  inline TraitEncoding GetTraitEncoding(emp::TypeID type) {
+    if (IsTypeOneOf<int, long, long long, short, signed char>(type)) return TraitEncoding::SIGNED;
+    if (IsTypeOneOf<unsigned int, unsigned long, unsigned long long, unsigned short,
+                    unsigned char>(type)) return TraitEncoding::UNSIGNED;
+    if (type.IsArithmetic()) return TraitEncoding::NUMERIC;
+    if (type == emp::GetTypeID<std::string>()) return TraitEncoding::STRING;
+    if (type == emp::GetTypeID<emp::BitVector>()) return TraitEncoding::BITS;
+    if (type == emp::GetTypeID<emp::vector<double>>()) return TraitEncoding::VALUES;
+    return TraitEncoding::UNSUPPORTED;
+  }
+
+  /// Can a value saved with the first encoding be restored into a trait with the second?
+  /// (Any arithmetic value can be loaded into any arithmetic trait.)
+  inline bool IsEncodingCompatible(TraitEncoding saved, TraitEncoding current) {
+    auto is_numeric = [](TraitEncoding encoding){
+      return encoding == TraitEncoding::NUMERIC || encoding == TraitEncoding::SIGNED ||
+             encoding == TraitEncoding::UNSIGNED;
+    };
+    return saved == current || (is_numeric(saved) && is_numeric(current));
+  }
+
+  /// Set a numeric trait from a stored value, whatever its arithmetic type.
+  template <typename T, typename... EXTRA_Ts, typename VAL_T>
+  bool SetNumericTrait(Organism & org, size_t trait_id, VAL_T value) {
+    if (org.TestTraitType<T>(trait_id)) {
+      org.SetTrait<T>(trait_id, (T) value);
+      return true;
+    }
+    if constexpr (sizeof...(EXTRA_Ts) > 0) return SetNumericTrait<EXTRA_Ts...>(org, trait_id, value);
+    else return false;
+  }
+
+  /// Set any arithmetic trait from a stored value.
+  template <typename VAL_T>
+  bool SetArithmeticTrait(Organism & org, size_t trait_id, VAL_T value) {
+    return SetNumericTrait<double, float, int, unsigned int, long, unsigned long,
+                           long long, unsigned long long, short, unsigned short,
+                           char, signed char, unsigned char, bool>(org, trait_id, value);
+  }
+
+  /// Get an integer trait at full precision, whatever its integer type.
+  template <typename VAL_T, typename T, typename... EXTRA_Ts>
+  VAL_T GetIntegerTrait(const Organism & org, size_t trait_id) {
+    if (org.TestTraitType<T>(trait_id)) return (VAL_T) org.GetTrait<T>(trait_id);
+    if constexpr (sizeof...(EXTRA_Ts) > 0) return GetIntegerTrait<VAL_T, EXTRA_Ts...>(org, trait_id);
+    else return 0;
+  }
+
+  inline void WriteTrait(std::ostream & os, const Organism & org, size_t trait_id,
+                         TraitEncoding encoding) {
+    switch (encoding) {
+    case TraitEncoding::NUMERIC:
+      WriteBinary<double>(os, org.GetTraitAsDouble(trait_id));
+      break;
+    case TraitEncoding::SIGNED:
+      WriteBinary<int64_t>(os, GetIntegerTrait<int64_t, int, long, long long, short, signed char>(org, trait_id));
+      break;
+    case TraitEncoding::UNSIGNED:
+      WriteBinary<uint64_t>(os, GetIntegerTrait<uint64_t, unsigned int, unsigned long, unsigned long long,
+                                                unsigned short, unsigned char>(org, trait_id));
+      break;
+    case TraitEncoding::STRING:
+      WriteBinaryString(os, org.GetTrait<std::string>(trait_id));
+      break;
+    case TraitEncoding::BITS: {
+      const emp::BitVector & bits = org.GetTrait<emp::BitVector>(trait_id);
+      WriteBinary<uint64_t>(os, bits.size());
+      for (size_t start = 0; start < bits.size(); start += 8) {
+        unsigned char cur_byte = 0;
+        for (size_t i = start; i < start + 8 && i < bits.size(); i++) {
+          if (bits[i]) cur_byte |= (unsigned char) (1 << (i - start));
+        }
+        os.put((char) cur_byte);
+      }
+      break;
+    }
+    case TraitEncoding::VALUES: {
+      const emp::vector<double> & vals = org.GetTrait<emp::vector<double>>(trait_id);
+      WriteBinary<uint64_t>(os, vals.size());
+      os.write((const char *) vals.data(), (std::streamsize) (vals.size() * sizeof(double)));
+      break;
+    }
+    case TraitEncoding::UNSUPPORTED:
+      break;
+    }
+  }
+
+  /// Read a single trait value; if set_trait is false the value is read but discarded.
+  inline bool ReadTrait(std::istream & is, Organism & org, size_t trait_id,
+                        TraitEncoding encoding, bool set_trait=true) {
+    switch (encoding) {
+    case TraitEncoding::NUMERIC: {
+      double value = 0.0;
+      if (!ReadBinary(is, value)) return false;
+      return !set_trait || SetArithmeticTrait(org, trait_id, value);
+    }
+    case TraitEncoding::SIGNED: {
+      int64_t value = 0;
+      if (!ReadBinary(is, value)) return false;
+      return !set_trait || SetArithmeticTrait(org, trait_id, value);
+    }
+    case TraitEncoding::UNSIGNED: {
+      uint64_t value = 0;
+      if (!ReadBinary(is, value)) return false;
+      return !set_trait || SetArithmeticTrait(org, trait_id, value);
+    }
+    case TraitEncoding::STRING: {
+      std::string value;
+      if (!ReadBinaryString(is, value)) return false;
+      if (set_trait) org.SetTrait<std::string>(trait_id, value);
+      return true;
+    }
+    case TraitEncoding::BITS: {
+      uint64_t num_bits = 0;
+      if (!ReadBinary(is, num_bits) ||
+          !HasBytesLeft(is, num_bits / 8 + (num_bits % 8 != 0))) return false;
+      emp::BitVector bits(num_bits);
+      for (size_t start = 0; start < num_bits; start += 8) {
+        const int cur_byte = is.get();
+        if (cur_byte == EOF) return false;
+        for (size_t i = start; i < start + 8 && i < num_bits; i++) {
+          bits.Set(i, (cur_byte >> (i - start)) & 1);
+        }
+      }
+      if (set_trait) org.SetTrait<emp::BitVector>(trait_id, bits);
+      return true;
+    }
+    case TraitEncoding::VALUES: {
+      uint64_t num_vals = 0;
+      if (!ReadBinary(is, num_vals) || num_vals > (uint64_t) -1 / sizeof(double) ||
+          !HasBytesLeft(is, num_vals * sizeof(double))) return false;
+      emp::vector<double> vals(num_vals);
+      if (!is.read((char *) vals.data(), (std::streamsize) (num_vals * sizeof(double)))) return false;
+      if (set_trait) org.SetTrait<emp::vector<double>>(trait_id, vals);
+      return true;
+    }
+    case TraitEncoding::UNSUPPORTED:
+      return true;
+    }
+    return false;
+  }
+
+
+  // ---=== Reading checkpoint files ===---
+
+  /// A checkpoint file mapped into memory, with its sections identified.
+  class CheckpointFile {
+  public:
+    struct Section {
+      std::string tag;
+      const char * data = nullptr;
+      size_t size = 0;
+    };
+
+  private:
+    const char * data = nullptr;           ///< Start of the mapped file.
+    size_t size = 0;                       ///< Number of bytes in the file.
+    bool is_mapped = false;                ///< Was data mapped (or read into a buffer)?
+    emp::vector<char> buffer;              ///< Backup storage if mmap is unavailable.
+    CheckpointHeader header;
+    emp::vector<Section> sections;
+    std::string error;
+
+    bool Fail(const std::string & msg) { error = msg; return false; }
+
+    void Close() {
+      if (is_mapped) munmap((void *) data, size);
+      data = nullptr;
+      size = 0;
+      is_mapped = false;
+      buffer.resize(0);
+      sections.resize(0);
+    }
+
+  public:
+    CheckpointFile() { }
+    CheckpointFile(const CheckpointFile &) = delete;
+    ~CheckpointFile() { Close(); }
+
+    const CheckpointHeader & GetHeader() const { return header; }
+    const std::string & GetError() const { return error; }
+    size_t GetNumSections() const { return sections.size(); }
+    const Section & GetSection(size_t id) const { return sections[id]; }
+
+    /// Map a checkpoint file into memory and locate all of its sections.
+    bool Open(const std::string & filename) {
+      Close();
+
+      const int fd = open(filename.c_str(), O_RDONLY);
+      if (fd < 0) return Fail("Unable to open checkpoint file '" + filename + "'.");
+      struct stat file_stat;
+      if (fstat(fd, &file_stat) != 0) { close(fd); return Fail("Unable to read checkpoint file '" + filename + "'."); }
+      size = (size_t) file_stat.st_size;
+
+      void * map_ptr = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+      if (map_ptr != MAP_FAILED) {
+        data = (const char *) map_ptr;
+        is_mapped = true;
+      } else {
+        // If mmap is not available, fall back to reading the full file.
+        buffer.resize(size);
+        size_t total = 0;
+        while (total < size) {
+          const ssize_t count = read(fd, buffer.data() + total, size - total);
+          if (count <= 0) break;
+          total += (size_t) count;
+        }
+        size = total;
+        data = buffer.data();
+      }
+      close(fd);
+
+      // Load and check the header.
+      if (size < sizeof(CheckpointHeader)) return Fail("Checkpoint file '" + filename + "' is truncated.");
+      std::memcpy(&header, data, sizeof(CheckpointHeader));
+      if (!header.IsValid()) return Fail("File '" + filename + "' is not a MABE checkpoint.");
+      if (header.version != CHECKPOINT_VERSION) {
+        return Fail("Checkpoint '" + filename + "' uses version " + std::to_string(header.version) +
+                    "; expected version " + std::to_string(CHECKPOINT_VERSION) + ".");
+      }
+
+      // Locate each section.
+      size_t pos = sizeof(CheckpointHeader);
+      for (size_t i = 0; i < header.num_sections; i++) {
+        if (pos + 16 > size) return Fail("Checkpoint file '" + filename + "' is truncated.");
+        Section section;
+        section.tag.assign(data + pos, 4);
+        uint64_t payload_size = 0;
+        std::memcpy(&payload_size, data + pos + 8, sizeof(payload_size));
+        section.data = data + pos + 16;
+        section.size = (size_t) payload_size;
+        if (pos + 16 + section.size > size) return Fail("Checkpoint file '" + filename + "' is truncated.");
+        sections.push_back(section);
+        pos = AlignCheckpointPos(pos + 16 + section.size);
+      }
+
+      return true;
+    }
+  };
+
+}
+
+#endif
@@ -288,6 +288,17 @@ namespace mabe {
       else return pos_map.begin()->first;
     }
 
+    /// Call fun(pop, pos_set) for each population in this collection, where pos_set points
+    /// to the positions used (or is null if the full population is included).
+    template <typename FUN_T>
+    void ForEachPop(FUN_T fun) const {
+      for (const auto & [pop_ptr, pop_info] : pos_map) {
+        emp::Ptr<const emp::BitVector> pos_set = nullptr;
+        if (!pop_info.full_pop) pos_set = &pop_info.pos_set;
+        fun(*pop_ptr, pos_set);
+      }
+    }
+
     template <typename T>
     void IncPosition(T & it) const {
       const_pop_ptr_t cur_pop = it.PopPtr();
@@ -366,6 +377,21 @@ namespace mabe {
       return Insert( std::forward<Ts>(extras)... );
     }
 
+    /// Add a set of positions from a population, provided as a bitmask (set bits are used).
+    Collection & InsertPositions(const Population & pop, const emp::BitVector & positions) {
+      PopInfo & pop_info = pos_map[emp::Ptr<const Population>(&pop).ConstCast<Population>()];
+      if (pop_info.full_pop) return *this;  // This population is already full.
+
+      emp::BitVector & pos_set = pop_info.pos_set;
+      if (pos_set.GetSize() == 0) { pos_set = positions; return *this; }
+
+      emp::BitVector in_pos_set = positions;
+      if (in_pos_set.GetSize() < pos_set.GetSize()) in_pos_set.Resize(pos_set.GetSize());
+      else if (pos_set.GetSize() < in_pos_set.GetSize()) pos_set.Resize(in_pos_set.GetSize());
+      pos_set |= in_pos_set;
+      return *this;
+    }
+
     /// Base case...
     Collection & Insert() { return *this; }
 
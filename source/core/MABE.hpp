@@ -16,10 +16,19 @@
 #ifndef MABE_MABE_H
 #define MABE_MABE_H
 
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <limits>
+#include <map>
 #include <string>
 #include <sstream>
 
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "emp/base/array.hpp"
 #include "emp/base/Ptr.hpp"
 #include "emp/base/vector.hpp"
@@ -31,6 +40,8 @@
 
 #include "../config/Config.hpp"
 
+#include "AsyncWriter.hpp"
+#include "Checkpoint.hpp"
 #include "Collection.hpp"
 #include "data_collect.hpp"
 #include "ErrorManager.hpp"
@@ -38,7 +49,11 @@
 #include "ModuleBase.hpp"
 #include "Population.hpp"
 #include "SigListener.hpp"
+#include "TimeSeries.hpp"
 #include "TraitManager.hpp"
+#include "TraitPredicate.hpp"
+#include "TraitStats.hpp"
+#include "TraitSummary.hpp"
 
 namespace mabe {
 
@@ -70,6 +85,11 @@ namespace mabe {
 
     TraitManager<ModuleBase> trait_man;  ///< Manages which modules are allowed to use each trait.
 
+    /// Numeric traits to keep incremental statistics for in every population (see TraitStats.hpp)
+    std::string track_traits = "";
+    emp::vector<std::string> tracked_trait_names;
+    bool traits_ready = false;           ///< Have trait IDs been assigned yet?
+
     /// Trait information to be stored on each organism.  Tracks the name, type, and current
     /// value of all traits that modules associate with organisms.
     emp::DataMap org_data_map;
@@ -101,7 +121,33 @@ namespace mabe {
     emp::vector<std::string> config_filenames; ///< Names of configuration files to load.
     emp::vector<std::string> config_settings;  ///< Additional config commands to run.
     std::string gen_filename;                  ///< Name of output file to generate.
+    std::string restore_filename;              ///< Checkpoint file to resume the run from.
+    std::string checkpoint_filename;           ///< Checkpoint to save at the end of this update.
+    std::string snapshot_filename;             ///< Snapshot to start at the end of this update.
+
+
+    // --- Background snapshots (checkpoints written by a forked child process) ---
+    struct SnapshotInfo {
+      pid_t pid = 0;                   ///< Process ID of the child writing this snapshot.
+      std::string filename;            ///< File being written.
+      size_t update = 0;               ///< Update the snapshot was taken at.
+      std::chrono::steady_clock::time_point start_time;
+      double stall_ms = 0.0;           ///< How long was the run paused to start this snapshot?
+      size_t run_rss_kb = 0;           ///< Resident memory of the run when the snapshot started.
+    };
+    emp::vector<SnapshotInfo> snapshots;       ///< Snapshots still being written.
+    size_t max_snapshots = 2;                  ///< Maximum number of snapshots to write at once.
+
+    // --- Shared output service (file writes happen on a separate I/O thread) ---
+    AsyncWriter async_writer;                  ///< Writer used by modules for all file output.
+    size_t output_buffer_kb = 1024;            ///< Data to gather for each file before writing.
+    double output_flush_ms = 1000.0;           ///< Maximum time to hold output before writing.
+    // --- Recent history of metrics that modules record (see TimeSeries.hpp) ---
+    std::map<std::string, TimeSeries> time_series;  ///< All series, by name.
+    size_t series_capacity = 1000;             ///< Samples to keep at each resolution.
+
     Config config;                             ///< Configutation information for this run.
+    std::map<std::string, TraitPredicate> predicates;  ///< Compiled predicates, by expression.
     emp::Ptr<ConfigScope> cur_scope;           ///< Which config scope are we currently using?
 
 
@@ -112,6 +158,15 @@ namespace mabe {
       // Let all modules know that exit is about to occur.
       before_exit_sig.Trigger();
 
+      // Make sure all background snapshots finish writing.
+      CollectSnapshots(0);
+
+      // Write out all remaining file output; report if the disk was not keeping up.
+      if (async_writer.IsRunning()) {
+        async_writer.Stop();
+        if (verbose || async_writer.GetStats().num_stalls) async_writer.PrintStats(std::cout);
+      }
+
       // @CAO: Other local cleanup in case destructor is not run due to early termination?
 
       // Exit as soon as possible.
@@ -161,6 +216,21 @@ namespace mabe {
     /// Link signals to the modules that implment responses to those signals.
     void UpdateSignals();
 
+    // -- Helper functions for checkpoints and snapshots --
+
+    /// Reseed the random number generator and serialize all run state EXCEPT populations.
+    std::string PrepareCheckpoint();
+
+    /// Write a checkpoint file, given the prepared state and then adding all populations.
+    /// Errors are reported directly to std::cerr since this may run in a snapshot process.
+    bool WriteCheckpoint(const std::string & filename, const std::string & prefix) const;
+
+    /// Fork a child process to write a checkpoint while this run continues.
+    void StartSnapshot(const std::string & filename);
+
+    /// Report on any finished snapshots, waiting until no more than max_remaining are active.
+    void CollectSnapshots(size_t max_remaining);
+
 
     // -- Helper functions for debugging and extra output --
 
@@ -186,6 +256,7 @@ namespace mabe {
     emp::Random & GetRandom() { return random; }
     size_t GetUpdate() const noexcept { return update; }
     mabe::ErrorManager & GetErrorManager() { return error_man; }
+    AsyncWriter & GetAsyncWriter() { return async_writer; }
 
     // --- Tools to setup runs ---
     bool Setup();
@@ -204,15 +275,35 @@ namespace mabe {
     /// Update MABE a single time step.
     void Update();
 
-    /// Update MABE a specified number of time steps.
+    /// Update MABE until the specified number of time steps have occurred (a restored run
+    /// continues from the update it was saved at).
     void DoRun(size_t num_updates) {
       config.TriggerEvents("start");
-      for (size_t ud = 0; ud < num_updates && !exit_now; ud++) {
+      for (size_t ud = update; ud < num_updates && !exit_now; ud++) {
         Update();
       }
       Exit();
     }
 
+    // --- Checkpointing ---
+
+    /// Request a checkpoint be saved once the current update is complete.
+    void ScheduleCheckpoint(const std::string & filename) { checkpoint_filename = filename; }
+
+    /// Request a checkpoint be saved in the background once the current update is complete.
+    void ScheduleSnapshot(const std::string & filename) { snapshot_filename = filename; }
+
+    /// How many background snapshots are still being written?
+    size_t GetNumActiveSnapshots() const { return snapshots.size(); }
+
+    /// Save the full state of this run to a binary checkpoint file.  The master random number
+    /// generator is reseeded so that a restored run will continue identically.
+    bool SaveCheckpoint(const std::string & filename);
+
+    /// Restore a run from a checkpoint file; must be called after Setup() with the same
+    /// configuration that originally produced the checkpoint.
+    bool LoadCheckpoint(const std::string & filename);
+
     // -- World Structure --
 
     OrgPosition FindBirthPosition(Organism & offspring, OrgPosition ppos, Population & pop) {
@@ -241,6 +332,7 @@ namespace mabe {
       emp::Ptr<Population> new_pop =
         emp::NewPtr<Population>(name, cur_pop_id, pop_size, empty_org); // Create new population.
       pops.push_back(new_pop);                                          // Record new population.
+      if (traits_ready) Setup_TraitStats(*new_pop);                     // Track requested traits.
       return *new_pop;                                                  // Return new population.
     }
 
@@ -260,6 +352,27 @@ namespace mabe {
       SwapOrgs(from_pos, to_pos);
     }
 
+    /// Generate the outputs of all organisms in a collection, handing each organism manager
+    /// its organisms as a single batch (so that it can, for example, evaluate them in parallel).
+    void GenerateOutputs(Collection & orgs) {
+      emp::vector<emp::Ptr<ModuleBase>> managers;
+      emp::vector<emp::vector<emp::Ptr<Organism>>> batches;
+      for (Organism & org : orgs) {
+        if (org.IsEmpty()) continue;
+        emp::Ptr<ModuleBase> manager = &org.GetManagerBase();
+        size_t batch_id = 0;
+        while (batch_id < managers.size() && managers[batch_id] != manager) batch_id++;
+        if (batch_id == managers.size()) {
+          managers.push_back(manager);
+          batches.emplace_back();
+        }
+        batches[batch_id].push_back(&org);
+      }
+      for (size_t batch_id = 0; batch_id < managers.size(); batch_id++) {
+        managers[batch_id]->GenerateOutputs(batches[batch_id]);
+      }
+    }
+
     /// Inject a copy of the provided organism and return the position it was placed in;
     /// if more than one is added, return the position of the final injection.
     OrgPosition Inject(const Organism & org, Population & pop, size_t copy_count=1) {
@@ -371,6 +484,29 @@ namespace mabe {
       return target_pos;
     }
 
+    /// Build a single offspring WITHOUT placing it, so that it can be processed (for example,
+    /// evaluated in parallel) before its position is chosen.  Triggers 'before repro' on the
+    /// parent and 'offspring ready' on the offspring.  The caller takes ownership and must
+    /// either place it with PlaceOffspring() or delete it.
+    emp::Ptr<Organism> MakeOffspring(OrgPosition ppos, Population & target_pop,
+                                     bool do_mutations=true) {
+      const Organism & org = *ppos;
+      emp_assert(org.IsEmpty() == false);  // Empty cells cannot reproduce.
+
+      before_repro_sig.Trigger(ppos);
+      emp::Ptr<Organism> new_org = do_mutations ? org.MakeOffspring(random) : org.Clone();
+      on_offspring_ready_sig.Trigger(*new_org, ppos, target_pop);
+      return new_org;
+    }
+
+    /// Place an offspring built by MakeOffspring() at a specific position.
+    OrgPosition PlaceOffspring(emp::Ptr<Organism> new_org, OrgPosition ppos, OrgPosition target_pos) {
+      emp_assert(new_org);
+      emp_assert(target_pos.IsValid());    // Target positions must already be valid.
+      AddOrgAt(new_org, target_pos, ppos);
+      return target_pos;
+    }
+
 
     /// A shortcut to DoBirth where only the parent position needs to be supplied.
     OrgPosition Replicate(OrgPosition ppos, Population & target_pop,
@@ -433,6 +569,64 @@ namespace mabe {
       return col;
     }
 
+    /// Get a compiled predicate for a trait expression such as "fitness>0.9 && total<50"
+    /// (see TraitPredicate.hpp); returns nullptr and reports an error if it is not valid.
+    emp::Ptr<TraitPredicate> GetPredicate(const std::string & expr) {
+      auto it = predicates.find(expr);
+      if (it == predicates.end()) {
+        TraitPredicate predicate;
+        if (!predicate.Compile(expr, org_data_map)) {
+          error_man.AddError(predicate.GetError());
+          return nullptr;
+        }
+        it = predicates.emplace(expr, predicate).first;
+      }
+      return &(it->second);
+    }
+
+    /// Collect all living organisms from a collection that satisfy a trait expression.
+    Collection SelectWhere(const Collection & collect, const std::string & expr) {
+      emp::Ptr<TraitPredicate> predicate = GetPredicate(expr);
+      if (!predicate) return Collection();
+      return predicate->Select(collect);
+    }
+
+    /// Count the living organisms in a collection that satisfy a trait expression.
+    size_t CountWhere(const Collection & collect, const std::string & expr) {
+      emp::Ptr<TraitPredicate> predicate = GetPredicate(expr);
+      if (!predicate) return 0;
+      return predicate->Count(collect);
+    }
+
+
+    // --- Time series of metrics ---
+
+    /// Get the time series with the given name, creating it if needed.
+    TimeSeries & AddTimeSeries(const std::string & name, const std::string & desc="") {
+      auto it = time_series.find(name);
+      if (it == time_series.end()) {
+        it = time_series.emplace(name, TimeSeries(name, desc, series_capacity)).first;
+      }
+      return it->second;
+    }
+
+    /// Get an existing time series; returns nullptr if there is no series with this name.
+    emp::Ptr<TimeSeries> GetTimeSeries(const std::string & name) {
+      auto it = time_series.find(name);
+      if (it == time_series.end()) return nullptr;
+      return &(it->second);
+    }
+    emp::Ptr<const TimeSeries> GetTimeSeries(const std::string & name) const {
+      auto it = time_series.find(name);
+      if (it == time_series.end()) return nullptr;
+      return &(it->second);
+    }
+
+    /// Record a value for the current update in the named time series.
+    void RecordSample(const std::string & name, double value) {
+      AddTimeSeries(name).Add(update, value);
+    }
+
 
     // --- Module Management ---
 
@@ -441,6 +635,9 @@ namespace mabe {
       return emp::FindEval(modules, [mod_name](const auto & m){ return m->GetName() == mod_name; });
     }
 
+    /// How many modules are currently in use?
+    size_t GetNumModules() const { return modules.size(); }
+
     /// Get a reference to a module with the specified ID.
     const ModuleBase & GetModule(int id) const { return *modules[(size_t) id]; }
     ModuleBase & GetModule(int id) { return *modules[(size_t) id]; }
@@ -464,6 +661,71 @@ namespace mabe {
     // --- Deal with Organism TRAITS ---
     TraitManager<ModuleBase> & GetTraitManager() { return trait_man; }
 
+    /// Layout of the traits on every organism (locked once setup is complete).
+    const emp::DataMap & GetOrgDataMap() const { return org_data_map; }
+
+    /// Request that every population keep incremental statistics for a numeric trait, so that
+    /// its mean, variance, stddev, and sum are available without a scan.  Modules should call
+    /// this from SetupModule(); the trait is checked once all traits are registered.
+    void TrackTraitStats(const std::string & trait_name) {
+      if (emp::Has(tracked_trait_names, trait_name)) return;
+      tracked_trait_names.push_back(trait_name);
+      if (traits_ready) {
+        if (!CheckTrackedTrait(trait_name)) tracked_trait_names.pop_back();
+        else for (emp::Ptr<Population> pop_ptr : pops) Setup_TraitStats(*pop_ptr);
+      }
+    }
+
+    /// Make sure a trait can be tracked incrementally; report an error if not.
+    bool CheckTrackedTrait(const std::string & trait_name) {
+      if (!org_data_map.HasName(trait_name)) {
+        error_man.AddError("Cannot track statistics for unknown trait '", trait_name, "'.");
+        return false;
+      }
+      if (!org_data_map.GetType(org_data_map.GetID(trait_name)).IsArithmetic()) {
+        error_man.AddError("Cannot track statistics for non-numeric trait '", trait_name, "'.");
+        return false;
+      }
+      return true;
+    }
+
+    /// If every population in a collection is included in full, has no empty positions, and
+    /// tracks this trait incrementally, combine their statistics and return true.
+    static bool GetTrackedStats(const Collection & collect, size_t trait_id,
+                                TraitStats::Welford & stats) {
+      bool success = true;
+      collect.ForEachPop([&](const Population & pop, emp::Ptr<const emp::BitVector> pos_set){
+        if (pos_set || pop.GetNumOrgs() != pop.GetSize() || !pop.HasTraitStats(trait_id)) {
+          success = false;
+        }
+        else if (success) stats.Merge(pop.GetTraitStats(trait_id));
+      });
+      return success;
+    }
+
+    /// Build a function that uses tracked statistics (when available) for the mean, variance,
+    /// stddev, or sum of a trait, and otherwise falls back to scan_fun.  If the filter is not
+    /// one of those statistics, return scan_fun unchanged.
+    template <typename RESULT_T, typename CONVERT_T>
+    std::function<RESULT_T(const Collection &)>
+    AddTrackedStats(std::function<RESULT_T(const Collection &)> scan_fun, size_t trait_id,
+                    const std::string & trait_filter, CONVERT_T convert) {
+      TraitSummary::Stat stat;
+      if (!scan_fun || !TraitSummary::GetStat(trait_filter, stat) ||
+          stat == TraitSummary::Stat::MIN || stat == TraitSummary::Stat::MAX) return scan_fun;
+
+      return [scan_fun, trait_id, stat, convert](const Collection & collect) {
+        TraitStats::Welford stats;
+        if (!GetTrackedStats(collect, trait_id, stats)) return scan_fun(collect);
+        switch (stat) {
+        case TraitSummary::Stat::MEAN: return convert(stats.GetMean());
+        case TraitSummary::Stat::VARIANCE: return convert(stats.GetVariance());
+        case TraitSummary::Stat::STDDEV: return convert(stats.GetStdDev());
+        default: return convert(stats.sum);
+        }
+      };
+    }
+
     /// Build a function to scan a collection of organisms, reading the value for the given
     /// trait_name from each, aggregating those values based on the trait_filter and returning
     /// the result as a string.
@@ -476,18 +738,44 @@ namespace mabe {
     ///                  [VALUE] can be any numeric value
     ///   [OP][TRAIT] : Count how often this trait has the [OP] relationship with [TRAIT]
     ///                  [OP] can be ==, !=, <, >, <=, or >=
-    ///                  [TRAIT] can be any other trait name
+    ///                  [TRAIT] can be any other (numeric) trait name
+    ///                 (Comparisons may be extended with && or || as in TraitPredicate.hpp)
     ///   unique      : Return the number of distinct value for this trait (alias="richness").
+    ///   unique~     : Estimate the number of distinct values (HyperLogLog; ~1.6% std. error)
     ///   mode        : Return the most common value in this colection (aliases="dom","dominant").
+    ///   mode~       : Approximate the most common value (Misra-Gries; exact for a clear mode)
     ///   min         : Return the smallest value of this trait present.
     ///   max         : Return the largest value of this trait present.
     ///   ave         : Return the average value of this trait (alias="mean").
     ///   median      : Return the median value of this trait.
+    ///   median~     : Estimate the median value (KLL sketch; rank within ~1.7% of N)
     ///   variance    : Return the variance of this trait.
     ///   stddev      : Return the standard deviation of this trait.
     ///   sum         : Return the summation of all values of this trait (alias="total")
     ///   entopy      : Return the Shannon entropy of this value.
     ///   :trait      : Return the mutual information with another provided trait.
+    ///
+    ///  If a trait is tracked incrementally (see TrackTraitStats() or the track_traits setting),
+    ///  ave, variance, stddev, and sum are read from the running statistics of each population
+    ///  whenever the collection consists of whole, fully occupied populations.
+
+    /// Does this trait filter start with a comparison operator ([OP][VALUE] or [OP][TRAIT])?
+    static bool IsComparisonFilter(const std::string & trait_filter) {
+      return trait_filter.size() && (trait_filter[0] == '=' || trait_filter[0] == '!' ||
+                                     trait_filter[0] == '<' || trait_filter[0] == '>');
+    }
+
+    /// Build a function to count the organisms in a collection where the trait has the
+    /// relationship in trait_filter (e.g., ">0.5" or "<=other_trait"); empty on error.
+    std::function<size_t(const Collection &)>
+    BuildTraitCountFunction(const std::string & trait_name, const std::string & trait_filter) {
+      TraitPredicate predicate;
+      if (!predicate.Compile(trait_name + trait_filter, org_data_map)) {
+        error_man.AddError(predicate.GetError());
+        return std::function<size_t(const Collection &)>();
+      }
+      return [predicate](const Collection & collect) mutable { return predicate.Count(collect); };
+    }
 
     using trait_fun_t = std::function<std::string(const Collection &)>;
     trait_fun_t BuildTraitFunction(const std::string & trait_name,
@@ -508,16 +796,21 @@ namespace mabe {
         return emp::to_literal( org.GetTraitAsString(trait_id, trait_type) );
       };
 
-      // Return the number of times a specific value was found.
-      if (trait_filter[0] == '=') {
-        // @CAO: DO THIS!
-        trait_filter.erase(0,1); // Erase the '=' and we are left with the string to match.
+      // Return the number of times this trait has a relationship with a value or other trait.
+      if (IsComparisonFilter(trait_filter)) {
+        auto count_fun = BuildTraitCountFunction(trait_name, trait_filter);
+        if (!count_fun) return [](const Collection &){ return std::string("Error! Invalid trait comparison"); };
+        return [count_fun](const Collection & collect){ return emp::to_string(count_fun(collect)); };
       }
 
       // Otherwise pass along to the BuildCollectFun with the correct type...
       auto result = is_numeric
                   ? emp::BuildCollectFun<double,      Collection>(trait_filter, get_double_fun)
                   : emp::BuildCollectFun<std::string, Collection>(trait_filter, get_string_fun);
+      if (is_numeric) {
+        result = AddTrackedStats(result, trait_id, trait_filter,
+                                 [](double value){ return emp::to_string(value); });
+      }
 
       // If we made it past the 'if' statements, we don't know this aggregation type.
       if (!result) {
@@ -528,6 +821,44 @@ namespace mabe {
       return result;
     }
 
+    /// Build a function to aggregate a trait over a collection, as BuildTraitFunction() does,
+    /// but returning the result as a double so that no string conversions are needed.  Results
+    /// that are not numeric (such as the mode of a string trait) are returned as NaN.
+    using trait_value_fun_t = std::function<double(const Collection &)>;
+    trait_value_fun_t BuildTraitValueFunction(const std::string & trait_name,
+                                              const std::string & trait_filter) {
+      size_t trait_id = org_data_map.GetID(trait_name);
+      emp::TypeID trait_type = org_data_map.GetType(trait_id);
+      const bool is_numeric = trait_type.IsArithmetic();
+
+      auto get_double_fun = [trait_id, trait_type](const Organism & org) {
+        return org.GetTraitAsDouble(trait_id, trait_type);
+      };
+      auto get_string_fun = [trait_id, trait_type](const Organism & org) {
+        return org.GetTraitAsString(trait_id, trait_type);
+      };
+
+      if (IsComparisonFilter(trait_filter)) {
+        auto count_fun = BuildTraitCountFunction(trait_name, trait_filter);
+        if (!count_fun) return [](const Collection &){ return std::numeric_limits<double>::quiet_NaN(); };
+        return [count_fun](const Collection & collect){ return (double) count_fun(collect); };
+      }
+
+      auto result = is_numeric
+                  ? emp::BuildCollectFun_Double<double,      Collection>(trait_filter, get_double_fun)
+                  : emp::BuildCollectFun_Double<std::string, Collection>(trait_filter, get_string_fun);
+      if (is_numeric) {
+        result = AddTrackedStats(result, trait_id, trait_filter, [](double value){ return value; });
+      }
+
+      if (!result) {
+        error_man.AddError("Unknown trait filter '", trait_filter, "' for trait '", trait_name, "'.");
+        return [](const Collection &){ return std::numeric_limits<double>::quiet_NaN(); };
+      }
+
+      return result;
+    }
+
     // --- Manage configuration scope ---
 
     /// Access to the current configuration scope.
@@ -548,6 +879,14 @@ namespace mabe {
     /// Setup the configuration options for MABE, including for each module.
     void SetupConfig();
 
+    /// Apply incremental trait tracking to a population (once trait IDs are known).
+    void Setup_TraitStats(Population & pop) {
+      for (const std::string & trait_name : tracked_trait_names) {
+        const size_t trait_id = org_data_map.GetID(trait_name);
+        pop.TrackTrait(trait_id, org_data_map.GetType(trait_id));
+      }
+    }
+
     /// Sanity checks for debugging
     bool OK();
 
@@ -610,6 +949,18 @@ namespace mabe {
     std::function<int()> exit_fun = [this](){ Exit(); return 0; };
     config.AddFunction("exit", exit_fun, "Exit from this MABE run.");
 
+    // 'checkpoint' should save the state of the run at the end of the current update.
+    std::function<int(const std::string &)> checkpoint_fun =
+      [this](const std::string & filename){ ScheduleCheckpoint(filename); return 0; };
+    config.AddFunction("checkpoint", checkpoint_fun,
+      "Save a checkpoint of this run at the end of the current update (arg: filename).");
+
+    // 'snapshot' is like checkpoint, but is written by a background process.
+    std::function<int(const std::string &)> snapshot_fun =
+      [this](const std::string & filename){ ScheduleSnapshot(filename); return 0; };
+    config.AddFunction("snapshot", snapshot_fun,
+      "Save a checkpoint in the background without pausing the run (arg: filename).");
+
 
     // 'inject' allows a user to add an organism to a population.
     std::function<int(const std::string &, const std::string &, size_t)> inject_fun =
@@ -628,6 +979,53 @@ namespace mabe {
       };
     config.AddFunction("print", print_fun, "Print out the provided variable.");
 
+    // 'count_where' counts the organisms in a population that satisfy a trait expression.
+    std::function<double(const std::string &, const std::string &)> count_where_fun =
+      [this](const std::string & pop_name, const std::string & expr) {
+        const int pop_id = GetPopID(pop_name);
+        if (pop_id == -1) {
+          error_man.AddError("Unknown population: ", pop_name);
+          return 0.0;
+        }
+        return (double) CountWhere(Collection(GetPopulation(pop_id)), expr);
+      };
+    config.AddFunction("count_where", count_where_fun,
+      "Count organisms matching a trait expression (args: pop_name, expression, e.g. \"fitness>0.9\").");
+
+    // Functions to query the recent history of a time series (see TimeSeries.hpp).
+    auto add_series_fun = [this](const std::string & fun_name, const std::string & fun_desc,
+                                 double (TimeSeries::*query)(size_t) const) {
+      std::function<double(const std::string &, size_t)> series_fun =
+        [this, query, fun_name](const std::string & series_name, size_t window) {
+          emp::Ptr<const TimeSeries> series = GetTimeSeries(series_name);
+          if (!series) {
+            error_man.AddError(fun_name, "(): unknown time series '", series_name, "'.");
+            return std::numeric_limits<double>::quiet_NaN();
+          }
+          return ((*series).*query)(window);
+        };
+      config.AddFunction(fun_name, series_fun, fun_desc);
+    };
+    std::function<double(const std::string &)> series_last_fun =
+      [this](const std::string & series_name) {
+        emp::Ptr<const TimeSeries> series = GetTimeSeries(series_name);
+        if (!series) {
+          error_man.AddError("series_last(): unknown time series '", series_name, "'.");
+          return std::numeric_limits<double>::quiet_NaN();
+        }
+        return series->GetLast();
+      };
+    config.AddFunction("series_last", series_last_fun,
+      "Most recent value recorded in a time series (arg: series_name).");
+    add_series_fun("series_mean", "Mean of a time series over recent updates (args: series_name, num_updates).",
+                   &TimeSeries::GetMean);
+    add_series_fun("series_min", "Minimum of a time series over recent updates (args: series_name, num_updates).",
+                   &TimeSeries::GetMin);
+    add_series_fun("series_max", "Maximum of a time series over recent updates (args: series_name, num_updates).",
+                   &TimeSeries::GetMax);
+    add_series_fun("series_slope", "Change per update of a time series, fit over recent updates (args: series_name, num_updates).",
+                   &TimeSeries::GetSlope);
+
     // Add in built-in event triggers; these are used to indicate when events should happen.
     config.AddEventType("start");   // Triggered at the beginning of a run.
     config.AddEventType("update");  // Tested every update.
@@ -661,6 +1059,10 @@ namespace mabe {
     // If any of the inital flags triggered an 'exit_now', do so.
     if (exit_now) return false;
 
+    // Configure the output service before any modules open files.
+    async_writer.SetBufferSize(output_buffer_kb * 1024);
+    async_writer.SetFlushInterval(output_flush_ms);
+
     // Allow traits to be linked.
     trait_man.Unlock();
 
@@ -669,6 +1071,12 @@ namespace mabe {
 
     UpdateSignals();        // Setup the appropriate modules to be linked with each signal.
 
+    // If we are resuming a previous run, load its checkpoint.
+    if (restore_filename != "") {
+      std::cout << "Restoring checkpoint '" << restore_filename << "'." << std::endl;
+      LoadCheckpoint(restore_filename);
+    }
+
     error_man.Activate();
 
     // Only return success if there were no errors.
@@ -694,6 +1102,19 @@ namespace mabe {
 
     // Trigger any events that are supposed to occur in config at this update.
     config.UpdateEventValue("update", update);
+
+    // Save a checkpoint if one was requested; the update is now complete.
+    if (checkpoint_filename != "") {
+      SaveCheckpoint(checkpoint_filename);
+      checkpoint_filename = "";
+    }
+    if (snapshot_filename != "") {
+      StartSnapshot(snapshot_filename);
+      snapshot_filename = "";
+    }
+
+    // Report on any snapshots that have finished.
+    if (snapshots.size()) CollectSnapshots(snapshots.size());
   }
 
   void MABE::ProcessArgs() {
@@ -718,6 +1139,14 @@ namespace mabe {
       [this](const emp::vector<std::string> &){ show_help = true; } );
     arg_set.emplace_back("--modules", "-m", "              ", "Module list",
       [this](const emp::vector<std::string> &){ ShowModules(); } );
+    arg_set.emplace_back("--restore", "-r", "[filename]    ", "Resume run from a checkpoint file",
+      [this](const emp::vector<std::string> & in) {
+        if (in.size() != 1) {
+          std::cout << "'--restore' must be followed by a single filename.\n";
+          Exit();
+        }
+        else restore_filename = in[0];
+      });
     arg_set.emplace_back("--set", "-s", "[param=value] ", "Set specified parameter",
       [this](const emp::vector<std::string> & in){
         emp::Append(config_settings, in);
@@ -777,6 +1206,19 @@ namespace mabe {
     trait_man.Verify(verbose);            // Make sure modules are accessing traits consistently
     trait_man.RegisterAll(org_data_map);  // Load in all of the traits to the DataMap
     org_data_map.LockLayout();            // Freeze the data map into its current state
+    traits_ready = true;
+
+    // Setup incremental statistics for any traits that were requested.
+    for (std::string name : emp::slice(track_traits, ',')) {
+      emp::remove_whitespace(name);
+      if (name.size() && !emp::Has(tracked_trait_names, name)) tracked_trait_names.push_back(name);
+    }
+    emp::vector<std::string> requested = std::move(tracked_trait_names);
+    tracked_trait_names.resize(0);
+    for (const std::string & trait_name : requested) {
+      if (CheckTrackedTrait(trait_name)) tracked_trait_names.push_back(trait_name);
+    }
+    for (emp::Ptr<Population> pop_ptr : pops) Setup_TraitStats(*pop_ptr);
 
     // Alert modules (especially org managers) to the final set of traits.
     for (emp::Ptr<ModuleBase> mod_ptr : modules) {
@@ -804,6 +1246,404 @@ namespace mabe {
     rescan_signals = false;
   }
 
+  std::string MABE::PrepareCheckpoint() {
+    // Reseed the master random number generator so that its state can be restored exactly.
+    const int64_t seed = (int64_t) random.GetUInt(1, 2000000000);
+    random.ResetSeed(seed);
+
+    std::stringstream os;
+    CheckpointHeader header;
+    header.update = update;
+    header.random_seed = seed;
+    header.num_sections = 3 + pops.size();
+    WriteBinary(os, header);
+
+    // Config variables and event timings.
+    std::streampos section_start = BeginCheckpointSection(os, "CONF");
+    emp::vector<std::pair<std::string,std::string>> config_values;
+    config.GetRootScope().CollectValues(config_values);
+    WriteBinary<uint64_t>(os, config_values.size());
+    for (const auto & [path, value] : config_values) {
+      WriteBinaryString(os, path);
+      WriteBinaryString(os, value);
+    }
+    config.SaveEventState(os);
+    EndCheckpointSection(os, section_start);
+
+    // Organism traits.
+    const emp::vector<std::string> trait_names = trait_man.GetTraitNames();
+    section_start = BeginCheckpointSection(os, "TRTS");
+    WriteBinary<uint64_t>(os, trait_names.size());
+    for (const std::string & trait_name : trait_names) {
+      const size_t trait_id = org_data_map.GetID(trait_name);
+      WriteBinaryString(os, trait_name);
+      WriteBinary(os, GetTraitEncoding(org_data_map.GetType(trait_id)));
+    }
+    EndCheckpointSection(os, section_start);
+
+    // Module internal state.
+    section_start = BeginCheckpointSection(os, "MODS");
+    WriteBinary<uint64_t>(os, modules.size());
+    for (emp::Ptr<ModuleBase> mod_ptr : modules) {
+      std::stringstream mod_state;
+      mod_ptr->SerializeState(mod_state);
+      WriteBinaryString(os, mod_ptr->GetName());
+      WriteBinaryString(os, mod_state.str());
+    }
+    EndCheckpointSection(os, section_start);
+
+    return os.str();
+  }
+
+  bool MABE::WriteCheckpoint(const std::string & filename, const std::string & prefix) const {
+    // Write to a temporary file so that a failure cannot destroy an older checkpoint.
+    const std::string tmp_filename = filename + ".tmp";
+    std::ofstream os(tmp_filename, std::ios::binary);
+    if (!os) {
+      std::cerr << "Error: Unable to open checkpoint file '" << tmp_filename << "' for writing." << std::endl;
+      return false;
+    }
+    os.write(prefix.data(), (std::streamsize) prefix.size());
+
+    // Identify the traits to save (in the same order listed by PrepareCheckpoint())
+    const emp::vector<std::string> trait_names = trait_man.GetTraitNames();
+    emp::vector<size_t> trait_ids(trait_names.size());
+    emp::vector<TraitEncoding> trait_encodings(trait_names.size());
+    for (size_t i = 0; i < trait_names.size(); i++) {
+      trait_ids[i] = org_data_map.GetID(trait_names[i]);
+      trait_encodings[i] = GetTraitEncoding(org_data_map.GetType(trait_ids[i]));
+    }
+
+    // Populations, one section each.
+    for (emp::Ptr<Population> pop_ptr : pops) {
+      const Population & pop = *pop_ptr;
+      const std::streampos section_start = BeginCheckpointSection(os, "POPS");
+      WriteBinaryString(os, pop.GetName());
+      WriteBinary<uint64_t>(os, pop.GetSize());
+
+      // Identify the organism types present.
+      emp::vector<std::string> type_names;
+      emp::vector<uint32_t> org_types(pop.GetSize(), 0);
+      for (size_t pos = 0; pos < pop.GetSize(); pos++) {
+        if (pop.IsEmpty(pos)) continue;
+        const std::string & type_name = pop[pos].GetManagerName();
+        int type_id = emp::FindValue(type_names, type_name);
+        if (type_id == -1) {
+          type_id = (int) type_names.size();
+          type_names.push_back(type_name);
+        }
+        org_types[pos] = (uint32_t) type_id;
+      }
+      WriteBinary<uint64_t>(os, type_names.size());
+      for (const std::string & type_name : type_names) WriteBinaryString(os, type_name);
+
+      // Reserve the offset table; it is filled in once the records have been written.
+      WriteAlignment(os);
+      const std::streampos table_start = os.tellp();
+      emp::vector<uint64_t> offsets(pop.GetSize(), (uint64_t) -1);
+      os.write((const char *) offsets.data(), (std::streamsize) (offsets.size() * sizeof(uint64_t)));
+      const std::streampos records_start = os.tellp();
+
+      for (size_t pos = 0; pos < pop.GetSize(); pos++) {
+        if (pop.IsEmpty(pos)) continue;
+        const Organism & org = pop[pos];
+        std::stringstream genome;
+        if (!org.Serialize(genome)) {
+          std::cerr << "Error: Organism type '" << type_names[org_types[pos]]
+                    << "' does not support serialization; cannot save checkpoint." << std::endl;
+          return false;
+        }
+        const std::string genome_str = genome.str();
+
+        WriteAlignment(os);
+        offsets[pos] = (uint64_t) (os.tellp() - records_start);
+        WriteBinary<uint32_t>(os, org_types[pos]);
+        WriteBinary<uint32_t>(os, 0);
+        WriteBinaryString(os, genome_str);
+        for (size_t i = 0; i < trait_ids.size(); i++) {
+          WriteTrait(os, org, trait_ids[i], trait_encodings[i]);
+        }
+      }
+
+      const std::streampos records_end = os.tellp();
+      os.seekp(table_start);
+      os.write((const char *) offsets.data(), (std::streamsize) (offsets.size() * sizeof(uint64_t)));
+      os.seekp(records_end);
+      EndCheckpointSection(os, section_start);
+    }
+
+    os.close();
+    if (!os || std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+      std::cerr << "Error: Unable to write checkpoint file '" << filename << "'." << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool MABE::SaveCheckpoint(const std::string & filename) {
+    if (!WriteCheckpoint(filename, PrepareCheckpoint())) {
+      error_man.AddError("Unable to save checkpoint '", filename, "'.");
+      return false;
+    }
+    verbose_out("Saved checkpoint '", filename, "' at update ", update, ".");
+    return true;
+  }
+
+  void MABE::StartSnapshot(const std::string & filename) {
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Limit the number of snapshots being written at once.
+    CollectSnapshots(max_snapshots ? max_snapshots - 1 : 0);
+
+    // Small parts of the state (config, modules) are prepared here; the child writes the rest.
+    const std::string prefix = PrepareCheckpoint();
+    std::cout.flush();  // Don't let the child inherit buffered output.
+    std::cerr.flush();
+
+    SnapshotInfo info;
+    info.filename = filename;
+    info.update = update;
+    info.start_time = start_time;
+    info.run_rss_kb = GetResidentMemoryKB();
+    info.pid = fork();
+
+    // In the child, write the checkpoint from our copy-on-write image of the run and quit
+    // without running any destructors or exit handlers.
+    if (info.pid == 0) {
+      const bool success = WriteCheckpoint(filename, prefix);
+      _exit(success ? 0 : 1);
+    }
+
+    // If we were unable to fork, save the checkpoint directly.
+    if (info.pid < 0) {
+      error_man.AddWarning("Unable to fork for snapshot '", filename, "'; saving directly.");
+      if (!WriteCheckpoint(filename, prefix)) {
+        error_man.AddError("Unable to save snapshot '", filename, "'.");
+      }
+      return;
+    }
+
+    const std::chrono::duration<double, std::milli> stall = std::chrono::steady_clock::now() - start_time;
+    info.stall_ms = stall.count();
+    snapshots.push_back(info);
+  }
+
+  void MABE::CollectSnapshots(size_t max_remaining) {
+    for (size_t i = 0; i < snapshots.size(); ) {
+      // Only wait on a snapshot if we need to drop below max_remaining (oldest first)
+      const bool do_wait = snapshots.size() > max_remaining;
+      SnapshotInfo & info = snapshots[i];
+      int status = 0;
+      struct rusage usage;
+      const pid_t result = wait4(info.pid, &status, do_wait ? 0 : WNOHANG, &usage);
+      if (result == 0) { i++; continue; }    // Still running.
+
+      const std::chrono::duration<double, std::milli> lag = std::chrono::steady_clock::now() - info.start_time;
+      const bool success = result > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      if (!success) {
+        error_man.AddError("Background snapshot '", info.filename, "' (update ", info.update, ") failed.");
+      }
+      else {
+        // On Linux, ru_maxrss is in kilobytes and a forked child starts at the parent's RSS.
+        const size_t child_rss_kb = (result > 0) ? (size_t) usage.ru_maxrss : 0;
+        const size_t growth_kb = (child_rss_kb > info.run_rss_kb) ? child_rss_kb - info.run_rss_kb : 0;
+        std::cout << "Snapshot '" << info.filename << "' (update " << info.update << ") saved;"
+                  << " stall=" << info.stall_ms << "ms"
+                  << " lag=" << lag.count() << "ms"
+                  << " child_peak_rss=" << child_rss_kb << "KB"
+                  << " rss_growth=" << growth_kb << "KB"
+                  << std::endl;
+      }
+      snapshots.erase(snapshots.begin() + (int) i);
+    }
+  }
+
+  bool MABE::LoadCheckpoint(const std::string & filename) {
+    CheckpointFile file;
+    if (!file.Open(filename)) {
+      error_man.AddError(file.GetError());
+      return false;
+    }
+
+    const CheckpointHeader & header = file.GetHeader();
+    update = (size_t) header.update;
+    random.ResetSeed(header.random_seed);
+
+    emp::vector<int> trait_ids;                  // Current ID of each saved trait (-1 if none)
+    emp::vector<TraitEncoding> trait_encodings;  // How was each saved trait encoded?
+
+    for (size_t section_id = 0; section_id < file.GetNumSections(); section_id++) {
+      const CheckpointFile::Section & section = file.GetSection(section_id);
+      MemoryInBuf buf(section.data, section.size);
+      std::istream is(&buf);
+
+      if (section.tag == "CONF") {
+        uint64_t num_values = 0;
+        ReadBinary(is, num_values);
+        std::string path, value;
+        for (uint64_t i = 0; i < num_values && is; i++) {
+          ReadBinaryString(is, path);
+          ReadBinaryString(is, value);
+          if (!config.GetRootScope().SetValueByPath(path, value)) {
+            error_man.AddWarning("Checkpoint setting '", path, "' not found in current configuration.");
+          }
+        }
+        if (!config.LoadEventState(is)) {
+          error_man.AddError("Checkpoint events do not match the current configuration.");
+          return false;
+        }
+      }
+
+      else if (section.tag == "TRTS") {
+        uint64_t num_traits = 0;
+        ReadBinary(is, num_traits);
+        if (!is || num_traits > section.size / sizeof(uint64_t)) {   // Each name has a size.
+          error_man.AddError("Checkpoint trait section is corrupt.");
+          return false;
+        }
+        trait_ids.resize(num_traits);
+        trait_encodings.resize(num_traits);
+        std::string trait_name;
+        for (size_t i = 0; i < num_traits && is; i++) {
+          ReadBinaryString(is, trait_name);
+          ReadBinary(is, trait_encodings[i]);
+          trait_ids[i] = -1;
+          if (!org_data_map.HasName(trait_name)) {
+            error_man.AddWarning("Checkpoint trait '", trait_name, "' is no longer in use.");
+            continue;
+          }
+          const size_t trait_id = org_data_map.GetID(trait_name);
+          if (!IsEncodingCompatible(trait_encodings[i], GetTraitEncoding(org_data_map.GetType(trait_id)))) {
+            error_man.AddWarning("Checkpoint trait '", trait_name, "' has changed type; using default.");
+            continue;
+          }
+          trait_ids[i] = (int) trait_id;
+        }
+        if (!is) {
+          error_man.AddError("Checkpoint trait section is corrupt.");
+          return false;
+        }
+      }
+
+      else if (section.tag == "MODS") {
+        uint64_t num_mods = 0;
+        ReadBinary(is, num_mods);
+        std::string mod_name, mod_state;
+        for (uint64_t i = 0; i < num_mods && is; i++) {
+          ReadBinaryString(is, mod_name);
+          ReadBinaryString(is, mod_state);
+          const int mod_id = GetModuleID(mod_name);
+          if (mod_id == -1) {
+            error_man.AddWarning("Checkpoint module '", mod_name, "' not found in current configuration.");
+            continue;
+          }
+          std::stringstream state_is(mod_state);
+          if (!GetModule(mod_id).DeserializeState(state_is)) {
+            error_man.AddError("Unable to restore state of module '", mod_name, "'.");
+            return false;
+          }
+        }
+      }
+
+      else if (section.tag == "POPS") {
+        std::string pop_name;
+        uint64_t pop_size = 0, num_types = 0;
+        ReadBinaryString(is, pop_name);
+        ReadBinary(is, pop_size);
+        ReadBinary(is, num_types);
+        if (!is || num_types > section.size / sizeof(uint64_t)) {   // Each name has a size.
+          error_man.AddError("Checkpoint population section is corrupt.");
+          return false;
+        }
+        const int pop_id = GetPopID(pop_name);
+        if (pop_id == -1) {
+          error_man.AddError("Checkpoint population '", pop_name, "' not found in current configuration.");
+          return false;
+        }
+
+        emp::vector<int> type_ids(num_types);
+        std::string type_name;
+        for (size_t i = 0; i < num_types; i++) {
+          ReadBinaryString(is, type_name);
+          type_ids[i] = GetModuleID(type_name);
+          if (type_ids[i] == -1) {
+            error_man.AddError("Checkpoint organism type '", type_name, "' not found in current configuration.");
+            return false;
+          }
+        }
+
+        // Locate the offset table and the records that follow it.
+        const size_t table_start = AlignCheckpointPos(buf.GetPos());
+        if (!is || table_start > section.size ||
+            pop_size > (section.size - table_start) / sizeof(uint64_t)) {
+          error_man.AddError("Checkpoint population '", pop_name, "' is corrupt.");
+          return false;
+        }
+        const size_t records_start = table_start + pop_size * sizeof(uint64_t);
+
+        Population & pop = GetPopulation((size_t) pop_id);
+        EmptyPop(pop, pop_size);
+        for (size_t pos = 0; pos < pop_size; pos++) {
+          uint64_t offset = 0;
+          std::memcpy(&offset, section.data + table_start + pos * sizeof(uint64_t), sizeof(offset));
+          if (offset == (uint64_t) -1) continue;   // Empty cell.
+
+          // The record header (type index, reserved, genome size) must lie within the section.
+          constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+          if (offset > section.size - records_start ||
+              RECORD_HEADER_SIZE > section.size - records_start - offset) {
+            error_man.AddError("Checkpoint organism at ", pop_name, "[", pos, "] is corrupt.");
+            return false;
+          }
+          const size_t record_start = records_start + (size_t) offset;
+          MemoryInBuf record_buf(section.data + record_start, section.size - record_start);
+          std::istream record_is(&record_buf);
+          uint32_t type_id = 0, reserved = 0;
+          uint64_t genome_size = 0;
+          ReadBinary(record_is, type_id);
+          ReadBinary(record_is, reserved);
+          ReadBinary(record_is, genome_size);
+
+          const size_t genome_start = record_start + record_buf.GetPos();
+          if (!record_is || type_id >= num_types || genome_size > section.size - genome_start) {
+            error_man.AddError("Checkpoint organism at ", pop_name, "[", pos, "] is corrupt.");
+            return false;
+          }
+
+          // Rebuild the organism from its genome, then restore its traits.
+          ModuleBase & org_manager = GetModule(type_ids[type_id]);
+          if (!org_manager.IsOrgManager()) {
+            error_man.AddError("Checkpoint organism type '", org_manager.GetName(),
+                               "' is not an organism type.");
+            return false;
+          }
+          emp::Ptr<Organism> org_ptr = org_manager.MakeOrganism();
+          MemoryInBuf genome_buf(section.data + genome_start, genome_size);
+          std::istream genome_is(&genome_buf);
+          bool success = org_ptr->Deserialize(genome_is);
+
+          MemoryInBuf trait_buf(section.data + genome_start + genome_size,
+                                section.size - genome_start - genome_size);
+          std::istream trait_is(&trait_buf);
+          for (size_t i = 0; i < trait_ids.size() && success; i++) {
+            const bool use_trait = (trait_ids[i] != -1);
+            success = ReadTrait(trait_is, *org_ptr, (size_t) trait_ids[i], trait_encodings[i], use_trait);
+          }
+
+          if (!success) {
+            org_ptr.Delete();
+            error_man.AddError("Unable to restore organism at ", pop_name, "[", pos, "].");
+            return false;
+          }
+          AddOrgAt(org_ptr, pop.IteratorAt(pos));
+        }
+      }
+    }
+
+    std::cout << "Restored run at update " << update << "." << std::endl;
+    return true;
+  }
+
   void MABE::SetupConfig() {
     emp_assert(cur_scope);
     emp_assert(cur_scope.Raw() == &(config.GetRootScope()),
@@ -814,6 +1654,21 @@ namespace mabe {
     cur_scope->LinkVar("random_seed",
                         random_seed,
                         "Seed for random number generator; use 0 to base on time.").SetMin(0);
+    cur_scope->LinkVar("max_snapshots",
+                        max_snapshots,
+                        "Maximum number of background snapshots to write at once.");
+    cur_scope->LinkVar("output_buffer_kb",
+                        output_buffer_kb,
+                        "Kilobytes of output to gather for each file before writing it.");
+    cur_scope->LinkVar("output_flush_ms",
+                        output_flush_ms,
+                        "Maximum milliseconds to hold file output before writing it.");
+    cur_scope->LinkVar("series_capacity",
+                        series_capacity,
+                        "Samples of each time series to keep at each resolution (every 1, 10, and 100 updates).");
+    cur_scope->LinkVar("track_traits",
+                        track_traits,
+                        "Numeric traits to keep running statistics for in every population (comma-separated).");
   }
 
 
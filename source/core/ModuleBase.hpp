@@ -163,6 +163,12 @@ namespace mabe {
       error_man->AddError(std::forward<Ts>(args)...);
     }
 
+    /// All internal warnings should be processed through AddWarning(...)
+    template <typename... Ts>
+    void AddWarning(Ts &&... args) {
+      error_man->AddWarning(std::forward<Ts>(args)...);
+    }
+
   public:
     ModuleBase(MABE & in_control, const std::string & in_name, const std::string & in_desc="")
       : name(in_name), desc(in_desc), control(in_control)
@@ -217,6 +223,16 @@ namespace mabe {
     // Once data maps are locked in (no new traits allowed) modules can use that information.
     virtual void SetupDataMap(emp::DataMap &) { /* By default, no setup needed. */ }
 
+    // Evaluate a single organism outside of the normal update cycle (e.g., for steady-state
+    // evolution); must be safe to call concurrently on different organisms.  Return false if
+    // this module can only evaluate whole populations.
+    virtual bool EvaluateOrg(Organism &) { return false; }
+
+    // Save or restore any internal state that must survive a checkpoint.  By default, modules
+    // have no state beyond their configuration.  DeserializeState() should return success.
+    virtual void SerializeState(std::ostream &) { }
+    virtual bool DeserializeState(std::istream &) { return true; }
+
     // ----==== SIGNALS ====----
 
     // Base classes for signals to be called (More details in Module.h)
@@ -271,6 +287,8 @@ namespace mabe {
     virtual bool DoFindNeighbor_IsTriggered() = 0;
 
     // ---=== Specialty Functions for Organism Managers ===---
+    /// Does this module manage a type of organism (so the functions below are implemented)?
+    virtual bool IsOrgManager() const { return false; }
     virtual emp::TypeID GetOrgType() const {
       emp_assert(false, "GetOrgType() must be overridden for either Organism or OrganismManager module.");
       return emp::TypeID();
@@ -307,6 +325,10 @@ namespace mabe {
       emp_assert(false, "Randomize() must be overridden for either Organism or OrganismManager module.");
     }
 
+    /// Serialization is optional for organism types; return false if it is not supported.
+    virtual bool SerializeOrganism(const Organism &, std::ostream &) const { return false; }
+    virtual bool DeserializeOrganism(Organism &, std::istream &) const { return false; }
+
     virtual emp::Ptr<Organism> Recombine(const Organism &, emp::Ptr<Organism>, emp::Random &) const {
       emp_assert(false, "Recombine() must be overridden for either Organism or OrganismManager module.");
       return nullptr;
@@ -318,6 +340,11 @@ namespace mabe {
       return emp::vector< emp::Ptr<Organism> >();
     }
 
+    /// Generate outputs for a batch of organisms of this type (possibly in parallel).
+    virtual void GenerateOutputs(const emp::vector<emp::Ptr<Organism>> &) {
+      emp_assert(false, "GenerateOutputs() must be overridden for either Organism or OrganismManager module.");
+    }
+
     virtual void SetupConfig() { }
   };
 
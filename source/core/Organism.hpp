@@ -26,6 +26,8 @@
 #ifndef MABE_ORGANISM_H
 #define MABE_ORGANISM_H
 
+#include <type_traits>
+
 #include "emp/base/assert.hpp"
 #include "emp/base/vector.hpp"
 #include "emp/bits/BitVector.hpp"
@@ -34,28 +36,92 @@
 #include "emp/tools/string_utils.hpp"
 
 #include "ModuleBase.hpp"
+#include "TraitStats.hpp"
 
 namespace mabe {
 
   class Module;
 
   class Organism {
+    friend class Population;
   private:
     emp::DataMap data_map;   ///< Dynamic variables assigned to organism
     ModuleBase & manager;    ///< Manager for the specific organism type
 
+    /// Statistics to notify when tracked traits change (set while in a tracking population).
+    emp::Ptr<TraitStats> trait_stats = nullptr;
+    size_t stats_pos = 0;    ///< Position of this organism in its population.
+
+    /// Is this thread holding back trait writes from population statistics? (see DeferTraitStats)
+    static inline thread_local bool defer_trait_stats = false;
+
+    /// Report a trait write to the population's statistics, if this trait might be tracked.
+    template <typename T>
+    void NotifyWrite(size_t id, const T & value) {
+      if constexpr (std::is_arithmetic_v<T>) {
+        if (trait_stats && !defer_trait_stats) trait_stats->OnWrite(stats_pos, id, (double) value);
+      }
+    }
+
+    /// Start reporting tracked traits to a population's statistics.
+    void AttachTraitStats(TraitStats & stats, size_t pos) {
+      emp_assert(!trait_stats);
+      trait_stats = &stats;
+      stats_pos = pos;
+      for (size_t i = 0; i < stats.GetNumTraits(); i++) {
+        stats.Insert(i, pos, GetTraitAsDouble(stats.GetTraitID(i), stats.GetTraitType(i)));
+      }
+    }
+
+    /// Remove this organism's values from its population's statistics.
+    void DetachTraitStats() {
+      if (!trait_stats) return;
+      trait_stats->Remove(stats_pos);
+      trait_stats = nullptr;
+    }
+
   public:
     Organism(ModuleBase & _man) : manager(_man) { ; }
+    /// Copies do not belong to a population, so they never share its statistics.
+    Organism(const Organism & in) : data_map(in.data_map), manager(in.manager) { ; }
+    /// Assignment would have to choose between keeping and copying population statistics.
+    Organism & operator=(const Organism &) = delete;
     virtual ~Organism() { ; }
 
+    /// TraitStats are not thread safe.  While one of these is in scope, trait writes on the
+    /// current thread are not reported; code that evaluates organisms in parallel should hold
+    /// one in each task and then call RefreshTraitStats() on each organism from the main thread.
+    class DeferTraitStats {
+    private:
+      bool prev_defer;
+    public:
+      DeferTraitStats() : prev_defer(defer_trait_stats) { defer_trait_stats = true; }
+      ~DeferTraitStats() { defer_trait_stats = prev_defer; }
+      DeferTraitStats(const DeferTraitStats &) = delete;
+      DeferTraitStats & operator=(const DeferTraitStats &) = delete;
+    };
+
     /// Get the manager for this type of organism.
     Module & GetManager() { return (Module&) manager; }
     const Module & GetManager() const { return (Module&) manager; }
 
+    /// Get the manager as a ModuleBase (usable where Module has not been defined yet).
+    ModuleBase & GetManagerBase() { return manager; }
+
+    /// Get the name of the module that manages this type of organism.
+    const std::string & GetManagerName() const { return manager.GetName(); }
+
     /// The class below is a placeholder for storing any manager-specific data that the organims
     /// should have access to.  A derived organism class merely needs to shadow this one in order
     /// to include specialized data.
     struct ManagerData {
+      /// Called by the manager at the end of each update (e.g., to record time series).
+      void OnUpdate(MABE &, const std::string & /* manager_name */, size_t /* update */) { }
+
+      /// Called by the manager to evaluate a batch of organisms; by default, one at a time.
+      void GenerateOutputs(const emp::vector<emp::Ptr<Organism>> & orgs) {
+        for (emp::Ptr<Organism> org : orgs) org->GenerateOutput();
+      }
     };
 
     bool HasVar(const std::string & name) const { return data_map.HasName(name); }
@@ -69,19 +135,33 @@ namespace mabe {
     template <typename T>
     void SetVar(const std::string & name, const T & value) {
       if (data_map.HasName(name) == false) data_map.AddVar<T>(name, value);
-      else data_map.Set<T>(name, value);
+      else {
+        data_map.Set<T>(name, value);
+        NotifyWrite(data_map.GetID(name), value);
+      }
     }
 
     template <typename T>
     void SetVar(size_t id, const T & value) {
       emp_assert(data_map.HasID(id), id);
       data_map.Set<T>(id, value);
+      NotifyWrite(id, value);
     }
 
     emp::DataMap & GetDataMap() { return data_map; }
     const emp::DataMap & GetDataMap() const { return data_map; }
 
-    void SetDataMap(emp::DataMap & in_dm) { data_map = in_dm; }
+    void SetDataMap(emp::DataMap & in_dm) { data_map = in_dm; RefreshTraitStats(); }
+
+    /// Re-report all tracked traits; needed after writing a trait through a reference or
+    /// while trait statistics were deferred.
+    void RefreshTraitStats() {
+      if (!trait_stats) return;
+      for (size_t i = 0; i < trait_stats->GetNumTraits(); i++) {
+        const size_t id = trait_stats->GetTraitID(i);
+        trait_stats->OnWrite(stats_pos, id, GetTraitAsDouble(id, trait_stats->GetTraitType(i)));
+      }
+    }
 
     bool HasTraitID(size_t id) const { return data_map.HasID(id); }
     bool HasTrait(const std::string & name) const { return data_map.HasName(name); }
@@ -105,10 +185,18 @@ namespace mabe {
     const T & GetTrait(const std::string & name) const { return data_map.Get<T>(name); }
 
     template <typename T>
-    T & SetTrait(size_t id, const T & val) { return data_map.Set<T>(id, val); }
+    T & SetTrait(size_t id, const T & val) {
+      T & result = data_map.Set<T>(id, val);
+      NotifyWrite(id, val);
+      return result;
+    }
 
     template <typename T>
-    T & SetTrait(const std::string & name, const T & val) { return data_map.Set<T>(name, val); }
+    T & SetTrait(const std::string & name, const T & val) {
+      T & result = data_map.Set<T>(name, val);
+      NotifyWrite(data_map.GetID(name), val);
+      return result;
+    }
 
     emp::TypeID GetTraitType(size_t id) const { return data_map.GetType(id); }
     emp::TypeID GetTraitType(const std::string & name) const { return data_map.GetType(name); }
@@ -190,6 +278,15 @@ namespace mabe {
     /// is not overridden, try to the equivilent function in the organism manager.
     virtual std::string ToString() const { return manager.OrgToString(*this); }
 
+    /// Write the genome of this organism to a binary stream so that an identical organism can
+    /// be rebuilt elsewhere (e.g., in another process).  Returns false if unsupported.
+    /// @note If this function is not overridden, try the equivilent function in the manager.
+    virtual bool Serialize(std::ostream & os) const { return manager.SerializeOrganism(*this, os); }
+
+    /// Rebuild this organism's genome from a binary stream produced by Serialize().
+    /// Returns false if unsupported or the stream did not contain a valid genome.
+    virtual bool Deserialize(std::istream & is) { return manager.DeserializeOrganism(*this, is); }
+
     /// Completely randomize a new organism (typically for initialization)
     virtual void Randomize(emp::Random & random) { manager.Randomize(*this, random); }
 
@@ -44,6 +44,8 @@ namespace mabe {
     /// Save the organism type that uses this manager.
     using org_t = ORG_T;
 
+    bool IsOrgManager() const override { return true; }
+
     /// Also get the TypeID for this organism for more run-time type management.
     emp::TypeID GetOrgType() const override { return emp::GetTypeID<ORG_T>(); }
 
@@ -101,6 +103,16 @@ namespace mabe {
       org_prototype->SetupConfig();
     }
 
+    /// Let the organism type report on its shared data each update.
+    void OnUpdate(size_t update) override {
+      data.OnUpdate(control, GetName(), update);
+    }
+
+    /// Generate outputs for a batch of organisms; organism types may do so in parallel.
+    void GenerateOutputs(const emp::vector<emp::Ptr<Organism>> & orgs) override {
+      data.GenerateOutputs(orgs);
+    }
+
   };
 
   /// Build a class that will automatically register modules when created (globally)
@@ -91,6 +91,7 @@ namespace mabe {
     size_t max_orgs = (size_t) -1;          ///< Maximum number of orgs allowed in population.
 
     emp::Ptr<Organism> empty_org = nullptr; ///< Organism to fill in empty cells (does have data map!)
+    TraitStats trait_stats;                 ///< Incremental statistics for any tracked traits.
 
   public:
     using iterator_t = PopIterator;
@@ -120,6 +121,9 @@ namespace mabe {
           orgs[i] = in_pop.orgs[i]->Clone();
         }
       }
+      for (size_t i = 0; i < in_pop.trait_stats.GetNumTraits(); i++) {
+        TrackTrait(in_pop.trait_stats.GetTraitID(i), in_pop.trait_stats.GetTraitType(i));
+      }
       emp_assert(OK());
     }
 
@@ -156,6 +160,24 @@ namespace mabe {
     /// Required SetupConfig function; for now population don't have any config optons.
     void SetupConfig() override { }
 
+    /// Keep incremental statistics (see TraitStats.hpp) for a numeric trait in this population.
+    void TrackTrait(size_t trait_id, emp::TypeID trait_type) {
+      if (trait_stats.HasTrait(trait_id)) return;
+      for (size_t pos = 0; pos < orgs.size(); pos++) orgs[pos]->DetachTraitStats();
+      trait_stats.AddTrait(trait_id, trait_type);
+      for (size_t pos = 0; pos < orgs.size(); pos++) {
+        if (!orgs[pos]->IsEmpty()) orgs[pos]->AttachTraitStats(trait_stats, pos);
+      }
+    }
+
+    /// Is this trait being tracked incrementally?
+    bool HasTraitStats(size_t trait_id) const { return trait_stats.HasTrait(trait_id); }
+
+    /// Get the incremental statistics for a tracked trait, covering all living organisms.
+    const TraitStats::Welford & GetTraitStats(size_t trait_id) const {
+      return trait_stats.GetStats(trait_id);
+    }
+
   private:  // ---== To be used by friend class MABEBase only! ==---
 
     void SetOrg(size_t pos, emp::Ptr<Organism> org_ptr) {
@@ -164,6 +186,7 @@ namespace mabe {
       emp_assert(!org_ptr->IsEmpty());  // Use ClearOrg if you want to empty a cell.
       orgs[pos] = org_ptr;
       num_orgs++;
+      if (trait_stats.GetNumTraits()) org_ptr->AttachTraitStats(trait_stats, pos);
     }
 
     /// Remove (and return) the organism at pos, but don't delete it.
@@ -173,6 +196,7 @@ namespace mabe {
       emp::Ptr<Organism> out_org = orgs[pos];
       orgs[pos] = empty_org;
       if (!out_org->IsEmpty()) num_orgs--;
+      out_org->DetachTraitStats();
       return out_org;
     }
 
@@ -0,0 +1,281 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  TimeSeries.hpp
+ *  @brief Fixed-memory history of a single metric, kept at several resolutions.
+ *
+ *  A TimeSeries records one numeric sample per call to Add() (typically once per update).
+ *  Samples are kept in three ring buffers ("tiers") of the same capacity: tier 0 holds every
+ *  sample, tier 1 the mean of each block of 10 samples, and tier 2 the mean of each block of
+ *  100.  With the default capacity of 1000, the most recent 1000 updates are available exactly,
+ *  and coarser summaries reach back 10,000 and 100,000 updates, all in constant memory.
+ *
+ *  Queries take a window measured in samples, and automatically use the finest tier that
+ *  reaches back that far (or, early in a run, the finest tier with the most history); coarse
+ *  tiers include the partial block still in progress.  Samples from tier 0 that have not yet been written to disk can be
+ *  retrieved in bulk with GetUnflushed() and marked as written with MarkFlushed().
+ *  Serialize() and Deserialize() save and restore the full history (e.g., for checkpoints).
+ */
+
+#ifndef MABE_TIME_SERIES_H
+#define MABE_TIME_SERIES_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+
+#include "emp/base/array.hpp"
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+
+namespace mabe {
+
+  class TimeSeries {
+  public:
+    static constexpr size_t NUM_TIERS = 3;
+    static constexpr size_t TIER_STRIDE[NUM_TIERS] = { 1, 10, 100 };
+
+    struct Sample {
+      size_t update;   ///< Update of the sample (or of the last sample in a block).
+      double value;    ///< Sample value (or the mean of a block of samples).
+    };
+
+  private:
+    /// A fixed-capacity buffer where new samples overwrite the oldest.
+    class Ring {
+    private:
+      emp::vector<Sample> samples;
+      size_t start = 0;   ///< Position of the oldest sample.
+      size_t count = 0;   ///< Number of valid samples.
+
+    public:
+      void SetCapacity(size_t capacity) { samples.resize(capacity); start = count = 0; }
+      size_t GetCapacity() const { return samples.size(); }
+      size_t GetSize() const { return count; }
+
+      void Push(const Sample & sample) {
+        if (count < samples.size()) samples[(start + count++) % samples.size()] = sample;
+        else {
+          samples[start] = sample;
+          start = (start + 1) % samples.size();
+        }
+      }
+
+      /// Get a sample, counting back from the most recent (back=0).
+      const Sample & GetRecent(size_t back) const {
+        emp_assert(back < count, back, count);
+        return samples[(start + count - 1 - back) % samples.size()];
+      }
+    };
+
+    std::string name;
+    std::string desc;
+    emp::array<Ring, NUM_TIERS> tiers;
+    emp::array<double, NUM_TIERS> block_total;  ///< Sum of samples so far in current block.
+    size_t num_samples = 0;                     ///< Total samples ever added.
+    size_t num_unflushed = 0;                   ///< Tier 0 samples not yet written out.
+    size_t num_lost = 0;                        ///< Samples overwritten before being written.
+
+  public:
+    TimeSeries(const std::string & _name, const std::string & _desc="", size_t capacity=1000)
+      : name(_name), desc(_desc)
+    {
+      SetCapacity(capacity);
+    }
+
+    const std::string & GetName() const { return name; }
+    const std::string & GetDesc() const { return desc; }
+    size_t GetCapacity() const { return tiers[0].GetCapacity(); }
+    size_t GetNumSamples() const { return num_samples; }
+    size_t GetNumLost() const { return num_lost; }
+    size_t GetTierSize(size_t tier) const { return tiers[tier].GetSize(); }
+
+    /// Change how many samples each tier holds; this clears the history.
+    void SetCapacity(size_t capacity) {
+      if (capacity == 0) capacity = 1;
+      for (size_t tier = 0; tier < NUM_TIERS; tier++) {
+        tiers[tier].SetCapacity(capacity);
+        block_total[tier] = 0.0;
+      }
+      num_samples = num_unflushed = num_lost = 0;
+    }
+
+    /// Record a new sample.
+    void Add(size_t update, double value) {
+      num_samples++;
+      tiers[0].Push(Sample{update, value});
+      if (num_unflushed == GetCapacity()) num_lost++;
+      else num_unflushed++;
+
+      for (size_t tier = 1; tier < NUM_TIERS; tier++) {
+        block_total[tier] += value;
+        if (num_samples % TIER_STRIDE[tier] == 0) {
+          tiers[tier].Push(Sample{update, block_total[tier] / (double) TIER_STRIDE[tier]});
+          block_total[tier] = 0.0;
+        }
+      }
+    }
+
+    /// Get a sample from a tier, counting back from the most recent (back=0).
+    const Sample & GetRecent(size_t tier, size_t back=0) const {
+      return tiers[tier].GetRecent(back);
+    }
+
+    /// Most recent value recorded (NaN if none).
+    double GetLast() const {
+      if (tiers[0].GetSize() == 0) return std::numeric_limits<double>::quiet_NaN();
+      return tiers[0].GetRecent(0).value;
+    }
+
+    /// Number of samples a tier currently summarizes, including the partial block in progress.
+    size_t GetCoverage(size_t tier) const {
+      return tiers[tier].GetSize() * TIER_STRIDE[tier] + num_samples % TIER_STRIDE[tier];
+    }
+
+    /// Find the finest tier that covers a window of the given number of samples; if none
+    /// reach back that far, use the finest tier with the most history.
+    size_t FindTier(size_t window) const {
+      size_t best_tier = 0;
+      for (size_t tier = 0; tier < NUM_TIERS; tier++) {
+        if (GetCoverage(tier) >= window) return tier;
+        if (GetCoverage(tier) > GetCoverage(best_tier)) best_tier = tier;
+      }
+      return best_tier;
+    }
+
+    /// Call fun(sample, weight) on each entry covering (about) the most recent 'window'
+    /// samples, newest first; weight is the number of samples an entry summarizes.  Any
+    /// partial block in progress is visited first as the mean of its samples so far.
+    /// Returns the number of entries visited.
+    template <typename FUN_T>
+    size_t ForWindow(size_t window, FUN_T && fun) const {
+      if (window == 0) window = 1;
+      const size_t tier = FindTier(window);
+      const size_t stride = TIER_STRIDE[tier];
+      size_t num_entries = 0;
+      size_t covered = num_samples % stride;
+      if (covered) {
+        const size_t last_ud = tiers[0].GetRecent(0).update;
+        fun(Sample{last_ud, block_total[tier] / (double) covered}, covered);
+        num_entries++;
+      }
+      for (size_t i = 0; i < tiers[tier].GetSize() && covered < window; i++, covered += stride) {
+        fun(tiers[tier].GetRecent(i), stride);
+        num_entries++;
+      }
+      return num_entries;
+    }
+
+    /// Mean value over (about) the most recent 'window' samples; NaN if there are none.
+    double GetMean(size_t window) const {
+      double total = 0.0;
+      size_t count = 0;
+      ForWindow(window, [&total, &count](const Sample & sample, size_t weight){
+        total += sample.value * (double) weight;
+        count += weight;
+      });
+      if (count == 0) return std::numeric_limits<double>::quiet_NaN();
+      return total / (double) count;
+    }
+
+    double GetMin(size_t window) const {
+      double result = std::numeric_limits<double>::quiet_NaN();
+      ForWindow(window, [&result](const Sample & sample, size_t){
+        if (std::isnan(result) || sample.value < result) result = sample.value;
+      });
+      return result;
+    }
+
+    double GetMax(size_t window) const {
+      double result = std::numeric_limits<double>::quiet_NaN();
+      ForWindow(window, [&result](const Sample & sample, size_t){
+        if (std::isnan(result) || sample.value > result) result = sample.value;
+      });
+      return result;
+    }
+
+    /// Least-squares slope (change per update) over the most recent 'window' samples; returns
+    /// 0.0 if there are fewer than two entries to fit.
+    double GetSlope(size_t window) const {
+      if (num_samples == 0) return 0.0;
+
+      // Center the updates on the most recent one to keep the sums small.
+      const double last_ud = (double) tiers[0].GetRecent(0).update;
+      double sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+      const size_t num_entries = ForWindow(window, [&](const Sample & sample, size_t){
+        const double x = (double) sample.update - last_ud;
+        sum_x += x;
+        sum_y += sample.value;
+        sum_xx += x * x;
+        sum_xy += x * sample.value;
+      });
+      if (num_entries < 2) return 0.0;
+      const double n = (double) num_entries;
+      const double denom = n * sum_xx - sum_x * sum_x;
+      if (denom == 0.0) return 0.0;
+      return (n * sum_xy - sum_x * sum_y) / denom;
+    }
+
+    /// Number of tier 0 samples that have not been flushed (oldest first in GetUnflushed).
+    size_t GetNumUnflushed() const { return num_unflushed; }
+
+    /// Get an unflushed sample; id 0 is the oldest one not yet written.
+    const Sample & GetUnflushed(size_t id) const {
+      emp_assert(id < num_unflushed, id, num_unflushed);
+      return tiers[0].GetRecent(num_unflushed - 1 - id);
+    }
+
+    /// Record that all samples so far have been written out.
+    void MarkFlushed() { num_unflushed = 0; }
+
+    /// Write all tiers and counts in binary, oldest samples first.
+    void Serialize(std::ostream & os) const {
+      const uint64_t counts[3] = { num_samples, num_unflushed, num_lost };
+      os.write((const char *) counts, sizeof(counts));
+      for (double total : block_total) os.write((const char *) &total, sizeof(total));
+      for (const Ring & tier : tiers) {
+        const uint64_t tier_size = tier.GetSize();
+        os.write((const char *) &tier_size, sizeof(tier_size));
+        for (size_t back = tier_size; back > 0; back--) {
+          const Sample & sample = tier.GetRecent(back - 1);
+          const uint64_t update = sample.update;
+          os.write((const char *) &update, sizeof(update));
+          os.write((const char *) &sample.value, sizeof(sample.value));
+        }
+      }
+    }
+
+    /// Replace the history with one written by Serialize(); if the capacity has shrunk since,
+    /// only the most recent samples are kept.
+    bool Deserialize(std::istream & is) {
+      SetCapacity(GetCapacity());
+      uint64_t counts[3] = { 0, 0, 0 };
+      is.read((char *) counts, sizeof(counts));
+      for (double & total : block_total) is.read((char *) &total, sizeof(total));
+      for (Ring & tier : tiers) {
+        uint64_t tier_size = 0;
+        is.read((char *) &tier_size, sizeof(tier_size));
+        for (uint64_t i = 0; i < tier_size && is; i++) {
+          uint64_t update = 0;
+          double value = 0.0;
+          is.read((char *) &update, sizeof(update));
+          is.read((char *) &value, sizeof(value));
+          tier.Push(Sample{(size_t) update, value});
+        }
+      }
+      num_samples = (size_t) counts[0];
+      num_unflushed = std::min((size_t) counts[1], tiers[0].GetSize());
+      num_lost = (size_t) counts[2];
+      return (bool) is;
+    }
+  };
+
+}
+
+#endif
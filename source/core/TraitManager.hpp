@@ -14,10 +14,12 @@
 #ifndef MABE_TRAIT_MANAGER_HPP
 #define MABE_TRAIT_MANAGER_HPP
 
+#include <algorithm>
 #include <string>
 #include <unordered_map>
 
 #include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
 
 #include "TraitInfo.hpp"
 
@@ -50,6 +52,14 @@ namespace mabe {
 
     size_t GetSize() const { return trait_map.size(); }
 
+    /// Get the names of all traits, in sorted order.
+    emp::vector<std::string> GetTraitNames() const {
+      emp::vector<std::string> names;
+      for (const auto & x : trait_map) names.push_back(x.first);
+      std::sort(names.begin(), names.end());
+      return names;
+    }
+
     bool GetLocked() const { return locked; }
     void Lock() { locked = true; }
     void Unlock() { locked = false; }
@@ -0,0 +1,351 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  TraitPredicate.hpp
+ *  @brief Compiled boolean expressions over organism traits, evaluated into position bitmasks.
+ *
+ *  A TraitPredicate is compiled from an expression such as:
+ *
+ *     fitness > 0.9 && (total < 50 || !(generation >= 100))
+ *
+ *  Each comparison uses one of ==, !=, <, >, <=, or >= between two operands, each of which may
+ *  be a numeric trait name or a number.  Comparisons can be combined with &&, ||, and !, and
+ *  grouped with parentheses.  Trait names are resolved to IDs when the predicate is compiled,
+ *  so evaluation never looks anything up by name.
+ *
+ *  Evaluation is column-oriented: each trait used is read once per organism into a contiguous
+ *  array, each comparison then produces a block of 64-bit masks in a tight loop, and the
+ *  boolean operators combine whole words at a time.  Empty positions (and positions outside
+ *  of the collection being evaluated) never match.  The matches for each population are
+ *  written directly into the position set of the resulting Collection.
+ */
+
+#ifndef MABE_TRAIT_PREDICATE_H
+#define MABE_TRAIT_PREDICATE_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "emp/base/vector.hpp"
+#include "emp/bits/BitVector.hpp"
+#include "emp/data/DataMap.hpp"
+#include "emp/meta/TypeID.hpp"
+
+#include "Collection.hpp"
+#include "Population.hpp"
+
+namespace mabe {
+
+  class TraitPredicate {
+  private:
+    enum class CompareOp { EQU=0, NEQ, LESS, GREATER, LESS_EQU, GREATER_EQU };
+    enum class StepType { COMPARE=0, AND, OR, NOT };
+
+    /// A single side of a comparison: either a trait (by column) or a constant.
+    struct Operand {
+      int column = -1;        ///< Which trait column to use (-1 for a constant)
+      double value = 0.0;     ///< Value of a constant.
+    };
+
+    struct Comparison {
+      Operand lhs;
+      CompareOp op;
+      Operand rhs;
+    };
+
+    /// Program steps, in postfix order.
+    struct Step {
+      StepType type;
+      size_t compare_id = 0;
+    };
+
+    struct TraitColumn {
+      std::string name;
+      size_t id;
+      emp::TypeID type;
+    };
+
+    std::string expression;
+    emp::vector<TraitColumn> traits;
+    emp::vector<Comparison> compares;
+    emp::vector<Step> program;
+    std::string error;
+
+    // Scratch space reused between evaluations.
+    emp::vector<emp::vector<double>> columns;      ///< Value of each trait at each position.
+    emp::vector<uint64_t> alive;                   ///< Which positions hold living organisms?
+    emp::vector<emp::vector<uint64_t>> stack;      ///< Evaluation stack of masks.
+
+    // --- Parsing ---
+
+    /// Parsing state while compiling a single expression.
+    struct Parser {
+      const std::string & str;
+      size_t pos = 0;
+
+      void SkipSpace() { while (pos < str.size() && std::isspace((unsigned char) str[pos])) pos++; }
+      bool AtEnd() { SkipSpace(); return pos >= str.size(); }
+      bool Match(const std::string & token) {
+        SkipSpace();
+        if (str.compare(pos, token.size(), token) != 0) return false;
+        pos += token.size();
+        return true;
+      }
+    };
+
+    bool Fail(const std::string & msg) {
+      error = msg;
+      return false;
+    }
+
+    bool ParseOperand(Parser & parser, Operand & operand, const emp::DataMap & data_map) {
+      parser.SkipSpace();
+      const std::string & str = parser.str;
+      const size_t start = parser.pos;
+      if (start >= str.size()) return Fail("Expected a trait or value at end of '" + str + "'.");
+
+      // Numeric constant?
+      const char c = str[start];
+      if (std::isdigit((unsigned char) c) || c == '.' || c == '-' || c == '+') {
+        char * end = nullptr;
+        operand.value = std::strtod(str.c_str() + start, &end);
+        if (end == str.c_str() + start) return Fail("Invalid number in '" + str + "'.");
+        parser.pos = (size_t) (end - str.c_str());
+        operand.column = -1;
+        return true;
+      }
+
+      // Otherwise it must be a trait name.
+      size_t end = start;
+      while (end < str.size() &&
+             (std::isalnum((unsigned char) str[end]) || str[end] == '_' || str[end] == '.')) end++;
+      if (end == start) return Fail("Unexpected '" + str.substr(start, 1) + "' in '" + str + "'.");
+      const std::string name = str.substr(start, end - start);
+      parser.pos = end;
+
+      if (!data_map.HasName(name)) return Fail("Unknown trait '" + name + "' in '" + str + "'.");
+      const size_t trait_id = data_map.GetID(name);
+      const emp::TypeID trait_type = data_map.GetType(trait_id);
+      if (!trait_type.IsArithmetic()) {
+        return Fail("Trait '" + name + "' must be numeric to use in '" + str + "'.");
+      }
+
+      // Reuse the column if this trait is already being read.
+      for (size_t i = 0; i < traits.size(); i++) {
+        if (traits[i].id == trait_id) { operand.column = (int) i; return true; }
+      }
+      operand.column = (int) traits.size();
+      traits.push_back(TraitColumn{name, trait_id, trait_type});
+      return true;
+    }
+
+    bool ParseComparison(Parser & parser, const emp::DataMap & data_map) {
+      Comparison cmp;
+      if (!ParseOperand(parser, cmp.lhs, data_map)) return false;
+
+      // Check two-character operators first.
+      if (parser.Match("==")) cmp.op = CompareOp::EQU;
+      else if (parser.Match("!=")) cmp.op = CompareOp::NEQ;
+      else if (parser.Match("<=")) cmp.op = CompareOp::LESS_EQU;
+      else if (parser.Match(">=")) cmp.op = CompareOp::GREATER_EQU;
+      else if (parser.Match("<")) cmp.op = CompareOp::LESS;
+      else if (parser.Match(">")) cmp.op = CompareOp::GREATER;
+      else return Fail("Expected a comparison (==, !=, <, >, <=, >=) in '" + parser.str + "'.");
+
+      if (!ParseOperand(parser, cmp.rhs, data_map)) return false;
+
+      program.push_back(Step{StepType::COMPARE, compares.size()});
+      compares.push_back(cmp);
+      return true;
+    }
+
+    bool ParseFactor(Parser & parser, const emp::DataMap & data_map) {
+      if (parser.Match("!") ) {
+        if (!ParseFactor(parser, data_map)) return false;
+        program.push_back(Step{StepType::NOT});
+        return true;
+      }
+      if (parser.Match("(")) {
+        if (!ParseOr(parser, data_map)) return false;
+        if (!parser.Match(")")) return Fail("Missing ')' in '" + parser.str + "'.");
+        return true;
+      }
+      return ParseComparison(parser, data_map);
+    }
+
+    bool ParseAnd(Parser & parser, const emp::DataMap & data_map) {
+      if (!ParseFactor(parser, data_map)) return false;
+      while (parser.Match("&&")) {
+        if (!ParseFactor(parser, data_map)) return false;
+        program.push_back(Step{StepType::AND});
+      }
+      return true;
+    }
+
+    bool ParseOr(Parser & parser, const emp::DataMap & data_map) {
+      if (!ParseAnd(parser, data_map)) return false;
+      while (parser.Match("||")) {
+        if (!ParseAnd(parser, data_map)) return false;
+        program.push_back(Step{StepType::OR});
+      }
+      return true;
+    }
+
+    // --- Evaluation ---
+
+    template <typename TEST_T>
+    static void FillMask(emp::vector<uint64_t> & mask, size_t size, TEST_T test) {
+      for (size_t word = 0; word < mask.size(); word++) {
+        const size_t start = word * 64;
+        const size_t end = std::min(size, start + 64);
+        uint64_t bits = 0;
+        for (size_t i = start; i < end; i++) bits |= ((uint64_t) test(i)) << (i - start);
+        mask[word] = bits;
+      }
+    }
+
+    void EvalCompare(const Comparison & cmp, emp::vector<uint64_t> & mask, size_t size) const {
+      const Operand & lhs = cmp.lhs;
+      const Operand & rhs = cmp.rhs;
+      const double * lhs_col = lhs.column >= 0 ? columns[(size_t) lhs.column].data() : nullptr;
+      const double * rhs_col = rhs.column >= 0 ? columns[(size_t) rhs.column].data() : nullptr;
+      const double lhs_val = lhs.value;
+      const double rhs_val = rhs.value;
+      auto L = [=](size_t i){ return lhs_col ? lhs_col[i] : lhs_val; };
+      auto R = [=](size_t i){ return rhs_col ? rhs_col[i] : rhs_val; };
+
+      switch (cmp.op) {
+      case CompareOp::EQU:         FillMask(mask, size, [&](size_t i){ return L(i) == R(i); }); break;
+      case CompareOp::NEQ:         FillMask(mask, size, [&](size_t i){ return L(i) != R(i); }); break;
+      case CompareOp::LESS:        FillMask(mask, size, [&](size_t i){ return L(i) <  R(i); }); break;
+      case CompareOp::GREATER:     FillMask(mask, size, [&](size_t i){ return L(i) >  R(i); }); break;
+      case CompareOp::LESS_EQU:    FillMask(mask, size, [&](size_t i){ return L(i) <= R(i); }); break;
+      case CompareOp::GREATER_EQU: FillMask(mask, size, [&](size_t i){ return L(i) >= R(i); }); break;
+      }
+    }
+
+    /// Evaluate the program over a population, leaving the result in stack[0].  If pos_set is
+    /// provided, only those positions can match.
+    void EvalPopulation(const Population & pop, emp::Ptr<const emp::BitVector> pos_set=nullptr) {
+      const size_t size = pop.GetSize();
+      const size_t num_words = (size + 63) / 64;
+
+      // Load each trait column (and which positions are alive) in a single pass.
+      columns.resize(traits.size());
+      for (auto & column : columns) column.resize(size);
+      alive.assign(num_words, 0);
+      for (size_t pos = 0; pos < size; pos++) {
+        const Organism & org = pop[pos];
+        if (org.IsEmpty() || (pos_set && (pos >= pos_set->GetSize() || !pos_set->Get(pos)))) {
+          for (auto & column : columns) column[pos] = 0.0;
+          continue;
+        }
+        alive[pos / 64] |= ((uint64_t) 1) << (pos % 64);
+        for (size_t t = 0; t < traits.size(); t++) {
+          columns[t][pos] = org.GetTraitAsDouble(traits[t].id, traits[t].type);
+        }
+      }
+
+      // Run the program on whole masks.
+      size_t depth = 0;
+      for (const Step & step : program) {
+        switch (step.type) {
+        case StepType::COMPARE:
+          if (stack.size() <= depth) stack.resize(depth + 1);
+          stack[depth].resize(num_words);
+          EvalCompare(compares[step.compare_id], stack[depth], size);
+          depth++;
+          break;
+        case StepType::AND:
+          depth--;
+          for (size_t w = 0; w < num_words; w++) stack[depth-1][w] &= stack[depth][w];
+          break;
+        case StepType::OR:
+          depth--;
+          for (size_t w = 0; w < num_words; w++) stack[depth-1][w] |= stack[depth][w];
+          break;
+        case StepType::NOT:
+          for (size_t w = 0; w < num_words; w++) stack[depth-1][w] = ~stack[depth-1][w];
+          break;
+        }
+      }
+      emp_assert(depth == 1, depth);
+
+      // Only living organisms in use can match (this also clears any bits past the end).
+      for (size_t w = 0; w < num_words; w++) stack[0][w] &= alive[w];
+    }
+
+  public:
+    TraitPredicate() { }
+    TraitPredicate(const std::string & expr, const emp::DataMap & data_map) { Compile(expr, data_map); }
+
+    const std::string & GetExpression() const { return expression; }
+    const std::string & GetError() const { return error; }
+    bool IsValid() const { return program.size() > 0; }
+
+    /// Compile an expression against the trait layout; returns false (see GetError) on failure.
+    bool Compile(const std::string & expr, const emp::DataMap & data_map) {
+      expression = expr;
+      traits.resize(0);
+      compares.resize(0);
+      program.resize(0);
+      error = "";
+
+      Parser parser{expression};
+      if (!ParseOr(parser, data_map) || !parser.AtEnd()) {
+        if (error.empty()) error = "Unexpected text at end of '" + expression + "'.";
+        program.resize(0);
+        return false;
+      }
+      return true;
+    }
+
+    /// Set 'result' to the positions in the population that satisfy this predicate (limited
+    /// to pos_set, if one is provided).
+    void Evaluate(const Population & pop, emp::BitVector & result,
+                  emp::Ptr<const emp::BitVector> pos_set=nullptr) {
+      emp_assert(IsValid());
+      EvalPopulation(pop, pos_set);
+      result.Resize(pop.GetSize());
+      result.Clear();
+      for (size_t w = 0; w < stack[0].size(); w++) {
+        uint64_t word = stack[0][w];
+        for (size_t pos = w * 64; word; pos++, word >>= 1) {
+          if (word & 1) result.Set(pos);
+        }
+      }
+    }
+
+    /// Count how many organisms in the collection satisfy this predicate.
+    size_t Count(const Collection & collect) {
+      emp_assert(IsValid());
+      size_t count = 0;
+      collect.ForEachPop([this, &count](const Population & pop, emp::Ptr<const emp::BitVector> pos_set){
+        EvalPopulation(pop, pos_set);
+        for (uint64_t word : stack[0]) {
+          while (word) { word &= word - 1; count++; }
+        }
+      });
+      return count;
+    }
+
+    /// Build a collection of the organisms in 'collect' that satisfy this predicate.
+    Collection Select(const Collection & collect) {
+      Collection out;
+      emp::BitVector matches;
+      collect.ForEachPop([this, &out, &matches](const Population & pop, emp::Ptr<const emp::BitVector> pos_set){
+        Evaluate(pop, matches, pos_set);
+        out.InsertPositions(pop, matches);
+      });
+      return out;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  TraitStats.hpp
+ *  @brief Incrementally maintained statistics for selected numeric traits in a population.
+ *
+ *  A Population can be asked to track a numeric trait, after which its TraitStats object is
+ *  updated whenever an organism is placed or removed (through MABEBase) and whenever a tracked
+ *  trait is written with Organism::SetVar() or Organism::SetTrait().  The count, sum, mean,
+ *  and variance of each tracked trait are then available in constant time.
+ *
+ *  The variance is kept with Welford's algorithm, extended to allow values to be removed.
+ *  Each position's last reported value is cached so that it can be removed exactly, even if
+ *  the organism's trait has since been changed.  Since removals slowly accumulate rounding
+ *  error, all statistics are recalculated from the cached values once the number of changes
+ *  since the last recalculation exceeds the number of organisms (amortized constant time).
+ *
+ *  Writes made through a non-const reference to a trait (e.g., GetVar<double>(id) += 1.0)
+ *  cannot be seen; modules that write tracked traits that way should call
+ *  Organism::RefreshTraitStats() afterward.  Updates are not thread safe, so organisms
+ *  evaluated in parallel must hold back their reports (Organism::DeferTraitStats) and be
+ *  refreshed from the main thread once the batch is done.
+ */
+
+#ifndef MABE_TRAIT_STATS_H
+#define MABE_TRAIT_STATS_H
+
+#include <cmath>
+#include <limits>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/meta/TypeID.hpp"
+
+namespace mabe {
+
+  class TraitStats {
+  public:
+    /// Running count, sum, mean, and sum of squared deviations (M2) for a set of values.
+    struct Welford {
+      size_t count = 0;
+      double sum = 0.0;
+      double mean = 0.0;
+      double m2 = 0.0;
+
+      void Add(double value) {
+        count++;
+        sum += value;
+        const double delta = value - mean;
+        mean += delta / (double) count;
+        m2 += delta * (value - mean);
+      }
+
+      void Remove(double value) {
+        emp_assert(count > 0);
+        if (--count == 0) { *this = Welford(); return; }
+        sum -= value;
+        const double delta = value - mean;
+        mean -= delta / (double) count;
+        m2 -= delta * (value - mean);
+        if (m2 < 0.0) m2 = 0.0;
+      }
+
+      void Replace(double old_value, double new_value) {
+        Remove(old_value);
+        Add(new_value);
+      }
+
+      /// Combine with another set of values (Chan et al.'s pairwise update).
+      void Merge(const Welford & in) {
+        if (in.count == 0) return;
+        if (count == 0) { *this = in; return; }
+        const double total = (double) (count + in.count);
+        const double delta = in.mean - mean;
+        m2 += in.m2 + delta * delta * (double) count * (double) in.count / total;
+        mean += delta * (double) in.count / total;
+        count += in.count;
+        sum += in.sum;
+      }
+
+      double GetMean() const { return count ? mean : std::numeric_limits<double>::quiet_NaN(); }
+      double GetVariance() const { return m2 / ((double) count - 1.0); }
+      double GetStdDev() const { return std::sqrt(GetVariance()); }
+    };
+
+  private:
+    struct TraitInfo {
+      size_t id;
+      emp::TypeID type;
+      Welford stats;
+      emp::vector<double> values;  ///< Last value reported for each position.
+    };
+
+    emp::vector<TraitInfo> traits;
+    emp::vector<char> occupied;      ///< Which positions currently contribute values?
+    size_t num_changes = 0;          ///< Removals and replacements since last recalculation.
+
+    void CountChange() {
+      if (++num_changes > 1024 && num_changes > traits[0].stats.count) Recalculate();
+    }
+
+    void Recalculate() {
+      for (TraitInfo & info : traits) {
+        info.stats = Welford();
+        for (size_t pos = 0; pos < occupied.size(); pos++) {
+          if (occupied[pos]) info.stats.Add(info.values[pos]);
+        }
+      }
+      num_changes = 0;
+    }
+
+  public:
+    TraitStats() { }
+
+    size_t GetNumTraits() const { return traits.size(); }
+    size_t GetTraitID(size_t index) const { return traits[index].id; }
+    emp::TypeID GetTraitType(size_t index) const { return traits[index].type; }
+
+    /// Find where a trait is tracked; returns -1 if it is not.
+    int FindTrait(size_t trait_id) const {
+      for (size_t i = 0; i < traits.size(); i++) if (traits[i].id == trait_id) return (int) i;
+      return -1;
+    }
+    bool HasTrait(size_t trait_id) const { return FindTrait(trait_id) != -1; }
+
+    /// Get the statistics for a tracked trait.
+    const Welford & GetStats(size_t trait_id) const {
+      const int index = FindTrait(trait_id);
+      emp_assert(index != -1, trait_id);
+      return traits[(size_t) index].stats;
+    }
+
+    /// Begin tracking a new trait; the caller must re-insert all existing organisms.
+    void AddTrait(size_t trait_id, emp::TypeID type) {
+      emp_assert(!HasTrait(trait_id), trait_id);
+      traits.push_back(TraitInfo{trait_id, type, Welford(), emp::vector<double>()});
+      Clear();
+    }
+
+    /// Forget all values (but keep tracking the same traits).
+    void Clear() {
+      for (TraitInfo & info : traits) {
+        info.stats = Welford();
+        info.values.resize(0);
+      }
+      occupied.resize(0);
+      num_changes = 0;
+    }
+
+    /// Add the value of the trait at the given index for a newly occupied position.
+    void Insert(size_t index, size_t pos, double value) {
+      TraitInfo & info = traits[index];
+      if (info.values.size() <= pos) info.values.resize(pos+1, 0.0);
+      if (occupied.size() <= pos) occupied.resize(pos+1, 0);
+      info.values[pos] = value;
+      info.stats.Add(value);
+      occupied[pos] = 1;
+    }
+
+    /// Remove all values for a position that is being vacated.
+    void Remove(size_t pos) {
+      emp_assert(pos < occupied.size() && occupied[pos], pos);
+      for (TraitInfo & info : traits) info.stats.Remove(info.values[pos]);
+      occupied[pos] = 0;
+      CountChange();
+    }
+
+    /// An organism at an occupied position has written a new value to a trait.
+    void OnWrite(size_t pos, size_t trait_id, double value) {
+      const int index = FindTrait(trait_id);
+      if (index == -1) return;
+      TraitInfo & info = traits[(size_t) index];
+      emp_assert(pos < occupied.size() && occupied[pos], pos);
+      if (info.values[pos] == value) return;
+      info.stats.Replace(info.values[pos], value);
+      info.values[pos] = value;
+      CountChange();
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,214 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  TraitSummary.hpp
+ *  @brief Calculate many summary statistics over a collection in a single pass.
+ *
+ *  Each column added to a TraitSummary requests one statistic (min, max, mean, variance,
+ *  stddev, or sum) of one numeric trait.  Collect() then reads every trait that any column
+ *  needs exactly once per organism, updating all statistics for that trait together, rather
+ *  than making a separate pass over the collection for each column.
+ *
+ *  Positions are split into contiguous chunks that are processed in parallel with a
+ *  ThreadPool; each chunk keeps its own accumulators, which are then merged in chunk order
+ *  (using Chan et al.'s pairwise update for the variance), so the results for a given
+ *  thread count are always the same.
+ *
+ *  Traits that a population tracks incrementally (see TraitStats.hpp) are not read at all when
+ *  every position of that population is included and occupied and only the mean, variance,
+ *  stddev, or sum of the trait is requested; the population's running statistics are merged in
+ *  directly instead.
+ */
+
+#ifndef MABE_TRAIT_SUMMARY_H
+#define MABE_TRAIT_SUMMARY_H
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "emp/base/vector.hpp"
+#include "emp/meta/TypeID.hpp"
+
+#include "../tools/ThreadPool.hpp"
+#include "Collection.hpp"
+#include "Population.hpp"
+#include "TraitStats.hpp"
+
+namespace mabe {
+
+  class TraitSummary {
+  public:
+    enum class Stat { MIN=0, MAX, MEAN, VARIANCE, STDDEV, SUM };
+
+    /// Identify the statistic for a trait filter; return false if it cannot be fused.
+    static bool GetStat(const std::string & filter, Stat & stat) {
+      if (filter == "min") stat = Stat::MIN;
+      else if (filter == "max") stat = Stat::MAX;
+      else if (filter == "ave" || filter == "mean") stat = Stat::MEAN;
+      else if (filter == "variance") stat = Stat::VARIANCE;
+      else if (filter == "stddev") stat = Stat::STDDEV;
+      else if (filter == "sum" || filter == "total") stat = Stat::SUM;
+      else return false;
+      return true;
+    }
+
+  private:
+    /// Running statistics for a single trait.
+    struct Accum {
+      size_t count = 0;
+      double min = std::numeric_limits<double>::max();
+      double max = std::numeric_limits<double>::lowest();
+      double sum = 0.0;
+      double mean = 0.0;
+      double m2 = 0.0;       ///< Sum of squared distances from the mean (Welford)
+
+      void Add(double value) {
+        count++;
+        if (value < min) min = value;
+        if (value > max) max = value;
+        sum += value;
+        const double delta = value - mean;
+        mean += delta / (double) count;
+        m2 += delta * (value - mean);
+      }
+
+      void Merge(const Accum & in) {
+        if (in.count == 0) return;
+        if (count == 0) { *this = in; return; }
+        const double total = (double) (count + in.count);
+        const double delta = in.mean - mean;
+        m2 += in.m2 + delta * delta * (double) count * (double) in.count / total;
+        mean += delta * (double) in.count / total;
+        count += in.count;
+        sum += in.sum;
+        if (in.min < min) min = in.min;
+        if (in.max > max) max = in.max;
+      }
+
+      /// Merge in a population's incrementally tracked statistics (no min or max available).
+      void Merge(const TraitStats::Welford & in) {
+        Accum in_accum;
+        in_accum.count = in.count;
+        in_accum.sum = in.sum;
+        in_accum.mean = in.mean;
+        in_accum.m2 = in.m2;
+        Merge(in_accum);
+      }
+
+      double GetResult(Stat stat) const {
+        switch (stat) {
+        case Stat::MIN: return min;
+        case Stat::MAX: return max;
+        case Stat::MEAN: return count ? mean : std::numeric_limits<double>::quiet_NaN();
+        case Stat::VARIANCE: return m2 / ((double) count - 1.0);
+        case Stat::STDDEV: return std::sqrt(m2 / ((double) count - 1.0));
+        case Stat::SUM: return sum;
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+      }
+    };
+
+    struct TraitInfo {
+      size_t id;
+      emp::TypeID type;
+      bool needs_range = false;  ///< Is the min or max needed? (Not available incrementally.)
+    };
+
+    struct ColumnInfo {
+      size_t trait_pos;  ///< Which entry in 'traits' does this column summarize?
+      Stat stat;
+    };
+
+    emp::vector<TraitInfo> traits;            ///< Each distinct trait to be read.
+    emp::vector<ColumnInfo> columns;          ///< Each requested result.
+    emp::vector<double> results;              ///< Result for each column after Collect()
+    emp::vector<emp::vector<Accum>> chunk_accums;  ///< Accumulators for [chunk][trait]
+    emp::vector<size_t> positions;            ///< Positions for a partial population.
+    emp::vector<size_t> scan_traits;          ///< Traits that must be read from organisms.
+
+    size_t min_chunk_size = 4096;             ///< Fewest organisms to give a single chunk.
+
+    /// Run all accumulators over a set of positions in a population, in parallel.
+    template <typename POS_FUN>
+    void CollectPop(const Population & pop, size_t count, POS_FUN get_pos,
+                    ThreadPool & pool, emp::vector<Accum> & totals) {
+      const size_t max_chunks = pool.GetNumThreads() * 4;
+      if (chunk_accums.size() < max_chunks) chunk_accums.resize(max_chunks);
+      for (auto & accums : chunk_accums) accums.assign(traits.size(), Accum());
+
+      const size_t num_chunks =
+        pool.ParallelChunks(count, min_chunk_size, [&](size_t chunk_id, size_t start, size_t end){
+          emp::vector<Accum> & accums = chunk_accums[chunk_id];
+          for (size_t i = start; i < end; i++) {
+            const Organism & org = pop[get_pos(i)];
+            for (size_t t : scan_traits) {
+              accums[t].Add(org.GetTraitAsDouble(traits[t].id, traits[t].type));
+            }
+          }
+        });
+
+      for (size_t chunk_id = 0; chunk_id < num_chunks; chunk_id++) {
+        for (size_t t : scan_traits) totals[t].Merge(chunk_accums[chunk_id][t]);
+      }
+    }
+
+  public:
+    TraitSummary() { }
+
+    size_t GetNumColumns() const { return columns.size(); }
+    size_t GetNumTraits() const { return traits.size(); }
+    void SetMinChunkSize(size_t in_size) { min_chunk_size = in_size ? in_size : 1; }
+
+    /// Request a statistic for a (numeric) trait; returns the column ID for the result.
+    size_t AddColumn(size_t trait_id, emp::TypeID trait_type, Stat stat) {
+      size_t trait_pos = 0;
+      while (trait_pos < traits.size() && traits[trait_pos].id != trait_id) trait_pos++;
+      if (trait_pos == traits.size()) traits.push_back(TraitInfo{trait_id, trait_type});
+      if (stat == Stat::MIN || stat == Stat::MAX) traits[trait_pos].needs_range = true;
+      columns.push_back(ColumnInfo{trait_pos, stat});
+      results.push_back(std::numeric_limits<double>::quiet_NaN());
+      return columns.size() - 1;
+    }
+
+    /// Calculate all of the columns for the provided collection.
+    void Collect(const Collection & collect, ThreadPool & pool) {
+      emp::vector<Accum> totals(traits.size());
+
+      collect.ForEachPop([&](const Population & pop, emp::Ptr<const emp::BitVector> pos_set){
+        // Use any incrementally tracked statistics that cover exactly these organisms.
+        const bool use_tracked = !pos_set && pop.GetNumOrgs() == pop.GetSize();
+        scan_traits.resize(0);
+        for (size_t t = 0; t < traits.size(); t++) {
+          if (use_tracked && !traits[t].needs_range && pop.HasTraitStats(traits[t].id)) {
+            totals[t].Merge(pop.GetTraitStats(traits[t].id));
+          }
+          else scan_traits.push_back(t);
+        }
+        if (scan_traits.size() == 0) return;
+
+        if (!pos_set) {
+          CollectPop(pop, pop.GetSize(), [](size_t i){ return i; }, pool, totals);
+          return;
+        }
+        positions.resize(0);
+        for (int pos = pos_set->FindOne(); pos != -1; pos = pos_set->FindOne(pos+1)) {
+          if ((size_t) pos < pop.GetSize()) positions.push_back((size_t) pos);
+        }
+        CollectPop(pop, positions.size(), [this](size_t i){ return positions[i]; }, pool, totals);
+      });
+
+      for (size_t col = 0; col < columns.size(); col++) {
+        results[col] = totals[columns[col].trait_pos].GetResult(columns[col].stat);
+      }
+    }
+
+    /// Get the result for a column from the most recent Collect()
+    double GetResult(size_t col) const { return results[col]; }
+  };
+
+}
+
+#endif
@@ -11,23 +11,32 @@
  *  Each build function must know the data type it is working with (DATA_T), the type of container
  *  it should expect (CONTAIN_T), and be provided a function that will take a container element and
  *  return the appropriate value of type DATA_T.
+ *
+ *  Functions ending in "Approx" use the fixed-memory sketches in data_sketch.hpp (selected with
+ *  a trailing '~' on the filter name, such as "median~") and reuse their memory between calls.
  */
 
 #ifndef EMP_DATA_COLLECT_H
 #define EMP_DATA_COLLECT_H
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <limits>
 #include <string>
+#include <type_traits>
 
 #include "emp/tools/string_utils.hpp"
 
+#include "data_sketch.hpp"
+
 namespace emp {
 
   // Count up the number of distinct values.
   template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
   auto BuildCollectFun_Index(FUN_T get_fun, const size_t index) {
     return [get_fun,index](const CONTAIN_T & container) {
-      return emp::to_string( get_fun( container.At(index) ) );
+      return get_fun( container.At(index) );
     };
   }
 
@@ -40,7 +49,19 @@ namespace emp {
       for (const auto & entry : container) {
         vals.insert( get_fun(entry) );
       }
-      return emp::to_string(vals.size());
+      return vals.size();
+    };
+  }
+
+  // Estimate the number of distinct values with HyperLogLog (about 1.6% standard error).
+  template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
+  auto BuildCollectFun_UniqueApprox(FUN_T get_fun) {
+    return [get_fun, sketch=emp::HyperLogLog()](const CONTAIN_T & container) mutable {
+      sketch.Reset();
+      for (const auto & entry : container) {
+        sketch.Add( get_fun(entry) );
+      }
+      return (size_t) std::round(sketch.GetEstimate());
     };
   }
 
@@ -61,7 +82,19 @@ namespace emp {
           mode_val = cur_val;
         }
       }
-      return emp::to_string(mode_val);
+      return mode_val;
+    };
+  }
+
+  // Find the most common value with a Misra-Gries summary (exact if the mode is common enough).
+  template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
+  auto BuildCollectFun_ModeApprox(FUN_T get_fun) {
+    return [get_fun, sketch=emp::MisraGries<DATA_T>()](const CONTAIN_T & container) mutable {
+      sketch.Reset();
+      for (const auto & entry : container) {
+        sketch.Add( get_fun(entry) );
+      }
+      return sketch.GetMode();
     };
   }
 
@@ -79,7 +112,7 @@ namespace emp {
         const DATA_T cur_val = get_fun(entry);
         if (cur_val < min) min = cur_val;
       }
-      return emp::to_string(min);
+      return min;
     };
   }
 
@@ -94,7 +127,7 @@ namespace emp {
         const DATA_T cur_val = get_fun(entry);
         if (cur_val > max) max = cur_val;
       }
-      return emp::to_string(max);
+      return max;
     };
   }
 
@@ -108,22 +141,35 @@ namespace emp {
           total += (double) get_fun(entry);
           count++;
         }
-        return emp::to_string( total / count );
+        return total / count;
       }
-      return std::string{"nan"};
+      return std::numeric_limits<double>::quiet_NaN();
     };
   }
 
   template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
   auto BuildCollectFun_Median(FUN_T get_fun) {
-    return [get_fun](const CONTAIN_T & container) {
-      emp::vector<DATA_T> values(container.size());
-      size_t count = 0;
+    return [get_fun, values=emp::vector<DATA_T>()](const CONTAIN_T & container) mutable {
+      values.resize(0);
+      for (const auto & entry : container) {
+        values.push_back( get_fun(entry) );
+      }
+      if (values.size() == 0) return DATA_T{};
+      auto mid_it = values.begin() + (values.size() / 2);
+      std::nth_element(values.begin(), mid_it, values.end());
+      return *mid_it;
+    };
+  }
+
+  // Estimate the median with a KLL sketch (rank within about 1.7% of N).
+  template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
+  auto BuildCollectFun_MedianApprox(FUN_T get_fun) {
+    return [get_fun, sketch=emp::KLLSketch<DATA_T>()](const CONTAIN_T & container) mutable {
+      sketch.Reset();
       for (const auto & entry : container) {
-        values[count++] = get_fun(entry);
+        sketch.Add( get_fun(entry) );
       }
-      emp::Sort(values);
-      return emp::to_string( values[count/2] );
+      return sketch.GetQuantile(0.5);
     };
   }
 
@@ -143,9 +189,9 @@ namespace emp {
           var_total += cur_val * cur_val;
         }
 
-        return emp::to_string( var_total / (N-1) );
+        return var_total / (N-1);
       }
-      return std::string{"nan"};
+      return std::numeric_limits<double>::quiet_NaN();
     };
   }
 
@@ -165,9 +211,9 @@ namespace emp {
           var_total += cur_val * cur_val;
         }
 
-        return emp::to_string( sqrt(var_total / (N-1)) );
+        return sqrt(var_total / (N-1));
       }
-      return std::string{"nan"};
+      return std::numeric_limits<double>::quiet_NaN();
     };
   }
 
@@ -179,9 +225,9 @@ namespace emp {
         for (const auto & entry : container) {
           total += (double) get_fun(entry);
         }
-        return emp::to_string( total );
+        return total;
       }
-      return std::string{"nan"};
+      return std::numeric_limits<double>::quiet_NaN();
     };
   }
 
@@ -198,13 +244,30 @@ namespace emp {
         double p = ((double) count) / (double) N;
         entropy -= p * log2(p);
       }
-      return emp::to_string(entropy);
+      return entropy;
     };
   }
 
-  template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
-  std::function<std::string(const CONTAIN_T &)>
-  BuildCollectFun(std::string type, FUN_T get_fun) {
+  /// Convert a collected result to a double (NaN if it is not numeric).
+  template <typename T>
+  double CollectToDouble(const T & value) {
+    if constexpr (std::is_arithmetic_v<T>) return (double) value;
+    else return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  /// Adapt a collect function to return RESULT_T by passing its output through convert.
+  template <typename RESULT_T, typename CONTAIN_T, typename COLLECT_T, typename CONVERT_T>
+  std::function<RESULT_T(const CONTAIN_T &)> WrapCollectFun(COLLECT_T collect_fun, CONVERT_T convert) {
+    return [collect_fun, convert](const CONTAIN_T & container) mutable -> RESULT_T {
+      return convert( collect_fun(container) );
+    };
+  }
+
+  /// Identify the requested type of aggregation and build a function for it, using convert
+  /// to turn each result into a RESULT_T.  Returns an empty function if type is unknown.
+  template <typename RESULT_T, typename DATA_T, typename CONTAIN_T, typename FUN_T, typename CONVERT_T>
+  std::function<RESULT_T(const CONTAIN_T &)>
+  BuildCollectFun_Convert(std::string type, FUN_T get_fun, CONVERT_T convert) {
     // ### DEFAULT
     // If no trait function is specified, assume that we should use the first index.
     if (type == "") type = "0";
@@ -212,60 +275,107 @@ namespace emp {
     // Return the index if a simple number was provided.
     if (emp::is_digits(type)) {
       size_t index = emp::from_string<size_t>(type);
-      return emp::BuildCollectFun_Index<DATA_T, CONTAIN_T>(get_fun, index);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Index<DATA_T, CONTAIN_T>(get_fun, index), convert);
     }
 
     // Return the number of distinct values found in this trait.
     else if (type == "unique" || type == "richness") {
-      return emp::BuildCollectFun_Unique<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Unique<DATA_T, CONTAIN_T>(get_fun), convert);
+    }
+
+    // Estimate the number of distinct values found in this trait.
+    else if (type == "unique~" || type == "richness~") {
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_UniqueApprox<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the most common value found for this trait.
     else if (type == "mode" || type == "dom" || type == "dominant") {
-      return emp::BuildCollectFun_Mode<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Mode<DATA_T, CONTAIN_T>(get_fun), convert);
+    }
+
+    // Approximate the most common value found for this trait.
+    else if (type == "mode~" || type == "dom~" || type == "dominant~") {
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_ModeApprox<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the lowest trait value.
     else if (type == "min") {
-      return emp::BuildCollectFun_Min<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Min<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the highest trait value.
     else if (type == "max") {
-      return emp::BuildCollectFun_Max<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Max<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the average trait value.
     else if (type == "ave" || type == "mean") {
-      return emp::BuildCollectFun_Mean<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Mean<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the middle-most trait value.
     else if (type == "median") {
-      return emp::BuildCollectFun_Median<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Median<DATA_T, CONTAIN_T>(get_fun), convert);
+    }
+
+    // Approximate the middle-most trait value.
+    else if (type == "median~") {
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_MedianApprox<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the standard deviation of all trait values.
     else if (type == "variance") {
-      return emp::BuildCollectFun_Variance<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Variance<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the standard deviation of all trait values.
     else if (type == "stddev") {
-      return emp::BuildCollectFun_StandardDeviation<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_StandardDeviation<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the total of all trait values.
     else if (type == "sum" || type=="total") {
-      return emp::BuildCollectFun_Sum<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Sum<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
     // Return the entropy of values for this trait.
     else if (type == "entropy") {
-      return emp::BuildCollectFun_Entropy<DATA_T, CONTAIN_T>(get_fun);
+      return WrapCollectFun<RESULT_T, CONTAIN_T>(
+        emp::BuildCollectFun_Entropy<DATA_T, CONTAIN_T>(get_fun), convert);
     }
 
-    return std::function<std::string(const CONTAIN_T &)>();
+    return std::function<RESULT_T(const CONTAIN_T &)>();
+  }
+
+  /// Build a function that aggregates a container and returns the result as a string.
+  template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
+  std::function<std::string(const CONTAIN_T &)>
+  BuildCollectFun(const std::string & type, FUN_T get_fun) {
+    return BuildCollectFun_Convert<std::string, DATA_T, CONTAIN_T>(type, get_fun,
+      [](const auto & value){ return emp::to_string(value); });
+  }
+
+  /// Build a function that aggregates a container and returns the result as a double, without
+  /// any string conversions.  Results that are not numeric (such as the mode of a string
+  /// trait) are returned as NaN.
+  template <typename DATA_T, typename CONTAIN_T, typename FUN_T>
+  std::function<double(const CONTAIN_T &)>
+  BuildCollectFun_Double(const std::string & type, FUN_T get_fun) {
+    return BuildCollectFun_Convert<double, DATA_T, CONTAIN_T>(type, get_fun,
+      [](const auto & value){ return CollectToDouble(value); });
   }
 
 };
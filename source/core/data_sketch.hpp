@@ -0,0 +1,243 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  data_sketch.hpp
+ *  @brief Fixed-memory streaming summaries for approximate quantiles, richness, and mode.
+ *
+ *  Each sketch takes one value at a time and uses a bounded amount of memory regardless of how
+ *  many values it sees, making them suitable for very large populations.  All sketches can be
+ *  Reset() and reused, so repeated collection does not need to allocate new memory.
+ *
+ *  KLLSketch (quantiles, e.g. the median)
+ *    Compactors at each level hold values with weight 2^level; when a level fills it is sorted
+ *    and every other value (starting at a pseudo-random offset) is promoted to the next level.
+ *    With the default k=200, the rank of the value returned is within about 1.7% of N of the
+ *    requested rank with 99% confidence (Karnin, Lang, and Liberty, 2016), using O(k) memory.
+ *    Results are exact until the first compaction (fewer than about k values).
+ *
+ *  HyperLogLog (number of distinct values)
+ *    Each value is hashed; 2^p registers record the longest run of leading zeros seen for the
+ *    hashes routed to them.  With the default p=12 (4096 one-byte registers) the relative
+ *    standard error is 1.04/sqrt(2^p), or about 1.6%.  Small counts use linear counting and
+ *    are nearly exact.
+ *
+ *  MisraGries (most common value)
+ *    Keeps at most k candidate values with counters; a value that occurs more than N/(k+1)
+ *    times is guaranteed to be a candidate, and each counter underestimates the true count by
+ *    at most N/(k+1).  With the default k=64 the value returned is the true mode whenever the
+ *    mode is more than N/65 ahead of the runner-up.
+ *
+ *  All randomness is drawn from an internal generator with a fixed seed, so the sketches do
+ *  not disturb the main random number generator and give reproducible results.
+ */
+
+#ifndef EMP_DATA_SKETCH_H
+#define EMP_DATA_SKETCH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "emp/base/vector.hpp"
+
+namespace emp {
+
+  /// Mix the bits of a 64-bit value (the SplitMix64 finalizer).
+  inline uint64_t SketchMix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  /// Produce a well-mixed 64-bit hash for any value used in a sketch.
+  template <typename T>
+  uint64_t SketchHash(const T & value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      double dval = (double) value;
+      if (dval == 0.0) dval = 0.0;  // Treat -0.0 and 0.0 as the same value.
+      uint64_t bits;
+      std::memcpy(&bits, &dval, sizeof(bits));
+      return SketchMix(bits);
+    }
+    else if constexpr (std::is_integral_v<T>) return SketchMix((uint64_t) value);
+    else return SketchMix((uint64_t) std::hash<T>{}(value));
+  }
+
+
+  /// Approximate quantiles using a KLL sketch.
+  template <typename T>
+  class KLLSketch {
+  private:
+    size_t k;                            ///< Size of the largest compactor.
+    emp::vector<emp::vector<T>> levels;  ///< Values at each level (weight 2^level)
+    size_t count = 0;                    ///< Total number of values added.
+    uint64_t rand_state = 1;             ///< State for choosing compaction offsets.
+
+    // Scratch space for queries.
+    emp::vector<std::pair<T, uint64_t>> weighted;
+
+    size_t GetCapacity(size_t level) const {
+      const size_t depth = levels.size() - 1 - level;
+      const double cap = std::ceil((double) k * std::pow(2.0 / 3.0, (double) depth));
+      return std::max<size_t>(2, (size_t) cap);
+    }
+
+    bool NextBit() {
+      rand_state = SketchMix(rand_state);
+      return rand_state & 1;
+    }
+
+    /// Promote half of any full level to the level above it.
+    void Compress() {
+      for (size_t level = 0; level < levels.size(); level++) {
+        if (levels[level].size() < GetCapacity(level)) continue;
+        if (level + 1 == levels.size()) levels.emplace_back();
+
+        emp::vector<T> & cur = levels[level];
+        emp::vector<T> & next = levels[level+1];
+        std::sort(cur.begin(), cur.end());
+
+        // If there is an odd number of values, the largest stays at this level.
+        const size_t num_pairs = cur.size() / 2;
+        const size_t offset = NextBit() ? 1 : 0;
+        for (size_t i = 0; i < num_pairs; i++) next.push_back(cur[2*i + offset]);
+        if (cur.size() % 2) cur[0] = cur.back();
+        cur.resize(cur.size() % 2);
+      }
+    }
+
+  public:
+    KLLSketch(size_t _k=200) : k(_k < 8 ? 8 : _k), levels(1) { }
+
+    size_t GetCount() const { return count; }
+
+    void Reset() {
+      levels.resize(1);  // Capacities depend on the number of levels, so start over.
+      levels[0].resize(0);
+      count = 0;
+      rand_state = 1;
+    }
+
+    void Add(const T & value) {
+      levels[0].push_back(value);
+      count++;
+      if (levels[0].size() >= GetCapacity(0)) Compress();
+    }
+
+    /// Return the value at the requested quantile (0.0 to 1.0); with no values, return T{}.
+    T GetQuantile(double q) {
+      weighted.resize(0);
+      uint64_t total = 0;
+      for (size_t level = 0; level < levels.size(); level++) {
+        for (const T & value : levels[level]) weighted.emplace_back(value, 1ULL << level);
+        total += levels[level].size() << level;
+      }
+      if (total == 0) return T{};
+
+      std::sort(weighted.begin(), weighted.end(),
+                [](const auto & a, const auto & b){ return a.first < b.first; });
+
+      // Find the first value whose cumulative weight passes the target rank.
+      const double target = q * (double) total;
+      uint64_t cum_weight = 0;
+      for (const auto & [value, weight] : weighted) {
+        cum_weight += weight;
+        if ((double) cum_weight > target) return value;
+      }
+      return weighted.back().first;
+    }
+  };
+
+
+  /// Approximate count of distinct values using HyperLogLog.
+  class HyperLogLog {
+  private:
+    size_t precision;                    ///< Number of hash bits used to pick a register.
+    emp::vector<uint8_t> registers;
+
+  public:
+    HyperLogLog(size_t _p=12) : precision(std::clamp<size_t>(_p, 4, 18)), registers(1 << precision, 0) { }
+
+    void Reset() { std::fill(registers.begin(), registers.end(), 0); }
+
+    void AddHash(uint64_t hash) {
+      const size_t id = (size_t) (hash >> (64 - precision));
+      uint64_t rest = hash << precision;
+      uint8_t rank = 1;
+      const uint8_t max_rank = (uint8_t) (64 - precision + 1);
+      while (rank < max_rank && !(rest & (1ULL << 63))) { rank++; rest <<= 1; }
+      if (rank > registers[id]) registers[id] = rank;
+    }
+
+    template <typename T>
+    void Add(const T & value) { AddHash(SketchHash(value)); }
+
+    double GetEstimate() const {
+      const double m = (double) registers.size();
+      double inv_total = 0.0;
+      size_t num_zero = 0;
+      for (uint8_t reg : registers) {
+        inv_total += std::ldexp(1.0, -(int) reg);
+        if (reg == 0) num_zero++;
+      }
+      const double alpha = 0.7213 / (1.0 + 1.079 / m);
+      const double estimate = alpha * m * m / inv_total;
+
+      // Small range correction: linear counting is more accurate while registers are empty.
+      if (estimate <= 2.5 * m && num_zero > 0) return m * std::log(m / (double) num_zero);
+      return estimate;
+    }
+  };
+
+
+  /// Find a heavy hitter (approximate mode) using the Misra-Gries summary.
+  template <typename T>
+  class MisraGries {
+  private:
+    size_t k;                              ///< Maximum number of candidates to track.
+    std::unordered_map<T, size_t> counts;  ///< Current candidates and their counters.
+    emp::vector<T> to_remove;              ///< Scratch space for decrementing.
+
+  public:
+    MisraGries(size_t _k=64) : k(_k ? _k : 1) { counts.reserve(k+1); }
+
+    void Reset() { counts.clear(); }
+
+    void Add(const T & value) {
+      auto it = counts.find(value);
+      if (it != counts.end()) { it->second++; return; }
+      if (counts.size() < k) { counts.emplace(value, 1); return; }
+
+      // Table is full; decrement every candidate and drop any that hit zero.
+      to_remove.resize(0);
+      for (auto & [cand, cand_count] : counts) {
+        if (--cand_count == 0) to_remove.push_back(cand);
+      }
+      for (const T & cand : to_remove) counts.erase(cand);
+    }
+
+    /// Return the candidate with the highest counter (ties go to the lower value).
+    T GetMode() const {
+      T mode_val{};
+      size_t mode_count = 0;
+      for (const auto & [cand, cand_count] : counts) {
+        if (cand_count > mode_count || (cand_count == mode_count && cand < mode_val)) {
+          mode_val = cand;
+          mode_count = cand_count;
+        }
+      }
+      return mode_val;
+    }
+  };
+
+}
+
+#endif
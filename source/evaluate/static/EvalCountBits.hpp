@@ -54,6 +54,23 @@ namespace mabe {
       AddOwnedTrait<double>(fitness_trait, "All-ones fitness value", 0.0);
     }
 
+    /// Count the bits of a single organism and store the result in its fitness trait.
+    bool EvaluateOrg(Organism & org) override {
+      // Make sure this organism has its bit sequence ready for us to access.
+      org.GenerateOutput();
+
+      // Count the number of ones in the bit sequence.
+      const emp::BitVector & bits = org.GetVar<emp::BitVector>(bits_trait);
+      double fitness = (double) bits.CountOnes();
+
+      // If we were supposed to count zeros, subtract ones count from total number of bits.
+      if (count_type == 0) fitness = bits.size() - fitness;
+
+      // Store the count on the organism in the fitness trait.
+      org.SetVar<double>(fitness_trait, fitness);
+      return true;
+    }
+
     void OnUpdate(size_t /* update */) override {
       emp_assert(control.GetNumPopulations() >= 1);
 
@@ -62,18 +79,8 @@ namespace mabe {
       emp::Ptr<Organism> max_org = nullptr;
       mabe::Collection alive_collect( target_collect.GetAlive() );
       for (Organism & org : alive_collect) {        
-        // Make sure this organism has its bit sequence ready for us to access.
-        org.GenerateOutput();
-
-        // Count the number of ones in the bit sequence.
-        const emp::BitVector & bits = org.GetVar<emp::BitVector>(bits_trait);
-        double fitness = (double) bits.CountOnes();
-
-        // If we were supposed to count zeros, subtract ones count from total number of bits.
-        if (count_type == 0) fitness = bits.size() - fitness;
-
-        // Store the count on the organism in the fitness trait.
-        org.SetVar<double>(fitness_trait, fitness);
+        EvaluateOrg(org);
+        const double fitness = org.GetVar<double>(fitness_trait);
 
         if (fitness > max_fitness || !max_org) {
           max_fitness = fitness;
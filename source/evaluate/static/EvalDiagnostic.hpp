@@ -72,6 +72,91 @@ namespace mabe {
       AddOwnedTrait<double>(total_trait, "Combined score for current diagnostic.", 0.0);
     }
 
+    /// Score a single organism on the current diagnostic; its values must already be generated.
+    bool ScoreOrg(Organism & org) {
+      // Get access to the data_map elements that we need.
+      const emp::vector<double> & vals = org.GetVar<emp::vector<double>>(vals_trait);
+      emp::vector<double> & scores = org.GetVar<emp::vector<double>>(scores_trait);
+      double & total_score = org.GetVar<double>(total_trait);
+
+      // Initialize output values.
+      scores.resize(vals.size());
+      total_score = 0.0;
+      size_t pos = 0;
+
+      // Determine the scores based on the diagnostic type that we're using.
+      switch (diagnostic_id) {
+      case EXPLOIT:
+        scores = vals;
+        for (double x : scores) total_score += x;
+        break;
+      case STRUCT_EXPLOIT:
+        total_score = scores[0] = vals[0];
+
+        // Use values as long as they are monotonically decreasing.
+        for (pos = 1; pos < vals.size() && vals[pos] <= vals[pos-1]; ++pos) {
+          total_score += (scores[pos] = vals[pos]);
+        }
+
+        // Clear out the remaining values.
+        while (pos < scores.size()) { scores[pos] = 0.0; ++pos; }
+        break;
+      case EXPLORE:
+        // Start at highest value (clearing everything before it)
+        pos = emp::FindMaxIndex(vals);  // Find the position to start.
+        for (size_t i = 0; i < pos; i++) scores[i] = 0.0;
+
+        total_score = scores[pos] = vals[pos];
+        pos++;
+
+        // Use values as long as they are monotonically decreasing.
+        while (pos < vals.size() && vals[pos] <= vals[pos-1]) {
+          total_score += (scores[pos] = vals[pos]);
+          pos++;
+        }
+
+        // Clear out the remaining values.
+        while (pos < scores.size()) { scores[pos] = 0.0; ++pos; }
+
+        break;
+      case DIVERSITY:
+        // Only count highest value
+        pos = emp::FindMaxIndex(vals);  // Find the position to start.
+        total_score = scores[pos] = vals[pos];
+
+        // All others are subtracted from max and divided by two, creating a
+        // pressure to minimize.
+        for (size_t i = 0; i < vals.size(); i++) {
+          if (i != pos) total_score += (scores[i] = (vals[pos] - vals[i]) / 2.0);
+        }
+
+        break;
+      case WEAK_DIVERSITY:
+        // Only count highest value
+        pos = emp::FindMaxIndex(vals);  // Find the position to start.
+        total_score = scores[pos] = vals[pos];
+
+        // Clear all other schores.
+        for (size_t i = 0; i < vals.size(); i++) {
+          if (i != pos) scores[i] = 0.0;
+        }
+
+        break;
+      default:
+        emp_error("Unknown Diganostic.");
+      }
+
+      org.RefreshTraitStats();  // The total was written by reference; report it if tracked.
+      return true;
+    }
+
+    /// Generate the values of a single organism and score them on the current diagnostic.
+    bool EvaluateOrg(Organism & org) override {
+      // Make sure this organism has its values ready for us to access.
+      org.GenerateOutput();
+      return ScoreOrg(org);
+    }
+
     void OnUpdate(size_t /* update */) override {
       emp_assert(control.GetNumPopulations() >= 1);
 
@@ -81,81 +166,13 @@ namespace mabe {
 
       // Loop through the living organisms in the target collection to evaluate each.
       mabe::Collection alive_collect( target_collect.GetAlive() );
-      for (Organism & org : alive_collect) {        
-        // Make sure this organism has its values ready for us to access.
-        org.GenerateOutput();
-
-        // Get access to the data_map elements that we need.
-        const emp::vector<double> & vals = org.GetVar<emp::vector<double>>(vals_trait);
-        emp::vector<double> & scores = org.GetVar<emp::vector<double>>(scores_trait);
-        double & total_score = org.GetVar<double>(total_trait);
-
-        // Initialize output values.
-        scores.resize(vals.size());
-        total_score = 0.0;
-        size_t pos = 0;
-
-        // Determine the scores based on the diagnostic type that we're using.
-        switch (diagnostic_id) {
-        case EXPLOIT:
-          scores = vals;
-          for (double x : scores) total_score += x;
-          break;
-        case STRUCT_EXPLOIT:
-          total_score = scores[0] = vals[0];
-
-          // Use values as long as they are monotonically decreasing.
-          for (pos = 1; pos < vals.size() && vals[pos] <= vals[pos-1]; ++pos) {
-            total_score += (scores[pos] = vals[pos]);
-          }
-
-          // Clear out the remaining values.
-          while (pos < scores.size()) { scores[pos] = 0.0; ++pos; }
-          break;
-        case EXPLORE:
-          // Start at highest value (clearing everything before it)
-          pos = emp::FindMaxIndex(vals);  // Find the position to start.
-          for (size_t i = 0; i < pos; i++) scores[i] = 0.0;
-
-          total_score = scores[pos] = vals[pos];
-          pos++;
 
-          // Use values as long as they are monotonically decreasing.
-          while (pos < vals.size() && vals[pos] <= vals[pos-1]) {
-            total_score += (scores[pos] = vals[pos]);
-            pos++;
-          }
-
-          // Clear out the remaining values.
-          while (pos < scores.size()) { scores[pos] = 0.0; ++pos; }
-
-          break;
-        case DIVERSITY:
-          // Only count highest value
-          pos = emp::FindMaxIndex(vals);  // Find the position to start.
-          total_score = scores[pos] = vals[pos];
-
-          // All others are subtracted from max and divided by two, creating a
-          // pressure to minimize.
-          for (size_t i = 0; i < vals.size(); i++) {
-            if (i != pos) total_score += (scores[i] = (vals[pos] - vals[i]) / 2.0);
-          }
-
-          break;
-        case WEAK_DIVERSITY:
-          // Only count highest value
-          pos = emp::FindMaxIndex(vals);  // Find the position to start.
-          total_score = scores[pos] = vals[pos];
-
-          // Clear all other schores.
-          for (size_t i = 0; i < vals.size(); i++) {
-            if (i != pos) scores[i] = 0.0;
-          }
-
-          break;
-        default:
-          emp_error("Unknown Diganostic.");
-        }
+      // Generate all values as a batch (organism managers may run these in parallel).
+      control.GenerateOutputs(alive_collect);
+
+      for (Organism & org : alive_collect) {
+        ScoreOrg(org);
+        const double total_score = org.GetVar<double>(total_trait);
 
         if (total_score > max_total || !max_org) {
           max_total = total_score;
@@ -60,6 +60,41 @@ namespace mabe {
       landscape.Config(N, K, control.GetRandom());  // Setup the fitness landscape.
     }
 
+    /// The landscape is randomly generated, so it must be saved with any checkpoint.
+    void SerializeState(std::ostream & os) override {
+      const uint64_t size_info[2] = { landscape.GetN(), landscape.GetK() };
+      os.write((const char *) size_info, sizeof(size_info));
+      for (size_t n = 0; n < landscape.GetN(); n++) {
+        for (size_t state = 0; state < landscape.GetStateCount(); state++) {
+          const double fitness = landscape.GetFitness(n, state);
+          os.write((const char *) &fitness, sizeof(fitness));
+        }
+      }
+    }
+
+    bool DeserializeState(std::istream & is) override {
+      uint64_t size_info[2] = { 0, 0 };
+      is.read((char *) size_info, sizeof(size_info));
+      if (!is || size_info[0] != landscape.GetN() || size_info[1] != landscape.GetK()) return false;
+      for (size_t n = 0; n < landscape.GetN(); n++) {
+        for (size_t state = 0; state < landscape.GetStateCount(); state++) {
+          double fitness = 0.0;
+          is.read((char *) &fitness, sizeof(fitness));
+          landscape.SetFitness(n, state, fitness);
+        }
+      }
+      return (bool) is;
+    }
+
+    /// Evaluate a single organism on the NK landscape and store the result in its fitness trait.
+    bool EvaluateOrg(Organism & org) override {
+      org.GenerateOutput();
+      const auto & bits = org.GetVar<emp::BitVector>(bits_trait);
+      if (bits.size() != N) return false;
+      org.SetVar<double>(fitness_trait, landscape.GetFitness(bits));
+      return true;
+    }
+
     void OnUpdate(size_t /* update */) override {
       emp_assert(control.GetNumPopulations() >= 1);
 
@@ -68,15 +103,13 @@ namespace mabe {
       emp::Ptr<Organism> max_org = nullptr;
       mabe::Collection alive_collect( target_collect.GetAlive() );
       for (Organism & org : alive_collect) {
-        org.GenerateOutput();
-        const auto & bits = org.GetVar<emp::BitVector>(bits_trait);
-        if (bits.size() != N) {
-          AddError("Org returns ", bits.size(), " bits, but ",
+        if (!EvaluateOrg(org)) {
+          AddError("Org returns ", org.GetVar<emp::BitVector>(bits_trait).size(), " bits, but ",
                    N, " bits needed for NK landscape.",
                    "\nOrg: ", org.ToString());
+          continue;
         }
-        double fitness = landscape.GetFitness(bits);
-        org.SetVar<double>(fitness_trait, fitness);
+        const double fitness = org.GetVar<double>(fitness_trait);
 
         if (fitness > max_fitness || !max_org) {
           max_fitness = fitness;
@@ -10,17 +10,41 @@
  * 
  *  Example:
  *   update, main_pop.ave.generation, main_pop.ave.score, main_pop.max.score
+ *
+ *  By default the output is written as CSV text.  Setting format_type to "binary" instead
+ *  writes a column-chunked binary file (see tools/ColumnFile.hpp) with the update as an
+ *  integer column and every other column stored as doubles; values that are not numeric
+ *  are recorded as NaN.  Rows are buffered and written out `chunk_rows` at a time.
+ *
+ *  If a filter is provided (such as "fitness>0.5 && generation<100"; see TraitPredicate.hpp),
+ *  each output only includes the living organisms from the target that satisfy it.
+ *
+ *  Numeric results are collected as doubles and only converted to text when a CSV row is
+ *  written; only columns summarizing non-numeric traits are collected as strings.
+ *
+ *  All writing is handed off to the shared AsyncWriter, so the disk is accessed on a
+ *  separate I/O thread rather than during updates.
+ *
+ *  Columns asking for the min, max, mean, variance, stddev, or sum of a numeric trait are
+ *  all calculated together by a TraitSummary, which reads each trait once per organism in a
+ *  single (optionally multi-threaded) pass.  Other columns are collected individually.
  */
 
 #ifndef MABE_FILE_OUTPUT_H
 #define MABE_FILE_OUTPUT_H
 
-#include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
 
 #include "emp/tools/string_utils.hpp"
 
 #include "../core/MABE.hpp"
 #include "../core/Module.hpp"
+#include "../core/TraitSummary.hpp"
+#include "../tools/ColumnFile.hpp"
+#include "../tools/ThreadPool.hpp"
 
 namespace mabe {
 
@@ -29,43 +53,112 @@ namespace mabe {
     std::string filename;
     std::string format;
     Collection target_collect;
+    std::string filter;           ///< Trait expression limiting which organisms are included.
+    Collection filtered_collect;  ///< Organisms from target_collect that pass the filter.
     int start_ud=0;    ///< When should outputs start being printed?
     int step_ud=1;     ///< How often should outputs be printed?
     int stop_ud=-1;    ///< When should outputs stop being printed?
     bool init = false; ///< Has the file been initialized?
+    bool resume = false;    ///< Are we continuing a file from a restored checkpoint?
+    uint64_t resume_pos=0;  ///< Size of the file when the checkpoint was saved.
+
+    enum OutputType { OUTPUT_CSV=0, OUTPUT_BINARY };
+    OutputType format_type = OUTPUT_CSV;  ///< Should the file be written as text or binary?
+    size_t chunk_rows = 64;               ///< Rows to buffer per chunk in binary output.
+    ColumnFileWriter col_writer;          ///< Buffer for binary output.
 
     // Calculated values from the inputs.
     using trait_fun_t = std::function<std::string(const Collection &)>;
+    using value_fun_t = std::function<double(const Collection &)>;
     emp::vector<std::string> cols;  ///< Names of the columns to use.
-    emp::vector<trait_fun_t> funs;  ///< Functions to call each update.
-    std::ofstream file;
+    emp::vector<trait_fun_t> funs;  ///< Functions for non-numeric columns in text output.
+    emp::vector<value_fun_t> value_funs;  ///< Functions for numeric columns.
+    emp::vector<double> values;     ///< Numeric value of each column in the current row.
+    emp::vector<int> summary_cols;  ///< Column in the summary for each column (-1 if none).
+    TraitSummary summary;           ///< Single-pass calculation of all simple statistics.
+    size_t num_threads = 1;         ///< Threads to use when calculating the summary.
+    ThreadPool thread_pool;
+    int file_id = -1;               ///< ID of our file in the shared AsyncWriter.
+    std::stringstream out;          ///< Output waiting to be sent to the writer.
 
     // Setup the columns to be printed right before the first time we print
     // (to make sure all of the values we are using have known types.)
     void InitializeFile() {
-      // Open the file that we will be writing to.
-      file.open(filename);
+      // Open the file that we will be writing to.  If resuming from a checkpoint, drop anything
+      // written after the checkpoint was saved and then continue from there.
+      if (resume) {
+        std::error_code ec;
+        std::filesystem::resize_file(filename, resume_pos, ec);
+        if (ec) AddWarning("Unable to truncate '", filename, "' to checkpoint: ", ec.message());
+      }
+      file_id = control.GetAsyncWriter().Open(filename, resume);
+      if (file_id < 0) AddError("FileOutput unable to open file '", filename, "'.");
 
       // Identify the contents of each column.
       emp::remove_whitespace(format);
       emp::slice(format, cols, ',');
 
-      // Setup a function to collect data associated with each column.
+      // Setup a function to collect data associated with each column; simple statistics of
+      // numeric traits are instead added to the summary.
+      const emp::DataMap & data_map = control.GetOrgDataMap();
       funs.resize(cols.size());
+      value_funs.resize(cols.size());
+      values.resize(cols.size());
+      summary_cols.resize(cols.size());
       for (size_t i = 0; i < cols.size(); i++) {
         std::string trait_filter = cols[i];
         std::string trait_name = emp::string_pop(trait_filter,':');
-        funs[i] = control.BuildTraitFunction(trait_name, trait_filter);
+        TraitSummary::Stat stat;
+        if (data_map.HasName(trait_name) &&
+            data_map.GetType(trait_name).IsArithmetic() &&
+            TraitSummary::GetStat(trait_filter, stat)) {
+          const size_t trait_id = data_map.GetID(trait_name);
+          summary_cols[i] = (int) summary.AddColumn(trait_id, data_map.GetType(trait_id), stat);
+        }
+        else {
+          summary_cols[i] = -1;
+          const bool text_col = data_map.HasName(trait_name) &&
+                                !data_map.GetType(trait_name).IsArithmetic();
+          if (text_col && format_type == OUTPUT_CSV) {
+            funs[i] = control.BuildTraitFunction(trait_name, trait_filter);
+          }
+          else value_funs[i] = control.BuildTraitValueFunction(trait_name, trait_filter);
+        }
       }
 
-      // Print the headers into the file.
-      file << "#update";
-      for (size_t i = 0; i < cols.size(); i++) {
-        file << ", " << cols[i];
+      // Binary files describe each column in the header (unless it is already there).
+      if (format_type == OUTPUT_BINARY) {
+        col_writer.SetChunkRows(chunk_rows);
+        col_writer.AddColumn("update", ColumnFile::Type::INT64);
+        for (const std::string & col : cols) col_writer.AddColumn(col, ColumnFile::Type::DOUBLE);
+        if (!resume) col_writer.WriteHeader(out);
+      }
+
+      // Print the headers into the file (unless they are already there).
+      else if (!resume) {
+        out << "#update";
+        for (size_t i = 0; i < cols.size(); i++) {
+          out << ", " << cols[i];
+        }
+        out << '\n';
       }
-      file << '\n';
 
       init = true;
+      SendOutput();
+    }
+
+    /// Hand everything in the local output buffer to the writer.
+    void SendOutput() {
+      if (file_id >= 0 && out.tellp() > 0) control.GetAsyncWriter().Write((size_t) file_id, out.str());
+      out.str("");
+    }
+
+    /// Format a numeric value for text output; whole numbers are printed exactly.
+    static std::string FormatValue(double value) {
+      if (value == std::floor(value) && std::abs(value) < 9007199254740992.0) {
+        return emp::to_string((int64_t) value);
+      }
+      return emp::to_string(value);
     }
 
     void DoOutput(size_t ud) {
@@ -76,12 +169,32 @@ namespace mabe {
           (stop_ud != -1 && (int) ud > stop_ud) ||
           ((ud - start_ud)%step_ud != 0) ) return;
 
-      // If so, print!
-      file << ud;
-      for (auto & fun : funs) {
-        file << ", " << fun(target_collect);
+      // If so, determine which organisms to include...
+      const Collection & collect =
+        filter.size() ? (filtered_collect = control.SelectWhere(target_collect, filter)) : target_collect;
+
+      // ...collect all numeric values...
+      if (summary.GetNumColumns()) summary.Collect(collect, thread_pool);
+      for (size_t i = 0; i < cols.size(); i++) {
+        if (summary_cols[i] >= 0) values[i] = summary.GetResult((size_t) summary_cols[i]);
+        else if (value_funs[i]) values[i] = value_funs[i](collect);
+      }
+
+      // ...and print!
+      if (format_type == OUTPUT_BINARY) {
+        col_writer.AddValue((int64_t) ud);
+        for (double value : values) col_writer.AddValue(value);
+        col_writer.EndRow(out);
+      }
+      else {
+        out << ud;
+        for (size_t i = 0; i < cols.size(); i++) {
+          if (funs[i]) out << ", " << funs[i](collect);
+          else out << ", " << FormatValue(values[i]);
+        }
+        out << '\n';
       }
-      file << std::endl;
+      SendOutput();
     }
 
   public:
@@ -99,11 +212,35 @@ namespace mabe {
       LinkVar(filename, "filename", "Name of file for output data.");
       LinkVar(format, "format", "Column format to use in the file.");
       LinkCollection(target_collect, "target", "Which population(s) should we print from?");
+      LinkVar(filter, "filter", "Only include organisms matching this trait expression (e.g., \"fitness>0.5\")");
       LinkRange(start_ud, step_ud, stop_ud, "output_updates", "Which updates should we output data?");
+      LinkMenu(format_type, "format_type", "How should the output file be written?",
+               OUTPUT_CSV, "csv", "Comma-separated text.",
+               OUTPUT_BINARY, "binary", "Column-chunked binary (see tools/ColumnFile.hpp).");
+      LinkVar(chunk_rows, "chunk_rows", "Number of rows to buffer per chunk in binary output.");
+      LinkVar(num_threads, "num_threads", "Threads for calculating summary columns (0 = all available)");
     }
 
     void SetupModule() override {
-      // Nothing for now.
+      thread_pool.Resize(num_threads);
+    }
+
+    /// Record how much of the file was written, so a restored run can continue it.
+    void SerializeState(std::ostream & os) override {
+      uint64_t file_pos = 0;
+      if (init && file_id >= 0) {
+        col_writer.WriteChunk(out);
+        SendOutput();
+        control.GetAsyncWriter().Flush();
+        file_pos = control.GetAsyncWriter().GetFilePos((size_t) file_id);
+      }
+      os.write((const char *) &file_pos, sizeof(file_pos));
+    }
+
+    bool DeserializeState(std::istream & is) override {
+      is.read((char *) &resume_pos, sizeof(resume_pos));
+      resume = (resume_pos > 0);
+      return (bool) is;
     }
 
     void BeforeUpdate(size_t ud) override {
@@ -113,7 +250,12 @@ namespace mabe {
     void BeforeExit() override {
       // Do a final printing at the end and close the file.
       DoOutput(control.GetUpdate());
-      file.close();
+      if (init && file_id >= 0) {
+        col_writer.WriteChunk(out);
+        SendOutput();
+        control.GetAsyncWriter().Close((size_t) file_id);
+        file_id = -1;
+      }
     }
 
   };
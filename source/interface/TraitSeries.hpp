@@ -0,0 +1,181 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  TraitSeries.hpp
+ *  @brief Module to record the history of trait statistics in memory for online analysis.
+ *
+ *  Each update, every column in the format (using the same trait filters as FileOutput, such
+ *  as "fitness:max, fitness:mean") is calculated over the target collection and recorded in a
+ *  MABE time series (see core/TimeSeries.hpp) named "<module name>.<column>".  Other modules
+ *  can then read recent history with control.GetTimeSeries() (e.g., to detect stagnation), and
+ *  config files with series_mean(), series_slope(), series_min(), series_max(), and
+ *  series_last().
+ *
+ *  If a filename is provided, recorded samples are also written to it as CSV, in bulk, every
+ *  flush_updates updates (and at the end of the run).  Checkpoints save the recorded history
+ *  and how much of the file was written; a restored run truncates the file to that point and
+ *  appends to it.
+ */
+
+#ifndef MABE_TRAIT_SERIES_H
+#define MABE_TRAIT_SERIES_H
+
+#include <filesystem>
+#include <sstream>
+#include <system_error>
+
+#include "emp/datastructs/vector_utils.hpp"
+#include "emp/tools/string_utils.hpp"
+
+#include "../core/MABE.hpp"
+#include "../core/Module.hpp"
+#include "../core/TimeSeries.hpp"
+
+namespace mabe {
+
+  class TraitSeries : public Module {
+  private:
+    std::string format;
+    Collection target_collect;
+    std::string filename = "";     ///< File for bulk output (none if empty).
+    size_t flush_updates = 100;    ///< How many updates should we wait between writes?
+
+    using value_fun_t = std::function<double(const Collection &)>;
+    emp::vector<std::string> cols;                  ///< Names of the columns to record.
+    emp::vector<value_fun_t> value_funs;            ///< Function to calculate each column.
+    emp::vector<emp::Ptr<TimeSeries>> series;       ///< Where each column is recorded.
+    int file_id = -1;                               ///< ID of our file in the AsyncWriter.
+    bool resume = false;                            ///< Continuing a file from a checkpoint?
+    uint64_t resume_pos = 0;                        ///< File size when the checkpoint was saved.
+
+    /// Write all samples recorded since the last flush as rows of the output file.
+    void Flush() {
+      if (file_id < 0 || series.size() == 0) return;
+      std::stringstream out;
+      const size_t num_rows = series[0]->GetNumUnflushed();
+      for (size_t row = 0; row < num_rows; row++) {
+        out << series[0]->GetUnflushed(row).update;
+        for (emp::Ptr<TimeSeries> col_series : series) {
+          out << ", " << emp::to_string(col_series->GetUnflushed(row).value);
+        }
+        out << '\n';
+      }
+      for (emp::Ptr<TimeSeries> col_series : series) col_series->MarkFlushed();
+      if (num_rows) control.GetAsyncWriter().Write((size_t) file_id, out.str());
+    }
+
+  public:
+    TraitSeries(mabe::MABE & control,
+                const std::string & name="TraitSeries",
+                const std::string & desc="Module to record recent history of trait statistics.")
+      : Module(control, name, desc), format("fitness:max,fitness:mean"),
+        target_collect(control.GetPopulation(0))
+    {
+      SetInterfaceMod();
+    }
+    ~TraitSeries() { }
+
+    void SetupConfig() override {
+      LinkVar(format, "format", "Columns to record (same trait filters as FileOutput).");
+      LinkCollection(target_collect, "target", "Which population(s) should we record from?");
+      LinkVar(filename, "filename", "File to write recorded samples to (leave empty for none).");
+      LinkVar(flush_updates, "flush_updates", "Updates between bulk writes to the file.");
+    }
+
+    void SetupModule() override {
+      emp::remove_whitespace(format);
+      emp::slice(format, cols, ',');
+
+      for (const std::string & col : cols) {
+        series.push_back(&control.AddTimeSeries(GetName() + "." + col,
+                                                "Column '" + col + "' of module " + GetName()));
+      }
+
+      // Samples must be written before the ring buffer wraps around.
+      if (filename.size() && series.size() && flush_updates > series[0]->GetCapacity()) {
+        AddWarning("TraitSeries flush_updates (", flush_updates, ") is more than series_capacity; ",
+                   "reducing to ", series[0]->GetCapacity(), ".");
+        flush_updates = series[0]->GetCapacity();
+      }
+      if (flush_updates == 0) flush_updates = 1;
+    }
+
+    /// Record how much of the file was written, along with the history of each column.
+    void SerializeState(std::ostream & os) override {
+      uint64_t file_pos = 0;
+      if (file_id >= 0) {
+        Flush();
+        control.GetAsyncWriter().Flush();
+        file_pos = control.GetAsyncWriter().GetFilePos((size_t) file_id);
+      }
+      WriteBinary(os, file_pos);
+      WriteBinary<uint64_t>(os, cols.size());
+      for (size_t i = 0; i < cols.size(); i++) {
+        WriteBinaryString(os, cols[i]);
+        series[i]->Serialize(os);
+      }
+    }
+
+    bool DeserializeState(std::istream & is) override {
+      uint64_t num_cols = 0;
+      ReadBinary(is, resume_pos);
+      ReadBinary(is, num_cols);
+      resume = (resume_pos > 0);
+      std::string col;
+      for (uint64_t i = 0; i < num_cols && is; i++) {
+        ReadBinaryString(is, col);
+        const int col_id = emp::FindValue(cols, col);
+        if (col_id != -1) series[(size_t) col_id]->Deserialize(is);
+        else TimeSeries(col).Deserialize(is);   // Column no longer recorded; skip its history.
+      }
+      return (bool) is;
+    }
+
+    void BeforeUpdate(size_t ud) override {
+      // Build the functions when the first sample is needed, so all traits are known.
+      if (value_funs.size() != cols.size()) {
+        for (const std::string & col : cols) {
+          std::string trait_filter = col;
+          std::string trait_name = emp::string_pop(trait_filter,':');
+          value_funs.push_back(control.BuildTraitValueFunction(trait_name, trait_filter));
+        }
+
+        if (filename.size()) {
+          // If resuming, drop anything written after the checkpoint and continue from there.
+          if (resume) {
+            std::error_code ec;
+            std::filesystem::resize_file(filename, resume_pos, ec);
+            if (ec) AddWarning("Unable to truncate '", filename, "' to checkpoint: ", ec.message());
+          }
+          file_id = control.GetAsyncWriter().Open(filename, resume);
+          if (file_id < 0) AddError("TraitSeries unable to open file '", filename, "'.");
+          else if (!resume) {
+            std::string header = "#update";
+            for (const std::string & col : cols) header += ", " + col;
+            control.GetAsyncWriter().Write((size_t) file_id, header + "\n");
+          }
+        }
+      }
+
+      for (size_t i = 0; i < cols.size(); i++) {
+        series[i]->Add(ud, value_funs[i](target_collect));
+      }
+
+      if (series.size() && series[0]->GetNumUnflushed() >= flush_updates) Flush();
+    }
+
+    void BeforeExit() override {
+      Flush();
+      if (file_id >= 0) {
+        control.GetAsyncWriter().Close((size_t) file_id);
+        file_id = -1;
+      }
+    }
+  };
+
+  MABE_REGISTER_MODULE(TraitSeries, "Record recent history of trait statistics for online analysis.");
+}
+
+#endif
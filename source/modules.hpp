@@ -7,6 +7,10 @@
  *  @brief A full set of all standard modules available in MABE.
  */
 
+// Analysis Modules
+#include "analyze/EventJournal.hpp"
+#include "analyze/TrackSystematics.hpp"
+
 // Evaluation Modules
 #include "evaluate/static/EvalCountBits.hpp"
 #include "evaluate/static/EvalDiagnostic.hpp"
@@ -16,6 +20,7 @@
 // Interface Modules
 #include "interface/CommandLine.hpp"
 #include "interface/FileOutput.hpp"
+#include "interface/TraitSeries.hpp"
 
 // Placement Modules
 #include "placement/GrowthPlacement.hpp"
@@ -26,10 +31,14 @@
 #include "select/SelectLexicase.hpp"
 
 // Other schema
+#include "schema/IslandMigration.hpp"
 #include "schema/MovePopulation.hpp"
+#include "schema/ProcessMigration.hpp"
+#include "schema/SteadyState.hpp"
 #include "schema/Mutate.hpp"
 
 // Organism Types
 #include "orgs/AvidaGPOrg.hpp"
 #include "orgs/BitsOrg.hpp"
+#include "orgs/SimpleProgramOrg.hpp"
 #include "orgs/ValsOrg.hpp"
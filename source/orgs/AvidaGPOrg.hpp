@@ -6,15 +6,39 @@
  *  @file  AvidaGPOrg.hpp
  *  @brief An organism consisting of lineaer code.
  *  @note Status: ALPHA
+ *
+ *  Organisms only store their programs (so cloning one copies no hardware state).  Anything
+ *  that needs hardware, including each evaluation, checks out a reusable hardware instance
+ *  from the manager (one per concurrently evaluating thread) and loads the program into it;
+ *  evaluations then run it for eval_time cycles.  Outputs are written into a fixed-size
+ *  vector trait of num_outputs values (output IDs outside of that range are ignored), so a
+ *  warmed-up evaluation does not need to allocate a new trait.
+ *
+ *  The manager can also evaluate a whole batch of organisms with GenerateOutputs() (as
+ *  evaluators such as EvalDiagnostic do through MABE::GenerateOutputs()), which spreads them
+ *  across num_threads threads; each thread reuses a single hardware instance for its entire
+ *  share of the batch.
+ *
+ *  When compiled with MABE_PROFILE_ORGS, each evaluation counts the instructions executed of
+ *  each type and sets the traits profile_insts and profile_eval_us; per-update totals are
+ *  recorded as time series (see tools/OrgProfiler.hpp).
  */
 
 #ifndef MABE_AVIDA_GP_ORGANISM_H
 #define MABE_AVIDA_GP_ORGANISM_H
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
 #include "../core/MABE.hpp"
 #include "../core/Organism.hpp"
 #include "../core/OrganismManager.hpp"
+#include "../tools/OrgProfiler.hpp"
+#include "../tools/ThreadPool.hpp"
 
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
 #include "emp/hardware/AvidaGP.hpp"
 #include "emp/math/Distribution.hpp"
 #include "emp/math/random_utils.hpp"
@@ -22,12 +46,84 @@
 namespace mabe {
 
   class AvidaGPOrg : public OrganismTemplate<AvidaGPOrg> {
+  public:
+    using genome_t = emp::AvidaGP::genome_t;
+
   protected:
-    emp::AvidaGP hardware;
+    genome_t genome;  ///< The program; it is only ever run on manager hardware.
+
+    /// The program of a default hardware instance, used by new organisms.
+    static const genome_t & DefaultGenome() {
+      static const emp::AvidaGP default_hardware;
+      return default_hardware.GetGenome();
+    }
+
+    /// Check out manager hardware, load this organism's program into it, and pass it to fun.
+    template <typename FUN_T>
+    void WithHardware(FUN_T && fun) const {
+      const ManagerData & data = SharedData();
+      emp::Ptr<EvalContext> context = data.AcquireContext();
+      context->hardware.SetGenome(genome);
+      fun(context->hardware);
+      data.ReleaseContext(context);
+    }
+
+    /// As WithHardware(), but keep any changes that fun makes to the program.
+    template <typename FUN_T>
+    void EditOnHardware(FUN_T && fun) {
+      WithHardware([this, &fun](emp::AvidaGP & cpu){
+        fun(cpu);
+        genome = cpu.GetGenome();
+      });
+    }
+
+    /// Load this organism's program into the provided hardware, run it, and store the outputs.
+    void Evaluate(emp::AvidaGP & cpu) {
+      ManagerData & data = SharedData();
+      cpu.SetGenome(genome);
+      cpu.ResetHardware();
+
+      // @CAO Setup the input!
+      // org.SetInputs(game.AsInput(game.GetCurPlayer()));
+
+      // Run the code.
+#ifdef MABE_PROFILE_ORGS
+      const auto start_time = std::chrono::steady_clock::now();
+      thread_local emp::vector<uint64_t> op_counts;
+      op_counts.resize(0);
+      op_counts.resize(data.profiler.GetNumOps(), 0);
+      const size_t num_insts = cpu.GetSize() ? data.eval_time : 0;
+      for (size_t i = 0; i < num_insts; i++) {
+        const size_t ip = (cpu.GetIP() < cpu.GetSize()) ? cpu.GetIP() : 0;
+        op_counts[cpu.GetInst(ip).id]++;
+        cpu.SingleProcess();
+      }
+      const double eval_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start_time).count();
+      data.profiler.AddEval(op_counts.data(), num_insts, eval_us);
+      SetVar<double>("profile_insts", (double) num_insts);
+      SetVar<double>("profile_eval_us", eval_us);
+#else
+      cpu.Process(data.eval_time);
+#endif
+
+      // Store the results in place.
+      emp::vector<double> & outputs = GetVar<emp::vector<double>>(data.output_name);
+      outputs.resize(data.num_outputs);
+      std::fill(outputs.begin(), outputs.end(), 0.0);
+      for (const auto & [id, value] : cpu.GetOutputs()) {
+        if (id >= 0 && (size_t) id < outputs.size()) outputs[(size_t) id] = value;
+      }
+    }
 
   public:
+    /// Scratch space for running a program; reused across evaluations.
+    struct EvalContext {
+      emp::AvidaGP hardware;
+    };
+
     AvidaGPOrg(OrganismManager<AvidaGPOrg> & _manager)
-      : OrganismTemplate<AvidaGPOrg>(_manager) { }
+      : OrganismTemplate<AvidaGPOrg>(_manager), genome(DefaultGenome()) { }
     AvidaGPOrg(const AvidaGPOrg &) = default;
     AvidaGPOrg(AvidaGPOrg &&) = default;
     ~AvidaGPOrg() { ; }
@@ -38,87 +134,192 @@ namespace mabe {
       size_t init_length = 100;            ///< Length of new organisms.
       bool init_random = true;             ///< Should we randomize ancestor?  (false = all zeros)
       size_t eval_time = 500;              ///< How long should the CPU be given on each evaluate?
-      std::string output_name = "output";  ///< Name of trait that should be used to access bits.
+      std::string output_name = "output";  ///< Name of trait that should be used to access outputs.
+      size_t num_outputs = 16;             ///< Number of output values to record.
+      size_t num_threads = 1;              ///< Threads for batch evaluation (0 = all available)
 
       // Internal use
       emp::Binomial mut_dist;            ///< Distribution of number of mutations to occur.
       emp::BitVector mut_sites;            ///< A pre-allocated vector for mutation sites. 
+
+      // Hardware contexts; one is checked out by each thread using hardware.
+      mutable emp::vector<emp::Ptr<EvalContext>> contexts;       ///< All contexts created.
+      mutable emp::vector<emp::Ptr<EvalContext>> free_contexts;  ///< Contexts not currently in use.
+      mutable std::mutex context_mutex;                          ///< Protects both context lists.
+      ThreadPool thread_pool;                                    ///< Threads for batch evaluation.
+
+      ~ManagerData() { for (emp::Ptr<EvalContext> context : contexts) context.Delete(); }
+
+      emp::Ptr<EvalContext> AcquireContext() const {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        if (free_contexts.size() == 0) {
+          contexts.push_back(emp::NewPtr<EvalContext>());
+          return contexts.back();
+        }
+        emp::Ptr<EvalContext> context = free_contexts.back();
+        free_contexts.pop_back();
+        return context;
+      }
+
+      void ReleaseContext(emp::Ptr<EvalContext> context) const {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        free_contexts.push_back(context);
+      }
+
+      /// Evaluate a batch of AvidaGPOrg organisms, splitting them across threads.  Traits
+      /// written during evaluation are reported to population statistics afterward.
+      void GenerateOutputs(const emp::vector<emp::Ptr<Organism>> & orgs) {
+        thread_pool.ParallelChunks(orgs.size(), 16, [this, &orgs](size_t, size_t start, size_t end){
+          Organism::DeferTraitStats defer_stats;
+          emp::Ptr<EvalContext> context = AcquireContext();
+          for (size_t i = start; i < end; i++) {
+            static_cast<AvidaGPOrg &>(*orgs[i]).Evaluate(context->hardware);
+          }
+          ReleaseContext(context);
+        });
+        for (emp::Ptr<Organism> org : orgs) org->RefreshTraitStats();
+      }
+
+#ifdef MABE_PROFILE_ORGS
+      OrgProfiler profiler;
+
+      void OnUpdate(MABE & control, const std::string & manager_name, size_t /* update */) {
+        profiler.Flush([&control, &manager_name](const std::string & name, double value){
+          control.RecordSample(manager_name + ".profile." + name, value);
+        });
+      }
+#endif
     };
 
+    const genome_t & GetGenome() const { return genome; }
+
     /// Use "to_string" to convert.
-    std::string ToString() const override { return hardware.ToString(); }
+    std::string ToString() const override {
+      std::string out;
+      WithHardware([&out](emp::AvidaGP & cpu){ out = cpu.ToString(); });
+      return out;
+    }
 
     size_t Mutate(emp::Random & random) override {
       const size_t num_muts = SharedData().mut_dist.PickRandom(random);
 
       if (num_muts == 0) return 0;
-      if (num_muts == 1) {
-        const size_t pos = random.GetUInt(hardware.GetSize());
-        hardware.RandomizeInst(pos, random);
-        return 1;
-      }
+      EditOnHardware([this, num_muts, &random](emp::AvidaGP & cpu){
+        if (num_muts == 1) {
+          const size_t pos = random.GetUInt(cpu.GetSize());
+          cpu.RandomizeInst(pos, random);
+          return;
+        }
 
-      // Only remaining option is num_muts > 1.
-      auto & mut_sites = SharedData().mut_sites;
-      mut_sites.Clear();
-      for (size_t i = 0; i < num_muts; i++) {
-        const size_t pos = random.GetUInt(hardware.GetSize());
-        if (mut_sites[pos]) { --i; continue; }  // Duplicate position; try again.
-        hardware.RandomizeInst(pos, random);
-      }
+        // Only remaining option is num_muts > 1.
+        auto & mut_sites = SharedData().mut_sites;
+        mut_sites.Clear();
+        for (size_t i = 0; i < num_muts; i++) {
+          const size_t pos = random.GetUInt(cpu.GetSize());
+          if (mut_sites[pos]) { --i; continue; }  // Duplicate position; try again.
+          cpu.RandomizeInst(pos, random);
+        }
+      });
 
       return num_muts;
     }
 
     void Randomize(emp::Random & random) override {
-      for (size_t pos = 0; pos < hardware.GetSize(); pos++) {
-        hardware.RandomizeInst(pos, random);
-      }
+      EditOnHardware([&random](emp::AvidaGP & cpu){
+        for (size_t pos = 0; pos < cpu.GetSize(); pos++) cpu.RandomizeInst(pos, random);
+      });
     }
 
     void Initialize(emp::Random & random) override {
       if (SharedData().init_random) Randomize(random);
     }
 
-    /// Put the output values in the correct output position.
-    /// (Should be of type std::unordered_map<int,double>)
-    void GenerateOutput() override {
-      hardware.ResetHardware();
-
-      // @CAO Setup the input!
-      // org.SetInputs(game.AsInput(game.GetCurPlayer()));
+    /// Write the number of instructions followed by the id and arguments of each.
+    bool Serialize(std::ostream & os) const override {
+      WithHardware([&os](emp::AvidaGP & cpu){
+        const uint64_t num_insts = cpu.GetSize();
+        os.write((const char *) &num_insts, sizeof(num_insts));
+        for (size_t pos = 0; pos < num_insts; pos++) {
+          const auto & inst = cpu.GetInst(pos);
+          const uint32_t inst_data[4] = { (uint32_t) inst.id, (uint32_t) inst.args[0],
+                                          (uint32_t) inst.args[1], (uint32_t) inst.args[2] };
+          os.write((const char *) inst_data, sizeof(inst_data));
+        }
+      });
+      return (bool) os;
+    }
 
-      // Run the code.
-      hardware.Process(SharedData().eval_time);
+    bool Deserialize(std::istream & is) override {
+      uint64_t num_insts = 0;
+      if (!is.read((char *) &num_insts, sizeof(num_insts))) return false;
+      bool success = true;
+      EditOnHardware([&is, num_insts, &success](emp::AvidaGP & cpu){
+        cpu.Reset();
+        const size_t num_ops = cpu.GetInstLib()->GetSize();
+        for (size_t pos = 0; pos < num_insts && success; pos++) {
+          uint32_t inst_data[4];
+          // Reject unknown instructions or registers rather than trusting the stream.
+          success = is.read((char *) inst_data, sizeof(inst_data)) && inst_data[0] < num_ops &&
+                    inst_data[1] < emp::AvidaGP::CPU_SIZE && inst_data[2] < emp::AvidaGP::CPU_SIZE &&
+                    inst_data[3] < emp::AvidaGP::CPU_SIZE;
+          if (success) cpu.PushInst(inst_data[0], inst_data[1], inst_data[2], inst_data[3]);
+        }
+      });
+      return success;
+    }
 
-      // Store the results.
-      SetVar<std::unordered_map<int,double>>(SharedData().output_name, hardware.GetOutputs());
+    /// Put the output values in the correct output position.
+    /// (Should be of type emp::vector<double>)
+    void GenerateOutput() override {
+      ManagerData & data = SharedData();
+      emp::Ptr<EvalContext> context = data.AcquireContext();
+      Evaluate(context->hardware);
+      data.ReleaseContext(context);
     }
 
     /// Setup this organism type to be able to load from config.
     void SetupConfig() override {
       GetManager().LinkVar(SharedData().mut_prob, "mut_prob",
                       "Probability of each instruction mutating on reproduction.");
-      GetManager().LinkFuns<size_t>([this](){ return hardware.size(); },
-                       [this](const size_t & N){ hardware.Reset(); hardware.PushDefaultInst(N); },
-                       "N", "Initial number of instructions in genome");
+      GetManager().LinkFuns<size_t>(
+        [this](){ size_t N = 0; WithHardware([&N](emp::AvidaGP & cpu){ N = cpu.GetSize(); }); return N; },
+        [this](const size_t & N){ EditOnHardware([N](emp::AvidaGP & cpu){ cpu.Reset(); cpu.PushDefaultInst(N); }); },
+        "N", "Initial number of instructions in genome");
       GetManager().LinkVar(SharedData().init_random, "init_random",
                       "Should we randomize ancestor?  (0 = \"blank\" default)");
       GetManager().LinkVar(SharedData().eval_time, "eval_time",
                       "How many CPU cycles should we give organisms to run?");
       GetManager().LinkVar(SharedData().output_name, "output_name",
-                      "Name of variable to contain bit sequence.");
+                      "Name of variable to contain set of output values.");
+      GetManager().LinkVar(SharedData().num_outputs, "num_outputs",
+                      "Number of output values to record.");
+      GetManager().LinkVar(SharedData().num_threads, "num_threads",
+                      "Threads for evaluating batches of organisms (0 = all available)");
     }
 
     /// Setup this organism type with the traits it need to track.
     void SetupModule() override {
       // Setup the default vector to indicate mutation positions.
-      SharedData().mut_sites.Resize(hardware.GetSize());
+      WithHardware([this](emp::AvidaGP & cpu){ SharedData().mut_sites.Resize(cpu.GetSize()); });
 
       // Setup the output trait.
       GetManager().AddSharedTrait(SharedData().output_name,
-                                  "Value map output from organism.",
-                                  std::unordered_map<int,double>());
+                                  "Value vector output from organism.",
+                                  emp::vector<double>(SharedData().num_outputs));
+
+      SharedData().thread_pool.Resize(SharedData().num_threads);
+
+#ifdef MABE_PROFILE_ORGS
+      emp::vector<std::string> op_names;
+      WithHardware([&op_names](emp::AvidaGP & cpu){
+        auto inst_lib = cpu.GetInstLib();
+        op_names.resize(inst_lib->GetSize());
+        for (size_t id = 0; id < op_names.size(); id++) op_names[id] = inst_lib->GetName(id);
+      });
+      SharedData().profiler.SetOps(op_names);
+      GetManager().AddSharedTrait("profile_insts", "Instructions executed in last evaluation.", 0.0);
+      GetManager().AddSharedTrait("profile_eval_us", "Microseconds taken by last evaluation.", 0.0);
+#endif
     }
   };
 
@@ -74,6 +74,35 @@ namespace mabe {
       emp::RandomizeBitVector(bits, random, 0.5);
     }
 
+    /// Write the number of bits followed by the bits packed into bytes.
+    bool Serialize(std::ostream & os) const override {
+      const uint64_t num_bits = bits.size();
+      os.write((const char *) &num_bits, sizeof(num_bits));
+      for (size_t start = 0; start < num_bits; start += 8) {
+        unsigned char cur_byte = 0;
+        for (size_t i = start; i < start + 8 && i < num_bits; i++) {
+          if (bits[i]) cur_byte |= (unsigned char) (1 << (i - start));
+        }
+        os.put((char) cur_byte);
+      }
+      return (bool) os;
+    }
+
+    bool Deserialize(std::istream & is) override {
+      uint64_t num_bits = 0;
+      if (!is.read((char *) &num_bits, sizeof(num_bits))) return false;
+      if (!HasBytesLeft(is, num_bits / 8 + (num_bits % 8 != 0))) return false;
+      bits.Resize(num_bits);
+      for (size_t start = 0; start < num_bits; start += 8) {
+        const int cur_byte = is.get();
+        if (cur_byte == EOF) return false;
+        for (size_t i = start; i < start + 8 && i < num_bits; i++) {
+          bits.Set(i, (cur_byte >> (i - start)) & 1);
+        }
+      }
+      return true;
+    }
+
     void Initialize(emp::Random & random) override {
       if (SharedData().init_random) emp::RandomizeBitVector(bits, random, 0.5);
     }
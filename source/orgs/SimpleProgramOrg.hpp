@@ -5,32 +5,58 @@
  *
  *  @file SimpleProgramOrg.hpp
  *  @brief A simple organism with a program-based genome.
- *  @note Status: UNFINISHED.
- * 
- *  Tracking scopes became more complex than was intended for this simple model;
- *  shifting back to using ScopeGP hardware from Empirical, but keep this here
- *  to finish later if warranted.
- * 
- *  Main advantages were intended to be:
- *  - Fixed instruction set, so insts can be looked up in a switch block.
- *  - Fixed sized (array based) memory, for less indirection.
- *  - Fixed chunk of memory (rather than array) for faster access.
+ *  @note Status: ALPHA
+ *
+ *  Designed for speed over flexibility:
+ *  - Fixed instruction set, so insts can be looked up in a switch block (or jump table).
+ *  - Fixed sized (array based) genome and memory, for less indirection.
  *  - Indirect references to memory built in to arguments.
- *  - Rgisters were part of memory, so they could be more dynamically accessed
- * 
- *  Most of these can be explored in other hardware.
+ *  - Registers are part of memory, so they can be more dynamically accessed.
+ *  - The genome is decoded into a program, with all scope jumps resolved, before it is run.
+ *
+ *  See tools/SimpleProgramVM.hpp for details on the instruction set.  On evaluation, memory is
+ *  cleared, the program runs for eval_time instructions (or until it halts), and the first
+ *  num_outputs values of output memory are stored in the output trait.
+ *
+ *  Organisms store only their 256-byte genome.  Memory (8 KB) and the decoded program are
+ *  scratch space, so they live in evaluation contexts owned by the manager; each evaluation
+ *  checks out a context (one per concurrently evaluating thread), decodes the genome into it,
+ *  and returns it when done.
+ *
+ *  Programs take no inputs, so the outputs of an evaluation depend only on the genome.  In a
+ *  converged population the same few genomes are evaluated over and over, so results are
+ *  cached (up to cache_size genomes, keyed by a hash of the genome) and a repeated genome
+ *  skips the VM entirely.  The cache is split into shards with their own locks, so threads
+ *  evaluating in parallel rarely wait on each other.  New genomes are not added to a full
+ *  shard; each update, shards that are full drop the genomes not used since the last update
+ *  to make room.  Each update, the number of cache hits and misses, instructions
+ *  executed and skipped, and the resulting speedup are recorded as time series named
+ *  "<manager name>.cache_hits", etc.  (If inputs are ever added, they must become part of
+ *  the cache key.)
+ *
+ *  When compiled with MABE_PROFILE_ORGS, each evaluation also sets the traits profile_insts
+ *  (instructions executed, including those skipped by the cache) and profile_eval_us (time
+ *  taken), and per-update totals are recorded as time series (see tools/OrgProfiler.hpp).
+ *  Instruction counts by type cover only evaluations that ran the VM, in decoded form (e.g.,
+ *  END_SCOPE is counted as Jump or Nop).
  */
 
 #ifndef MABE_SIMPLE_PROGRAM_ORGANISM_H
 #define MABE_SIMPLE_PROGRAM_ORGANISM_H
 
-#include <math.h>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 #include "../core/MABE.hpp"
 #include "../core/Organism.hpp"
 #include "../core/OrganismManager.hpp"
+#include "../tools/OrgProfiler.hpp"
+#include "../tools/SimpleProgramVM.hpp"
 
 #include "emp/base/array.hpp"
+#include "emp/base/Ptr.hpp"
 #include "emp/base/vector.hpp"
 #include "emp/math/Distribution.hpp"
 #include "emp/math/random_utils.hpp"
@@ -42,53 +68,13 @@ namespace mabe {
     using base_t = OrganismTemplate<SimpleProgramOrg>;
     using base_t::SharedData;
 
-    enum class Inst {
-      GET_CONST, ADD_CONST, MULT_CONST,  // (3) Modify ARG1 by ARG2c
-      ADD, SUB, MULT, DIV, MOD, NAND,    // (6) Basic two-input math (ARG3 = ARG1 op ARG2)
-      TEST_EQU, TEST_NEQU, TEST_LESS,    // (3) COMPARE ARG1 and ARG2; put 0/1 result in ARG3
-      COPY,                              // (1) Copy ARG1 into ARG2
-      IF,                                // (1) Set scope to ARG1; Skip if ARG2 is 0.
-      WHILE,                             // (1) Set scope to ARG1; repeat as long as ARG2 is non-zero
-      COUNTDOWN,                         // (1) Set scope to ARG1; repeat and dec ARG2 while non-zero
-      CONTINUE,                          // (1) Jump back to WHILE or COUNTDOWN start, or prog start
-      BREAK,                             // (1) Jump to end of WHILE or COUNTDOWN scope, or halt prog
-      SET_SCOPE,                         // (1) Set the current scope to ARG1 (end deeper scopes)
-      PUSH, POP,                         // (2) Treat ARG1 as stack pointer; push/pop with ARG2
-      NUM_BASE_INSTS,                    // 21 - Marker for total instruction count in base set
-      NONE,                              // Empty instruction!
-      ERROR                              // Invalid instruction!
-    };
-
-    // Arguments can be values (constants) or variables (direct or indirect memory positions).
-    // Constants are just used in CONST instrustions where ARG2c is a direct value centered at zero
-    //   Range is -11 to 12 by default.
-    // Variables are:
-    //   direct registers (10: A-J), first four are regs only; next 6 are ALSO indirect memory.
-    //   indirections to internal memory (2: E,F),
-    //   indirections to input memory (2: G,H), uses offset of + 512.
-    //   indirections to output memory (2: I,J), uses offset of + 768.
-
-    static constexpr size_t GENOME_SIZE = 64;
-
-    static constexpr size_t NUM_REGS = 16;
-    static constexpr size_t MEM_SIZE = 1024;
-    static constexpr size_t MEM_IO_SIZE = 256;
-    static constexpr size_t MEM_INTERNAL_START = 0;
-    static constexpr size_t MEM_INPUT_START = 512;
-    static constexpr size_t MEM_OUTPUT_START = MEM_INPUT_START + MEM_IO_SIZE;
-    static_assert(MEM_OUTPUT_START + MEM_IO_SIZE <= MEM_SIZE, "IO must fit inside other memoery.");
-
-    static constexpr size_t MEM_MASK = MEM_SIZE - 1;
-    static constexpr size_t REG_MASK = NUM_REGS - 1;
-
-    using genome_t = emp::array<unsigned char, GENOME_SIZE*4>;
-    using jump_map_t = emp::array<size_t, GENOME_SIZE>;
-    using memory_t = emp::array<double, MEM_SIZE>;
+    using vm_t = SimpleProgramVM;
+    using Inst = vm_t::Inst;
+    using genome_t = vm_t::genome_t;
+    static constexpr size_t GENOME_SIZE = vm_t::GENOME_SIZE;
+    static constexpr size_t INST_BYTES = vm_t::INST_BYTES;
 
     genome_t genome;          // Series of instructions.
-    jump_map_t inst_target;  // Pre-processed jump points for CONTINUE, BREAK, or scope ends
-    size_t inst_ptr;          // Position in genome to execute next.
-    memory_t mem;             // Memory for program to manipulate
 
     // Find the instruction with the provided name.
     Inst GetInst(const std::string & name) const {
@@ -104,318 +90,291 @@ namespace mabe {
       return SharedData().inst_names[(size_t) inst];
     }
 
-    // Convert an argument to the associated variable.
-    double & GetArgVar(const unsigned char arg) {
-      // We're assuming 16 registers, where the last 6 are indirections.
-      switch (arg & REG_MASK) {
-        case 0: return mem[0];
-        case 1: return mem[1];
-        case 2: return mem[2];
-        case 3: return mem[3];
-        case 4: return mem[4];
-        case 5: return mem[5];
-        case 6: return mem[6];
-        case 7: return mem[7];
-        case 8: return mem[8];
-        case 9: return mem[9];
-        case 10: return mem[(((size_t) mem[4]) & MEM_MASK)]; // Internal memory.
-        case 11: return mem[(((size_t) mem[5]) & MEM_MASK)]; // Internal memory.
-        case 12: return mem[((MEM_INPUT_START + (size_t) mem[6]) & MEM_MASK)]; // Input memory.
-        case 13: return mem[((MEM_INPUT_START + (size_t) mem[7]) & MEM_MASK)]; // Input memory.
-        case 14: return mem[((MEM_OUTPUT_START + (size_t) mem[8]) & MEM_MASK)]; // Output memory.
-        case 15: return mem[((MEM_OUTPUT_START + (size_t) mem[9]) & MEM_MASK)]; // Output memory.
-      };
+    static uint64_t HashGenome(const genome_t & genome) {
+      uint64_t hash = 0;
+      for (size_t i = 0; i < genome.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, genome.data() + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+      }
+      return hash;
     }
 
-    // Convert an argument variable to a size_t
-    size_t GetArgBits(const unsigned char arg) {
-      return (size_t) GetArgVar(arg);
+    void RandomizeInst(size_t pos, emp::Random & random) {
+      for (size_t i = 0; i < INST_BYTES; i++) {
+        genome[pos * INST_BYTES + i] = (unsigned char) random.GetUInt(0, 256);
+      }
     }
 
-    // Convert an argument to the associated constant.
-    double GetArgConst(const unsigned char arg) {
-      // Easy access to a range of potentially useful constants.
-      switch (arg & REG_MASK) {
-        case 0:  return  -2.0;
-        case 1:  return  -1.0;
-        case 2:  return   0.0;
-        case 3:  return   0.25;
-        case 4:  return   0.5;
-        case 5:  return   1.0;
-        case 6:  return   2.0;
-        case 7:  return   3.0;
-        case 8:  return   4.0;
-        case 9: return   8.0;
-        case 10: return  16.0;
-        case 11: return  32.0;
-        case 12: return  64.0;
-        case 13: return 128.0;
-        case 14: return 256.0;
-        case 15: return 512.0;
-        default: return 0.0;   // Error?
-      };
-    }
+  public:
+    /// Scratch space for running a program; reused across evaluations.
+    struct EvalContext {
+      vm_t vm;                  ///< Memory and execution state for the program.
+      vm_t::program_t program;  ///< Genome decoded with all jumps resolved.
+    };
 
+    struct ManagerData : public Organism::ManagerData {
+      std::string output_name = "outputs";  ///< Name of trait that should be used to access values.
+      size_t num_outputs = 16;              ///< Number of output values to record.
+      size_t eval_time = 500;               ///< Instructions to execute on each evaluation.
+      double mut_prob = 0.01;               ///< Probability of each instruction mutating on reproduction.
+      bool init_random = true;              ///< Should we randomize ancestor?  (false = all zeros)
+      size_t cache_size = 1000;             ///< Genomes to cache results for (0 = no cache).
 
-    // Analyze this program to figure out scope information for each position.
-    void PreprocessScopes() {
-      unsigned char cur_scope = 0;
-      emp::vector<size_t> scope_starts;
-      scope_starts.reserve(16);
-      for (size_t i = 0; i < GENOME_SIZE; i++) {
-        const size_t genome_pos = i*4;
-        switch (genome[genome_pos]) {          
-        case (size_t) Inst::IF:
-          unsigned char new_scope = genome[genome_pos+1] % 16;
-          break;
-        case (size_t) Inst::WHILE:
-        case (size_t) Inst::COUNTDOWN:
-          unsigned char new_scope = genome[genome_pos+1] % 16;
-          break;
-        case (size_t) Inst::SET_SCOPE:
-          unsigned char new_scope = genome[genome_pos+1] % 16;
-          break;
-        case (size_t) Inst::BREAK:
-          break;
-        case (size_t) Inst::CONTINUE:
-          break;
-        default:
-      
-        };
-      }
-    }
+      // Helper member variables.
+      emp::Binomial mut_dist;               ///< Distribution of number of mutations to occur.
+      emp::BitVector mut_sites;             ///< A pre-allocated vector for mutation sites.
 
+      // Instruction Set
+      emp::vector<std::string> inst_names;  ///< Names of all instructions in use.
 
-    // What kind of scope are we in?
-    Inst GetScopeType() {
-      if (scope_starts.size() == 0) return Inst::NONE;
-      switch (genome[scope_starts.back()]) {
-        case (size_t) Inst::IF:        return Inst::IF;
-        case (size_t) Inst::WHILE:     return Inst::WHILE;
-        case (size_t) Inst::COUNTDOWN: return Inst::COUNTDOWN;
+      // Evaluation contexts; one is checked out by each thread during an evaluation.
+      emp::vector<emp::Ptr<EvalContext>> contexts;       ///< All contexts created.
+      emp::vector<emp::Ptr<EvalContext>> free_contexts;  ///< Contexts not currently in use.
+      std::mutex context_mutex;                          ///< Protects free_contexts.
 
-        default: return Inst::ERROR; // The above are the only legal scope types!
-      };
-    }
+      ~ManagerData() { for (emp::Ptr<EvalContext> context : contexts) context.Delete(); }
 
-    // Jump past the current scope.
-    void SkipScope() {
-      int scope_level = 1;
-      while (scope_level > 0 && inst_ptr < genome.size()) {
-        switch (genome[inst_ptr]) {
-          case (size_t) Inst::IF:
-          case (size_t) Inst::WHILE:
-          case (size_t) Inst::COUNTDOWN:
-            scope_level++;
-            break;
-          case (size_t) Inst::END_SCOPE:
-            scope_level--;
+      emp::Ptr<EvalContext> AcquireContext() {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        if (free_contexts.size() == 0) {
+          contexts.push_back(emp::NewPtr<EvalContext>());
+          return contexts.back();
         }
+        emp::Ptr<EvalContext> context = free_contexts.back();
+        free_contexts.pop_back();
+        return context;
       }
-    }
 
-    // Execute the next instruction.
-    void RunInst() {
-      // Loop around to zero if we're off the end.
-      if (inst_ptr >= genome.size()) { inst_ptr = 0; }
-
-      const unsigned char cur_inst = genome[inst_ptr];
-      const unsigned char arg1 = genome[inst_ptr+1];
-      const unsigned char arg2 = genome[inst_ptr+2];
-      const unsigned char arg3 = genome[inst_ptr+3];
-      inst_ptr += 4;
-
-      if (cur_inst < (unsigned char) Inst::NUM_BASE_INSTS) {
-        switch ((Inst) cur_inst) {
-        case Inst::GET_CONST:       // Set ARG1 to the constant value represented by ARG2
-          GetArgVar(arg1) = GetArgConst(arg2);
-          break;
-        case Inst::ADD_CONST:
-          GetArgVar(arg1) += GetArgConst(arg2);
-          break;
-        case Inst::MULT_CONST:
-          GetArgVar(arg1) *= GetArgConst(arg2);
-          break;
-        case Inst::ADD:
-          GetArgVar(arg3) = GetArgVar(arg1) + GetArgVar(arg2);
-          break;
-        case Inst::SUB:
-          GetArgVar(arg3) = GetArgVar(arg1) - GetArgVar(arg2);
-          break;
-        case Inst::MULT:
-          GetArgVar(arg3) = GetArgVar(arg1) * GetArgVar(arg2);
-          break;
-        case Inst::DIV:
-          if (GetArgVar(arg2) != 0.0) GetArgVar(arg3) = GetArgVar(arg1) / GetArgVar(arg2);
-          // @CAO Do something on error?
-          break;
-        case Inst::MOD:
-          if (GetArgVar(arg2) != 0.0) GetArgVar(arg3) = std::remainder(GetArgVar(arg1), GetArgVar(arg2));
-          // @CAO Do something on error?
-          break;
-        case Inst::NAND:
-          GetArgVar(arg3) = ~(GetArgBits(arg1) & GetArgBits(arg2));
-          break;
-        case Inst::TEST_EQU:
-          GetArgVar(arg3) = (GetArgVar(arg1) == GetArgVar(arg2));
-          break;
-        case Inst::TEST_NEQU:
-          GetArgVar(arg3) = (GetArgVar(arg1) != GetArgVar(arg2));
-          break;
-        case Inst::TEST_LESS:
-          GetArgVar(arg3) = (GetArgVar(arg1) < GetArgVar(arg2));
-          break;
-        case Inst::COPY:
-          GetArgVar(arg2) = GetArgVar(arg1);
-          break;
-
-        case Inst::IF:
-        case Inst::WHILE:
-        case Inst::COUNTDOWN:  // Differ only at END_SCOPE
-          scope_starts.push_back(inst_ptr - 4); // Enter a new scope!
-          if (GetArgBits(arg1) == 0) SkipScope();
-          break;
-
-        case Inst::CONTINUE:  // Return to the begining of this scope!
-          // Skip over any 'IF' scopes that we may be in.
-          while (GetScopeType() == Inst::IF) scope_starts.pop_back();
-
-          // If we are in a loop, go back to the start; otherwise go to the start of the genome.
-          switch (GetScopeType()) {
-            case Inst::NONE: inst_ptr = 0; break;
-            case Inst::COUNTDOWN:
-              GetArgVar(arg1) -= 1.0;
-              [[fallthrough]];
-            case Inst::WHILE:
-              inst_ptr = scope_starts.back();
-              break;
-            default:
-              emp_error("Internal error; Invalid context for CONTINUE");
-          };
-
-          break;
-        case Inst::BREAK:
-          // Skip over any 'IF' scopes that we may be in, and then one more for break.
-          while (GetScopeType() == Inst::IF) SkipScope();
-          SkipScope();
-          break;
-        case Inst::END_SCOPE:
-          switch (GetScopeType()) {
-            case Inst::NONE: break;                         // No scope?  Ignore it!
-            case Inst::IF: scope_starts.pop_back(); break;  // We are done with the IF!
-            case Inst::COUNTDOWN:
-              GetArgVar(arg1) -= 1.0;
-              [[fallthrough]];
-            case Inst::WHILE:
-              inst_ptr = scope_starts.back();
-              break;
-            default:
-              emp_error("Internal error; Invalid context for CONTINUE");
-          };          
-          break;
-        case Inst::PUSH:
-          {
-            double & stack_ptr = GetArgVar(arg1);
-            mem[(size_t) stack_ptr] = GetArgVar(arg2);
-            stack_ptr += 1.0;
-          }
-          break;
-        case Inst::POP:
-          {
-            double & stack_ptr = GetArgVar(arg1);
-            stack_ptr -= 1.0;
-            GetArgVar(arg2) = mem[(size_t) stack_ptr];
-          }
-          break;
-        };
+      void ReleaseContext(emp::Ptr<EvalContext> context) {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        free_contexts.push_back(context);
       }
-      // Special instruction! (or nop?)
-      else {
 
+      // Results of previous evaluations, keyed by genome hash.
+      struct CacheEntry {
+        genome_t genome;              ///< Full genome, to rule out hash collisions.
+        emp::vector<double> outputs;  ///< Outputs produced by this genome.
+        size_t num_insts = 0;         ///< Instructions executed to produce the outputs.
+        size_t last_used = 0;         ///< Cache epoch in which this entry was last used.
+      };
+
+      /// Part of the cache, with its own lock and counters since the last update.
+      struct CacheShard {
+        std::unordered_map<uint64_t, CacheEntry> entries;
+        std::mutex mutex;             ///< Protects the entries and the counters below.
+        size_t max_entries = 0;       ///< This shard's share of cache_size.
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t insts_run = 0;         ///< Instructions executed by the VM.
+        size_t insts_saved = 0;       ///< Instructions skipped due to cache hits.
+      };
+      static constexpr size_t CACHE_SHARDS = 16;
+      emp::array<CacheShard, CACHE_SHARDS> cache;
+      size_t cache_epoch = 0;         ///< Incremented each update.
+
+      // Use the high bits of the hash, since the low bits pick buckets within a shard.
+      CacheShard & GetShard(uint64_t hash) { return cache[(size_t) (hash >> 60) % CACHE_SHARDS]; }
+
+      /// Split cache_size among the shards.
+      void SetupCache() {
+        for (size_t i = 0; i < CACHE_SHARDS; i++) {
+          cache[i].max_entries = cache_size / CACHE_SHARDS + (i < cache_size % CACHE_SHARDS);
+        }
       }
-    }
 
-  public:
-    struct ManagerData : public Organism::ManagerData {
-      std::string output_name = "vals";  ///< Name of trait that should be used to access values.
-      double mut_prob = 0.01;            ///< Probability of position mutating on reproduction.
+#ifdef MABE_PROFILE_ORGS
+      OrgProfiler profiler;
+#endif
 
-      // Helper member variables.
-      emp::Binomial mut_dist;            ///< Distribution of number of mutations to occur.
-      emp::BitVector mut_sites;          ///< A pre-allocated vector for mutation sites.
+      /// Copy cached outputs (and instructions used) for this genome, if there are any;
+      /// return success.
+      bool LookupCache(uint64_t hash, const genome_t & genome, emp::vector<double> & outputs,
+                       size_t & num_insts) {
+        CacheShard & shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(hash);
+        if (it == shard.entries.end() ||
+            std::memcmp(it->second.genome.data(), genome.data(), genome.size()) != 0) {
+          return false;
+        }
+        CacheEntry & entry = it->second;
+        entry.last_used = cache_epoch;
+        outputs = entry.outputs;
+        num_insts = entry.num_insts;
+        shard.hits++;
+        shard.insts_saved += entry.num_insts;
+        return true;
+      }
 
-      // Instruction Set
-      emp::vector<std::string> inst_names;  ///< Names of all instructions in use.
-      size_t num_regs;                      ///< Number of registers in the CPU.
-      size_t num_indirect_args;             ///< Number of indirect args for each group.
-      size_t const_shift;                   ///< How far should constant arguments be shifted?
+      /// Record the outputs of a genome that was not in the cache; if its shard is full, the
+      /// genome is not stored.
+      void AddToCache(uint64_t hash, const genome_t & genome,
+                      const emp::vector<double> & outputs, size_t num_insts) {
+        CacheShard & shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.misses++;
+        shard.insts_run += num_insts;
+        auto it = shard.entries.find(hash);
+        if (it == shard.entries.end()) {
+          if (shard.entries.size() >= shard.max_entries) return;
+          it = shard.entries.emplace(hash, CacheEntry()).first;
+        }
+        CacheEntry & entry = it->second;   // Replaces any colliding genome.
+        entry.genome = genome;
+        entry.outputs = outputs;
+        entry.num_insts = num_insts;
+        entry.last_used = cache_epoch;
+      }
+
+      void OnUpdate(MABE & control, const std::string & manager_name, size_t /* update */) {
+#ifdef MABE_PROFILE_ORGS
+        profiler.Flush([&control, &manager_name](const std::string & name, double value){
+          control.RecordSample(manager_name + ".profile." + name, value);
+        });
+#endif
+        if (cache_size == 0) return;
+        size_t cache_hits = 0, cache_misses = 0, insts_run = 0, insts_saved = 0;
+        for (CacheShard & shard : cache) {
+          cache_hits += shard.hits;
+          cache_misses += shard.misses;
+          insts_run += shard.insts_run;
+          insts_saved += shard.insts_saved;
+          shard.hits = shard.misses = shard.insts_run = shard.insts_saved = 0;
+
+          // Once a shard is full, drop genomes not used since the last update to make room.
+          if (shard.entries.size() < shard.max_entries) continue;
+          for (auto it = shard.entries.begin(); it != shard.entries.end(); ) {
+            if (it->second.last_used != cache_epoch) it = shard.entries.erase(it);
+            else ++it;
+          }
+        }
+        const double speedup = insts_run ? (double) (insts_run + insts_saved) / (double) insts_run : 1.0;
+        control.RecordSample(manager_name + ".cache_hits", (double) cache_hits);
+        control.RecordSample(manager_name + ".cache_misses", (double) cache_misses);
+        control.RecordSample(manager_name + ".insts_run", (double) insts_run);
+        control.RecordSample(manager_name + ".insts_saved", (double) insts_saved);
+        control.RecordSample(manager_name + ".speedup", speedup);
+        cache_epoch++;
+      }
     };
 
     SimpleProgramOrg(OrganismManager<SimpleProgramOrg> & _manager)
-      : OrganismTemplate<SimpleProgramOrg>(_manager) { }
-    SimpleProgramOrg(const SimpleProgramOrg &) = default;
-    SimpleProgramOrg(SimpleProgramOrg &&) = default;
-    SimpleProgramOrg(const genome_t & in, OrganismManager<SimpleProgramOrg> & _manager)
       : OrganismTemplate<SimpleProgramOrg>(_manager)
     {
-      // SharedData().ApplyBounds(vals);  // Make sure all data is within range.
+      genome.fill(0);
     }
-    SimpleProgramOrg(size_t N, OrganismManager<SimpleProgramOrg> & _manager)
-      : OrganismTemplate<SimpleProgramOrg>(_manager) { }
+    SimpleProgramOrg(const SimpleProgramOrg &) = default;
+    SimpleProgramOrg(SimpleProgramOrg &&) = default;
+    SimpleProgramOrg(const genome_t & in, OrganismManager<SimpleProgramOrg> & _manager)
+      : OrganismTemplate<SimpleProgramOrg>(_manager), genome(in) { }
     ~SimpleProgramOrg() { ; }
 
-    /// Use "to_string" to convert.
-    std::string ToString() const override { } // return emp::to_string(vals, ":(TOTAL=", total, ")"); }
+    const genome_t & GetGenome() const { return genome; }
+
+    /// Print each instruction (by name) followed by its three arguments (as letters).
+    std::string ToString() const override {
+      std::string out;
+      out.reserve(GENOME_SIZE * 16);
+      for (size_t i = 0; i < GENOME_SIZE; i++) {
+        const unsigned char * bytes = genome.data() + i * INST_BYTES;
+        if (i) out += ", ";
+        out += GetName((Inst) (bytes[0] % vm_t::NUM_INSTS));
+        for (size_t arg = 1; arg < INST_BYTES; arg++) {
+          out += ' ';
+          out += (char) ('A' + (bytes[arg] & vm_t::REG_MASK));
+        }
+      }
+      return out;
+    }
 
     size_t Mutate(emp::Random & random) override {
       // Identify number of and positions for mutations.
       const size_t num_muts = SharedData().mut_dist.PickRandom(random);
+      if (num_muts == 0) return 0;
+
       emp::BitVector & mut_sites = SharedData().mut_sites;
       mut_sites.ChooseRandom(random, num_muts);
 
-      // SetVar<double>(SharedData().total_name, total);  // Store total in data map.
+      // Replace each instruction at the identified positions.
+      int mut_pos = mut_sites.FindOne();
+      while (mut_pos != -1) {
+        RandomizeInst((size_t) mut_pos, random);
+        mut_pos = mut_sites.FindOne(mut_pos+1);
+      }
+
       return num_muts;
     }
 
     void Randomize(emp::Random & random) override {
-      for (unsigned char & x : genome) { x = random.GetUInt(0, 256); }
+      for (size_t pos = 0; pos < GENOME_SIZE; pos++) RandomizeInst(pos, random);
+    }
+
+    void Initialize(emp::Random & random) override {
+      if (SharedData().init_random) Randomize(random);
+      else genome.fill(0);
+    }
+
+    /// Write the raw genome bytes.
+    bool Serialize(std::ostream & os) const override {
+      os.write((const char *) genome.data(), (std::streamsize) genome.size());
+      return (bool) os;
     }
 
-    /// Put the values in the correct output positions.
+    bool Deserialize(std::istream & is) override {
+      return (bool) is.read((char *) genome.data(), (std::streamsize) genome.size());
+    }
+
+    /// Run the program and put the output values in the correct output position.
     void GenerateOutput() override {
-      SetVar<emp::vector<double>>(SharedData().output_name, vals);
-      SetVar<double>(SharedData().total_name, total);
+#ifdef MABE_PROFILE_ORGS
+      const auto start_time = std::chrono::steady_clock::now();
+#endif
+      ManagerData & data = SharedData();
+      emp::vector<double> & outputs = GetVar<emp::vector<double>>(data.output_name);
+      outputs.resize(data.num_outputs);
+
+      size_t num_insts = 0;
+      const uint64_t hash = data.cache_size ? HashGenome(genome) : 0;
+      const bool cached = data.cache_size && data.LookupCache(hash, genome, outputs, num_insts);
+
+      emp::Ptr<EvalContext> context = nullptr;
+      if (!cached) {
+        context = data.AcquireContext();
+        vm_t & vm = context->vm;
+        vm_t::Decode(genome, context->program);
+        vm.Reset();
+        num_insts = vm.Run(context->program, data.eval_time);
+        for (size_t i = 0; i < data.num_outputs; i++) outputs[i] = vm.GetOutput(i);
+        if (data.cache_size) data.AddToCache(hash, genome, outputs, num_insts);
+      }
+
+#ifdef MABE_PROFILE_ORGS
+      const double eval_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start_time).count();
+      data.profiler.AddEval(context ? context->vm.GetOpCounts().data() : nullptr, num_insts, eval_us);
+      SetVar<double>("profile_insts", (double) num_insts);
+      SetVar<double>("profile_eval_us", eval_us);
+#endif
+
+      if (context) data.ReleaseContext(context);
     }
 
     /// Setup this organism type to be able to load from config.
     void SetupConfig() override {
-      GetManager().LinkFuns<size_t>([this](){ return vals.size(); },
-                       [this](const size_t & N){ return vals.resize(N, 0.0); },
-                       "N", "Number of values in organism");
       GetManager().LinkVar(SharedData().mut_prob, "mut_prob",
-                      "Probability of each value mutating on reproduction.");
-      GetManager().LinkVar(SharedData().mut_size, "mut_size",
-                      "Standard deviation on size of mutations.");
-      GetManager().LinkVar(SharedData().min_value, "min_value",
-                      "Lower limit for value fields.");
-      GetManager().LinkVar(SharedData().max_value, "max_value",
-                      "Upper limit for value fields.");
-      GetManager().LinkMenu(
-        SharedData().lower_bound, "lower_bound", "How should the lower limit be enforced?",
-        LIMIT_NONE, "no_limit", "Allow values to be arbirarily low.",
-        LIMIT_CLAMP, "clamp", "Reduce too-low values to min_value.",
-        LIMIT_WRAP, "wrap", "Make low values loop around to maximum.",
-        LIMIT_REBOUND, "rebound", "Make low values 'bounce' back up." );
-      GetManager().LinkMenu(
-        SharedData().upper_bound, "upper_bound", "How should the upper limit be enforced?",
-        LIMIT_NONE, "no_limit", "Allow values to be arbirarily high.",
-        LIMIT_CLAMP, "clamp", "Reduce too-high values to max_value.",
-        LIMIT_WRAP, "wrap", "Make high values loop around to minimum.",
-        LIMIT_REBOUND, "rebound", "Make high values 'bounce' back down." );
+                      "Probability of each instruction mutating on reproduction.");
+      GetManager().LinkVar(SharedData().init_random, "init_random",
+                      "Should we randomize ancestor?  (0 = all zeros)");
+      GetManager().LinkVar(SharedData().eval_time, "eval_time",
+                      "How many instructions should organisms execute on each evaluation?");
+      GetManager().LinkVar(SharedData().num_outputs, "num_outputs",
+                      "Number of output values to record.");
       GetManager().LinkVar(SharedData().output_name, "output_name",
-                      "Name of variable to contain set of values.");
-      GetManager().LinkVar(SharedData().total_name, "total_name",
-                      "Name of variable to contain total of all values.");
+                      "Name of variable to contain set of output values.");
+      GetManager().LinkVar(SharedData().cache_size, "cache_size",
+                      "Number of genomes to cache evaluation results for (0 = no cache).");
     }
 
     /// Setup this organism type with the traits it need to track.
@@ -423,54 +382,59 @@ namespace mabe {
       auto & data = SharedData();
 
       // Setup the mutation distribution.
-      data.mut_dist.Setup(data.mut_prob, vals.size());
+      data.mut_dist.Setup(data.mut_prob, GENOME_SIZE);
 
       // Setup the default vector to indicate mutation positions.
-      data.mut_sites.Resize(vals.size());
+      data.mut_sites.Resize(GENOME_SIZE);
+
+      // Split the result cache among its shards.
+      data.SetupCache();
 
       // Setup the output trait.
+      if (data.num_outputs > vm_t::MEM_IO_SIZE) data.num_outputs = vm_t::MEM_IO_SIZE;
       GetManager().AddSharedTrait(data.output_name,
                                   "Value vector output from organism.",
-                                  emp::vector<double>(vals.size()));
-      // Setup the output trait.
-      GetManager().AddSharedTrait(data.total_name,
-                                  "Total of all organism outputs.",
-                                  0.0);
+                                  emp::vector<double>(data.num_outputs));
 
       // Setup the instruction set.
-      data.inst_names.resize((size_t) Inst::NUM_BASE_INSTS);
+      data.inst_names.resize(vm_t::NUM_INSTS);
       data.inst_names[(size_t) Inst::GET_CONST] = "GetConst";
       data.inst_names[(size_t) Inst::ADD_CONST] = "AddConst";
       data.inst_names[(size_t) Inst::MULT_CONST] = "MultConst";
-      data.inst_names[(size_t) Inst::ADD] == "Add";
-      data.inst_names[(size_t) Inst::SUB] == "Sub";
-      data.inst_names[(size_t) Inst::MULT] == "Mult";
-      data.inst_names[(size_t) Inst::DIV] == "Div";
-      data.inst_names[(size_t) Inst::MOD] == "Mod";
-      data.inst_names[(size_t) Inst::NAND] == "Nand";
-      data.inst_names[(size_t) Inst::TEST_EQU] == "TestEqu";
-      data.inst_names[(size_t) Inst::TEST_NEQU] == "TestNEqu";
-      data.inst_names[(size_t) Inst::TEST_LESS] == "TestLess";
-      data.inst_names[(size_t) Inst::COPY] == "Copy";
-      data.inst_names[(size_t) Inst::IF] == "If";
-      data.inst_names[(size_t) Inst::WHILE] == "While";
-      data.inst_names[(size_t) Inst::COUNTDOWN] == "Countdown";
-      data.inst_names[(size_t) Inst::CONTINUE] == "Continue";
-      data.inst_names[(size_t) Inst::BREAK] == "Break";
-      data.inst_names[(size_t) Inst::END_SCOPE] == "EndScope";
-      data.inst_names[(size_t) Inst::POP] == "Pop";
-      data.inst_names[(size_t) Inst::PUSH] == "Push";
-      
-      // @CAO ADD NON-STANDARD INSTRUCTIONS!
-
-      data.num_indirect_args = data.inst_names.size() / 8;
-      data.const_shift = 4 * data.num_indirect_args;
-      data.num_regs = data.inst_names.size() - data.const_shift;
+      data.inst_names[(size_t) Inst::ADD] = "Add";
+      data.inst_names[(size_t) Inst::SUB] = "Sub";
+      data.inst_names[(size_t) Inst::MULT] = "Mult";
+      data.inst_names[(size_t) Inst::DIV] = "Div";
+      data.inst_names[(size_t) Inst::MOD] = "Mod";
+      data.inst_names[(size_t) Inst::NAND] = "Nand";
+      data.inst_names[(size_t) Inst::TEST_EQU] = "TestEqu";
+      data.inst_names[(size_t) Inst::TEST_NEQU] = "TestNEqu";
+      data.inst_names[(size_t) Inst::TEST_LESS] = "TestLess";
+      data.inst_names[(size_t) Inst::COPY] = "Copy";
+      data.inst_names[(size_t) Inst::IF] = "If";
+      data.inst_names[(size_t) Inst::WHILE] = "While";
+      data.inst_names[(size_t) Inst::COUNTDOWN] = "Countdown";
+      data.inst_names[(size_t) Inst::CONTINUE] = "Continue";
+      data.inst_names[(size_t) Inst::BREAK] = "Break";
+      data.inst_names[(size_t) Inst::END_SCOPE] = "EndScope";
+      data.inst_names[(size_t) Inst::PUSH] = "Push";
+      data.inst_names[(size_t) Inst::POP] = "Pop";
+
+#ifdef MABE_PROFILE_ORGS
+      emp::vector<std::string> op_names = data.inst_names;
+      op_names.resize(vm_t::NUM_OPS);
+      op_names[(size_t) Inst::JUMP] = "Jump";
+      op_names[(size_t) Inst::NOP] = "Nop";
+      op_names[(size_t) Inst::HALT] = "Halt";
+      data.profiler.SetOps(op_names);
+      GetManager().AddSharedTrait("profile_insts", "Instructions executed in last evaluation.", 0.0);
+      GetManager().AddSharedTrait("profile_eval_us", "Microseconds taken by last evaluation.", 0.0);
+#endif
     }
   };
 
 
-  MABE_REGISTER_ORG_TYPE(SimpleProgramOrg, "Organism consisting of a series of N floating-point values.");
+  MABE_REGISTER_ORG_TYPE(SimpleProgramOrg, "Organism consisting of a short program run on a fast, fixed VM.");
 }
 
 #endif
@@ -113,6 +113,27 @@ namespace mabe {
       else { total = 0.0; for (double & x : vals) x = 0.0; }
     }
 
+    /// Write the number of values followed by the raw values.
+    bool Serialize(std::ostream & os) const override {
+      const uint64_t num_vals = vals.size();
+      os.write((const char *) &num_vals, sizeof(num_vals));
+      os.write((const char *) vals.data(), (std::streamsize) (num_vals * sizeof(double)));
+      return (bool) os;
+    }
+
+    bool Deserialize(std::istream & is) override {
+      uint64_t num_vals = 0;
+      if (!is.read((char *) &num_vals, sizeof(num_vals))) return false;
+      if (num_vals > (uint64_t) -1 / sizeof(double) ||
+          !HasBytesLeft(is, num_vals * sizeof(double))) return false;
+      vals.resize(num_vals);
+      if (!is.read((char *) vals.data(), (std::streamsize) (num_vals * sizeof(double)))) return false;
+      total = 0.0;
+      for (double x : vals) total += x;
+      SetVar<double>(SharedData().total_name, total);  // Store total in data map.
+      return true;
+    }
+
 
     /// Put the values in the correct output positions.
     void GenerateOutput() override {
@@ -0,0 +1,214 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  IslandMigration.hpp
+ *  @brief Module to periodically migrate organisms between a set of island populations.
+ *
+ *  Each island is a Population (typically with its own selection and evaluation modules set
+ *  up in the config file).  On each of the `migrate_updates`, `migrate_count` organisms are moved
+ *  from each island to the next one in the list (or to a randomly chosen island).  Islands are
+ *  always processed in the order provided and all choices are drawn from the master random
+ *  number generator, so a given random seed will always produce the same migrations.
+ *
+ *  All movement goes through MABE::SwapOrgs() or MABE::MoveOrg() so that other modules
+ *  (such as systematics trackers) are properly signaled.
+ *
+ *  Islands can also be evaluated concurrently.  The modules listed in `evaluators` are
+ *  deactivated (so they no longer evaluate populations serially in their own OnUpdate) and
+ *  are instead called through EvaluateOrg() at the start of each update, with each island
+ *  evaluated on its own thread (up to `num_threads`).  Selection, placement, and migration
+ *  still run on the main thread in module order, since they trigger signals and draw from the
+ *  master random number generator; results for a given seed do not depend on thread count.
+ */
+
+#ifndef MABE_SCHEMA_ISLAND_MIGRATION_H
+#define MABE_SCHEMA_ISLAND_MIGRATION_H
+
+#include "emp/tools/string_utils.hpp"
+
+#include "../core/MABE.hpp"
+#include "../core/Module.hpp"
+#include "../tools/ThreadPool.hpp"
+
+namespace mabe {
+
+  class IslandMigration : public Module {
+  private:
+    std::string island_names = "main_pop";  ///< Comma-separated names of island populations.
+    int start_ud = 1;                       ///< First update at which migration should occur.
+    int step_ud = 100;                      ///< How many updates between migrations?
+    int stop_ud = -1;                       ///< Last update to migrate at (-1 for no limit)
+    size_t migrate_count = 1;               ///< Number of organisms to migrate from each island.
+    std::string evaluator_names = "";       ///< Comma-separated names of evaluation modules.
+    size_t num_threads = 1;                 ///< Threads for evaluating islands (0 = all available)
+
+    enum Topology { TOPOLOGY_RING=0, TOPOLOGY_RANDOM };
+    enum Method { METHOD_SWAP=0, METHOD_MOVE };
+    Topology topology = TOPOLOGY_RING;      ///< How are islands connected to each other?
+    Method method = METHOD_SWAP;            ///< Do migrants exchange places or overwrite targets?
+
+    emp::vector<int> island_ids;            ///< Population IDs of islands, in config order.
+    size_t total_migrants = 0;              ///< Number of organisms migrated over the full run.
+
+    emp::vector<emp::Ptr<ModuleBase>> evaluators;  ///< Modules to evaluate each organism.
+    ThreadPool thread_pool;
+    emp::vector<size_t> eval_failures;             ///< Organisms that failed evaluation, per island.
+
+    /// Run all evaluators on every organism of one island; safe to call in parallel on
+    /// distinct islands.  Returns the number of organisms that could not be evaluated.
+    size_t EvaluateIsland(size_t island_id) {
+      Population & pop = control.GetPopulation((size_t) island_ids[island_id]);
+      size_t failures = 0;
+      for (size_t pos = 0; pos < pop.GetSize(); pos++) {
+        if (!pop.IsOccupied(pos)) continue;
+        for (emp::Ptr<ModuleBase> mod_ptr : evaluators) {
+          if (!mod_ptr->EvaluateOrg(pop[pos])) { failures++; break; }
+        }
+      }
+      return failures;
+    }
+
+    /// Pick the island that island_id should send migrants to.
+    size_t ChooseTarget(size_t island_id) {
+      const size_t num_islands = island_ids.size();
+      if (topology == TOPOLOGY_RING) return (island_id + 1) % num_islands;
+
+      // Random topology: choose any island other than the source.
+      size_t target_id = control.GetRandom().GetUInt(num_islands - 1);
+      if (target_id >= island_id) target_id++;
+      return target_id;
+    }
+
+    /// Move migrants out of a single source island into a single target island.
+    void MigrateFrom(size_t source_id, size_t target_id) {
+      Population & source_pop = control.GetPopulation((size_t) island_ids[source_id]);
+      Population & target_pop = control.GetPopulation((size_t) island_ids[target_id]);
+      if (source_pop.GetNumOrgs() == 0 || target_pop.GetSize() == 0) return;
+
+      for (size_t i = 0; i < migrate_count && source_pop.GetNumOrgs(); i++) {
+        OrgPosition from_pos = control.GetRandomOrgPos(source_pop);
+        OrgPosition to_pos = control.GetRandomPos(target_pop);
+        if (method == METHOD_SWAP) control.SwapOrgs(from_pos, to_pos);
+        else control.MoveOrg(from_pos, to_pos);
+        total_migrants++;
+      }
+    }
+
+  public:
+    IslandMigration(mabe::MABE & control,
+                    const std::string & name="IslandMigration",
+                    const std::string & desc="Module to periodically migrate organisms between island populations.")
+      : Module(control, name, desc)
+    {
+      SetManageMod(true);         ///< Mark this module as a population module.
+    }
+    ~IslandMigration() { }
+
+    void SetupConfig() override {
+      LinkVar(island_names, "islands", "Comma-separated list of populations to treat as islands.");
+      LinkRange(start_ud, step_ud, stop_ud, "migrate_updates", "Which updates should migration occur?");
+      LinkVar(migrate_count, "migrate_count", "Number of organisms to migrate from each island.");
+      LinkMenu(topology, "topology", "How should islands be connected?",
+               TOPOLOGY_RING, "ring", "Each island sends migrants to the next one listed.",
+               TOPOLOGY_RANDOM, "random", "Each island sends migrants to a random other island.");
+      LinkMenu(method, "method", "How should migrants be placed?",
+               METHOD_SWAP, "swap", "Migrants exchange places with organisms on the target island.",
+               METHOD_MOVE, "move", "Migrants replace organisms on the target island.");
+      LinkVar(evaluator_names, "evaluators", "Comma-separated list of modules to evaluate islands in parallel.");
+      LinkVar(num_threads, "num_threads", "Number of threads for evaluating islands (0 = all available)");
+    }
+
+    void SetupModule() override {
+      // Identify each island population.
+      emp::vector<std::string> names;
+      std::string name_list = island_names;
+      emp::remove_whitespace(name_list);
+      emp::slice(name_list, names, ',');
+
+      island_ids.resize(0);
+      for (const std::string & name : names) {
+        const int pop_id = control.GetPopID(name);
+        if (pop_id == -1) {
+          AddError("IslandMigration: unknown population '", name, "' in islands list.");
+          continue;
+        }
+        island_ids.push_back(pop_id);
+      }
+      if (island_ids.size() < 2) {
+        AddError("IslandMigration requires at least two island populations; ",
+                 island_ids.size(), " provided.");
+      }
+
+      // Identify each evaluator and stop it from evaluating populations on its own.
+      names.resize(0);
+      name_list = evaluator_names;
+      emp::remove_whitespace(name_list);
+      emp::slice(name_list, names, ',');
+
+      evaluators.resize(0);
+      for (const std::string & name : names) {
+        if (name.empty()) continue;
+        const int mod_id = control.GetModuleID(name);
+        if (mod_id == -1) {
+          AddError("IslandMigration: unknown module '", name, "' in evaluators list.");
+          continue;
+        }
+        ModuleBase & mod = control.GetModule(mod_id);
+        mod.Deactivate();
+        evaluators.push_back(&mod);
+      }
+
+      thread_pool.Resize(num_threads);
+    }
+
+    /// Evaluate all islands, in parallel, before any selection occurs this update.
+    void BeforeUpdate(size_t /* update */) override {
+      if (evaluators.size() == 0) return;
+
+      eval_failures.resize(island_ids.size());
+      thread_pool.ParallelFor(island_ids.size(),
+                              [this](size_t id){ eval_failures[id] = EvaluateIsland(id); });
+
+      for (size_t id = 0; id < island_ids.size(); id++) {
+        if (eval_failures[id] == 0) continue;
+        AddError("IslandMigration: ", eval_failures[id], " organisms on island '",
+                 control.GetPopulation((size_t) island_ids[id]).GetName(),
+                 "' could not be evaluated; evaluators must support individual organisms.");
+      }
+    }
+
+    void OnUpdate(size_t ud) override {
+      // Only migrate on the configured updates.
+      if (((int) ud < start_ud) ||
+          (stop_ud != -1 && (int) ud > stop_ud) ||
+          ((ud - start_ud) % step_ud != 0) ) return;
+
+      if (island_ids.size() < 2) return;
+
+      // Process islands in their listed order so that migrations are reproducible.
+      for (size_t source_id = 0; source_id < island_ids.size(); source_id++) {
+        MigrateFrom(source_id, ChooseTarget(source_id));
+      }
+    }
+
+    void SerializeState(std::ostream & os) override {
+      const uint64_t count = total_migrants;
+      os.write((const char *) &count, sizeof(count));
+    }
+
+    bool DeserializeState(std::istream & is) override {
+      uint64_t count = 0;
+      is.read((char *) &count, sizeof(count));
+      total_migrants = (size_t) count;
+      return (bool) is;
+    }
+
+    size_t GetTotalMigrants() const { return total_migrants; }
+  };
+
+  MABE_REGISTER_MODULE(IslandMigration, "Periodically migrate organisms between island populations.");
+}
+
+#endif
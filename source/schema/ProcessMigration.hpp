@@ -0,0 +1,395 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  ProcessMigration.hpp
+ *  @brief Module to exchange migrants with other MABE processes over Unix domain sockets.
+ *
+ *  Several MABE processes (workers) can be run side-by-side, each owning its own populations.
+ *  Workers are arranged in a ring: on each migration update, worker i serializes a set of
+ *  randomly chosen organisms and sends them to worker (i+1) % num_workers, then waits (up to
+ *  a timeout) for the batch from worker (i-1).  Each worker listens on its own socket at
+ *  "socket_dir/worker_<id>.sock"; incoming batches are collected by a background thread so
+ *  that a slow or crashed neighbor never blocks sending.  If a neighbor does not respond in
+ *  time a warning is issued and the run continues without immigrants.
+ *
+ *  Organisms are transferred with Organism::Serialize() / Deserialize(), so only organism
+ *  types that implement those functions can migrate.  Traits are not transferred; immigrants
+ *  are expected to be re-evaluated like any other new organism.
+ *
+ *  The build/launch_islands.sh script starts N workers locally with the appropriate settings.
+ *
+ *  Each migration is logged to 'log_file' with the number of organisms and bytes sent and
+ *  received, the time spent sending, and the time spent waiting for immigrants (latency).
+ */
+
+#ifndef MABE_SCHEMA_PROCESS_MIGRATION_H
+#define MABE_SCHEMA_PROCESS_MIGRATION_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../core/MABE.hpp"
+#include "../core/Module.hpp"
+
+namespace mabe {
+
+  class ProcessMigration : public Module {
+  private:
+    static constexpr uint32_t MAGIC = 0x4D41424D;  ///< "MABM" marks the start of each batch.
+    static constexpr uint64_t MAX_PAYLOAD_SIZE = 1ull << 30;  ///< Larger batches are rejected.
+
+    /// Fixed-size header sent before each batch of organisms.
+    struct BatchHeader {
+      uint32_t magic = MAGIC;
+      uint32_t source_id = 0;     ///< Which worker sent this batch?
+      uint64_t update = 0;        ///< Update at which the batch was sent.
+      uint64_t num_orgs = 0;      ///< Number of organisms in the payload.
+      uint64_t payload_size = 0;  ///< Number of bytes in the payload.
+      int64_t send_time = 0;      ///< Steady-clock time (ns) when sending began.
+    };
+
+    /// A batch that has been received but not yet placed.
+    struct Batch {
+      BatchHeader header;
+      std::string payload;
+      int64_t recv_time = 0;      ///< Steady-clock time (ns) when batch was fully read.
+    };
+
+    // --- Configuration ---
+    std::string socket_dir = "/tmp/mabe_islands";  ///< Directory for worker sockets.
+    int worker_id = 0;               ///< ID of this worker (0 to num_workers-1)
+    int num_workers = 1;             ///< Total number of workers in the ring.
+    int pop_id = 0;                  ///< Population to send migrants from and place them into.
+    int start_ud = 100;              ///< First update to migrate on.
+    int step_ud = 100;               ///< How many updates between migrations?
+    int stop_ud = -1;                ///< Last update to migrate on (-1 for no limit)
+    size_t migrate_count = 10;       ///< Number of organisms to send at each migration.
+    bool remove_emigrants = false;   ///< Should emigrants be removed from this population?
+    size_t recv_timeout = 5000;      ///< Milliseconds to wait for immigrants before moving on.
+    std::string log_filename = "";   ///< File to log migration statistics (empty for none)
+
+    // --- Internal state ---
+    int listen_fd = -1;                  ///< Socket that this worker receives batches on.
+    std::thread recv_thread;             ///< Background thread to accept incoming batches.
+    std::atomic<bool> stop_recv{false};  ///< Signal for the receive thread to exit.
+    std::mutex inbox_mutex;              ///< Protects the inbox.
+    std::condition_variable inbox_cv;    ///< Notified whenever a new batch arrives.
+    std::deque<Batch> inbox;             ///< Batches waiting to be placed.
+    int log_id = -1;                     ///< ID of the log file in the shared AsyncWriter.
+
+    static int64_t Now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::string SocketPath(int id) const {
+      return emp::to_string(socket_dir, "/worker_", id, ".sock");
+    }
+
+    static bool ReadAll(int fd, char * buffer, size_t num_bytes) {
+      while (num_bytes) {
+        const ssize_t count = ::read(fd, buffer, num_bytes);
+        if (count <= 0) return false;
+        buffer += count;
+        num_bytes -= (size_t) count;
+      }
+      return true;
+    }
+
+    static bool WriteAll(int fd, const char * buffer, size_t num_bytes) {
+      while (num_bytes) {
+        const ssize_t count = ::write(fd, buffer, num_bytes);
+        if (count <= 0) return false;
+        buffer += count;
+        num_bytes -= (size_t) count;
+      }
+      return true;
+    }
+
+    /// Background loop: accept connections and read one batch from each.
+    void RecvLoop() {
+      while (!stop_recv) {
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;   // Timeout or interruption; check stop flag.
+        const int conn_fd = ::accept(listen_fd, nullptr, nullptr);
+        if (conn_fd < 0) continue;
+
+        Batch batch;
+        bool ok = ReadAll(conn_fd, (char *) &batch.header, sizeof(BatchHeader)) &&
+                  batch.header.magic == MAGIC &&
+                  batch.header.payload_size <= MAX_PAYLOAD_SIZE;
+        if (ok) {
+          batch.payload.resize(batch.header.payload_size);
+          ok = ReadAll(conn_fd, batch.payload.data(), batch.payload.size());
+        }
+        ::close(conn_fd);
+        if (!ok) continue;   // Ignore malformed or truncated batches (e.g., sender crashed).
+
+        batch.recv_time = Now();
+        {
+          std::lock_guard<std::mutex> lock(inbox_mutex);
+          inbox.push_back(std::move(batch));
+        }
+        inbox_cv.notify_all();
+      }
+    }
+
+    /// Open the socket this worker listens on and start the receive thread.
+    void StartListening() {
+      ::mkdir(socket_dir.c_str(), 0700);  // Okay if it already exists.
+      const std::string path = SocketPath(worker_id);
+      ::unlink(path.c_str());             // Remove stale socket from an earlier run.
+
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(addr.sun_path)) {
+        AddError("ProcessMigration socket path too long: '", path, "'.");
+        return;
+      }
+      std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+      listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (listen_fd < 0 ||
+          ::bind(listen_fd, (sockaddr *) &addr, sizeof(addr)) < 0 ||
+          ::listen(listen_fd, 16) < 0) {
+        AddError("ProcessMigration unable to listen on socket '", path, "'.");
+        if (listen_fd >= 0) ::close(listen_fd);
+        listen_fd = -1;
+        return;
+      }
+
+      stop_recv = false;
+      recv_thread = std::thread([this](){ RecvLoop(); });
+    }
+
+    void StopListening() {
+      if (listen_fd < 0) return;
+      stop_recv = true;
+      if (recv_thread.joinable()) recv_thread.join();
+      ::close(listen_fd);
+      ::unlink(SocketPath(worker_id).c_str());
+      listen_fd = -1;
+    }
+
+    /// Serialize migrants from the population into a single payload.
+    std::string PackEmigrants(uint64_t & num_orgs) {
+      Population & pop = control.GetPopulation(pop_id);
+      std::stringstream ss;
+      num_orgs = 0;
+      for (size_t i = 0; i < migrate_count && pop.GetNumOrgs(); i++) {
+        OrgPosition pos = control.GetRandomOrgPos(pop);
+        const std::string & type_name = pos.OrgPtr()->GetManager().GetName();
+        std::stringstream org_ss;
+        if (!pos.OrgPtr()->Serialize(org_ss)) {
+          AddError("Organism type '", type_name, "' does not support serialization for migration.");
+          break;
+        }
+        const std::string org_data = org_ss.str();
+        const uint32_t name_size = (uint32_t) type_name.size();
+        const uint64_t data_size = org_data.size();
+        ss.write((const char *) &name_size, sizeof(name_size));
+        ss.write(type_name.data(), name_size);
+        ss.write((const char *) &data_size, sizeof(data_size));
+        ss.write(org_data.data(), (std::streamsize) data_size);
+        num_orgs++;
+
+        if (remove_emigrants) control.ClearOrgAt(pos);
+      }
+      return ss.str();
+    }
+
+    /// Send a payload to the next worker in the ring; return false on failure.
+    bool SendBatch(size_t ud, uint64_t num_orgs, const std::string & payload) {
+      const int target_id = (worker_id + 1) % num_workers;
+      const std::string path = SocketPath(target_id);
+
+      sockaddr_un addr{};
+      addr.sun_family = AF_UNIX;
+      std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0) return false;
+      if (::connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0) { ::close(fd); return false; }
+
+      BatchHeader header;
+      header.source_id = (uint32_t) worker_id;
+      header.update = ud;
+      header.num_orgs = num_orgs;
+      header.payload_size = payload.size();
+      header.send_time = Now();
+      const bool ok = WriteAll(fd, (const char *) &header, sizeof(header)) &&
+                      WriteAll(fd, payload.data(), payload.size());
+      ::close(fd);
+      return ok;
+    }
+
+    /// Wait for the batch sent at this update (or time out), then take all pending batches.
+    std::deque<Batch> CollectBatches(size_t ud) {
+      std::unique_lock<std::mutex> lock(inbox_mutex);
+      inbox_cv.wait_for(lock, std::chrono::milliseconds(recv_timeout), [this,ud](){
+        for (const Batch & batch : inbox) if (batch.header.update >= ud) return true;
+        return false;
+      });
+      std::deque<Batch> out_batches;
+      out_batches.swap(inbox);
+      return out_batches;
+    }
+
+    /// Rebuild all organisms in a batch and place them into the population.
+    size_t PlaceImmigrants(const Batch & batch) {
+      Population & pop = control.GetPopulation(pop_id);
+      if (pop.GetSize() == 0) return 0;
+
+      std::stringstream ss(batch.payload);
+      size_t num_placed = 0;
+      for (uint64_t i = 0; i < batch.header.num_orgs; i++) {
+        // Sizes come from another process, so check them against what is left in the payload.
+        uint32_t name_size = 0;
+        uint64_t data_size = 0;
+        std::string type_name;
+        std::string org_data;
+        bool ok = ss.read((char *) &name_size, sizeof(name_size)) && HasBytesLeft(ss, name_size);
+        if (ok) {
+          type_name.resize(name_size);
+          ok = ss.read(type_name.data(), name_size) &&
+               ss.read((char *) &data_size, sizeof(data_size)) && HasBytesLeft(ss, data_size);
+        }
+        if (ok) {
+          org_data.resize(data_size);
+          ok = (bool) ss.read(org_data.data(), (std::streamsize) data_size);
+        }
+        if (!ok) {
+          AddWarning("ProcessMigration received a malformed batch from worker ",
+                     batch.header.source_id, "; ignoring its remaining organisms.");
+          break;
+        }
+
+        const int mod_id = control.GetModuleID(type_name);
+        if (mod_id == -1 || !control.GetModule(mod_id).IsOrgManager()) {
+          AddWarning("ProcessMigration received unknown organism type '", type_name, "'.");
+          continue;
+        }
+        emp::Ptr<Organism> org_ptr = control.GetModule(mod_id).MakeOrganism();
+        std::stringstream org_ss(org_data);
+        if (org_ptr->Deserialize(org_ss)) {
+          control.InjectAt(*org_ptr, control.GetRandomPos(pop));
+          num_placed++;
+        }
+        else {
+          AddWarning("ProcessMigration could not rebuild an organism of type '", type_name,
+                     "' from worker ", batch.header.source_id, "; dropping it.");
+        }
+        org_ptr.Delete();
+      }
+      return num_placed;
+    }
+
+  public:
+    ProcessMigration(mabe::MABE & control,
+                     const std::string & name="ProcessMigration",
+                     const std::string & desc="Module to exchange migrants with other MABE processes.")
+      : Module(control, name, desc)
+    {
+      SetManageMod(true);         ///< Mark this module as a population module.
+    }
+    ~ProcessMigration() { StopListening(); }
+
+    void SetupConfig() override {
+      LinkVar(socket_dir, "socket_dir", "Directory to place the worker sockets in.");
+      LinkVar(worker_id, "worker_id", "ID of this worker process (0 to num_workers-1).");
+      LinkVar(num_workers, "num_workers", "Total number of worker processes in the ring.");
+      LinkPop(pop_id, "target_pop", "Population to send migrants from and place migrants into.");
+      LinkRange(start_ud, step_ud, stop_ud, "migrate_updates", "Which updates should migration occur?");
+      LinkVar(migrate_count, "migrate_count", "Number of organisms to send at each migration.");
+      LinkVar(remove_emigrants, "remove_emigrants", "Should emigrants be removed from this population?");
+      LinkVar(recv_timeout, "recv_timeout", "Milliseconds to wait for immigrants before continuing.");
+      LinkVar(log_filename, "log_file", "File to log migration throughput and latency (\"\" for none).");
+    }
+
+    void SetupModule() override {
+      if (num_workers < 1 || worker_id < 0 || worker_id >= num_workers) {
+        AddError("ProcessMigration worker_id (", worker_id, ") must be in range 0 to num_workers-1 (",
+                 num_workers-1, ").");
+        return;
+      }
+      if (num_workers == 1) return;  // Nothing to exchange with.
+
+      StartListening();
+      if (log_filename.size()) {
+        log_id = control.GetAsyncWriter().Open(log_filename);
+        if (log_id < 0) AddError("ProcessMigration unable to open log file '", log_filename, "'.");
+        else {
+          control.GetAsyncWriter().Write((size_t) log_id,
+            "update, orgs_sent, bytes_sent, send_ms, orgs_received, bytes_received, wait_ms, transit_ms\n");
+        }
+      }
+    }
+
+    void OnUpdate(size_t ud) override {
+      if (listen_fd < 0) return;
+      if (((int) ud < start_ud) ||
+          (stop_ud != -1 && (int) ud > stop_ud) ||
+          ((ud - start_ud) % step_ud != 0) ) return;
+
+      // Send our emigrants to the next worker.
+      const int64_t send_start = Now();
+      uint64_t num_sent = 0;
+      const std::string payload = PackEmigrants(num_sent);
+      if (!SendBatch(ud, num_sent, payload)) {
+        AddWarning("ProcessMigration worker ", worker_id, " could not reach worker ",
+                   (worker_id + 1) % num_workers, " at update ", ud, ".");
+      }
+      const int64_t send_end = Now();
+
+      // Collect and place immigrants from the previous worker.
+      std::deque<Batch> batches = CollectBatches(ud);
+      const int64_t wait_end = Now();
+      size_t num_received = 0;
+      size_t bytes_received = 0;
+      double transit_ms = 0.0;
+      for (const Batch & batch : batches) {
+        num_received += PlaceImmigrants(batch);
+        bytes_received += batch.payload.size();
+        transit_ms += (double) (batch.recv_time - batch.header.send_time) / 1000000.0;
+      }
+      if (batches.size() == 0) {
+        AddWarning("ProcessMigration worker ", worker_id, " received no migrants at update ", ud, ".");
+      }
+      else transit_ms /= (double) batches.size();
+
+      if (log_id >= 0) {
+        std::stringstream log_line;
+        log_line << ud << ", " << num_sent << ", " << payload.size() << ", "
+                 << (double) (send_end - send_start) / 1000000.0 << ", "
+                 << num_received << ", " << bytes_received << ", "
+                 << (double) (wait_end - send_end) / 1000000.0 << ", "
+                 << transit_ms << '\n';
+        control.GetAsyncWriter().Write((size_t) log_id, log_line.str());
+      }
+    }
+
+    void BeforeExit() override {
+      StopListening();
+      if (log_id >= 0) control.GetAsyncWriter().Close((size_t) log_id);
+      log_id = -1;
+    }
+  };
+
+  MABE_REGISTER_MODULE(ProcessMigration, "Exchange migrants with other MABE processes over Unix sockets.");
+}
+
+#endif
@@ -0,0 +1,243 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  SteadyState.hpp
+ *  @brief Module to run steady-state evolution, evaluating offspring as they are born.
+ *
+ *  Rather than evaluating an entire population and then replacing it, each birth produces a
+ *  single offspring that is evaluated immediately and then placed over a "victim" in the same
+ *  population.  Each update performs `births_per_update` such births.
+ *
+ *  The modules listed in `evaluators` are deactivated (so they no longer evaluate the whole
+ *  population each update) and are instead called on each offspring through their
+ *  EvaluateOrg() function.  Births are processed in batches of `num_threads`: parents are
+ *  chosen and offspring built on the main thread, the batch is evaluated in parallel, and
+ *  then each offspring is placed in order.  Since all random choices are made on the main
+ *  thread in a fixed order, results for a given random seed do not depend on thread timing.
+ *
+ *  Victims within a batch never include parents whose offspring are still waiting to be placed
+ *  (or positions already filled by this batch), so an organism cannot be replaced before its
+ *  offspring has been placed.  An offspring may replace its own parent, however, so even a
+ *  population of one organism always has a victim available.
+ */
+
+#ifndef MABE_SCHEMA_STEADY_STATE_H
+#define MABE_SCHEMA_STEADY_STATE_H
+
+#include "emp/tools/string_utils.hpp"
+
+#include "../core/MABE.hpp"
+#include "../core/Module.hpp"
+#include "../tools/ThreadPool.hpp"
+
+namespace mabe {
+
+  class SteadyState : public Module {
+  private:
+    int pop_id = 0;                          ///< Which population are we evolving?
+    std::string fitness_trait = "fitness";   ///< Trait used for parent and victim selection.
+    std::string evaluator_names = "";        ///< Comma-separated names of evaluation modules.
+    size_t births_per_update = 100;          ///< How many offspring to produce each update?
+    size_t tourny_size = 2;                  ///< Tournament size for selecting parents (and victims)
+    size_t num_threads = 1;                  ///< Threads to use for evaluation (0 = all available)
+
+    enum Replacement { REPLACE_RANDOM=0, REPLACE_TOURNAMENT, REPLACE_WORST };
+    Replacement replacement = REPLACE_TOURNAMENT;  ///< How should victims be chosen?
+
+    emp::vector<emp::Ptr<ModuleBase>> evaluators;  ///< Modules to evaluate each offspring.
+    ThreadPool thread_pool;
+
+    // Working space for a single batch of births.
+    emp::vector<OrgPosition> parents;              ///< Parent of each offspring in the batch.
+    emp::vector<emp::Ptr<Organism>> offspring;     ///< Offspring waiting to be placed.
+    emp::vector<unsigned char> eval_ok;            ///< Was each offspring successfully evaluated?
+    emp::vector<OrgPosition> victims;              ///< Positions already filled this batch.
+    size_t next_parent = 0;                        ///< Parents from here on still await placement.
+
+    double GetFitness(OrgPosition pos) const { return pos->GetVar<double>(fitness_trait); }
+
+    /// Can this position not be a victim right now?  At most batch_size-1 positions are
+    /// ever protected, so at least one position in the population is always available.
+    bool IsProtected(OrgPosition pos) const {
+      for (size_t i = next_parent; i < parents.size(); i++) if (parents[i] == pos) return true;
+      for (const OrgPosition & test_pos : victims) if (test_pos == pos) return true;
+      return false;
+    }
+
+    /// Run a tournament among random living organisms and return the winner's position.
+    OrgPosition SelectParent(Population & pop) {
+      OrgPosition best_pos = control.GetRandomOrgPos(pop);
+      double best_fit = GetFitness(best_pos);
+      for (size_t test=1; test < tourny_size; test++) {
+        OrgPosition test_pos = control.GetRandomOrgPos(pop);
+        double test_fit = GetFitness(test_pos);
+        if (test_fit > best_fit) {
+          best_pos = test_pos;
+          best_fit = test_fit;
+        }
+      }
+      return best_pos;
+    }
+
+    /// Pick a random position that is not protected in the current batch.
+    OrgPosition RandomVictim(Population & pop) {
+      OrgPosition pos = control.GetRandomPos(pop);
+      while (IsProtected(pos)) pos = control.GetRandomPos(pop);
+      return pos;
+    }
+
+    /// Choose the position that the next offspring should replace.  Tournament and worst
+    /// replacement always prefer an empty position to a living organism.
+    OrgPosition SelectVictim(Population & pop) {
+      switch (replacement) {
+      case REPLACE_RANDOM:
+        return RandomVictim(pop);
+      case REPLACE_TOURNAMENT: {
+        OrgPosition worst_pos = RandomVictim(pop);
+        for (size_t test=1; test < tourny_size && !worst_pos.IsEmpty(); test++) {
+          OrgPosition test_pos = RandomVictim(pop);
+          if (test_pos.IsEmpty() || GetFitness(test_pos) < GetFitness(worst_pos)) worst_pos = test_pos;
+        }
+        return worst_pos;
+      }
+      case REPLACE_WORST: {
+        OrgPosition worst_pos;
+        double worst_fit = 0.0;
+        for (size_t id = 0; id < pop.GetSize(); id++) {
+          OrgPosition pos = pop.IteratorAt(id);
+          if (IsProtected(pos)) continue;
+          if (pos.IsEmpty()) return pos;
+          const double fit = GetFitness(pos);
+          if (!worst_pos.IsValid() || fit < worst_fit) {
+            worst_pos = pos;
+            worst_fit = fit;
+          }
+        }
+        return worst_pos;
+      }
+      }
+      return OrgPosition();
+    }
+
+    /// Run all evaluators on a single organism; safe to call in parallel on distinct orgs.
+    bool Evaluate(Organism & org) {
+      for (emp::Ptr<ModuleBase> mod_ptr : evaluators) {
+        if (!mod_ptr->EvaluateOrg(org)) return false;
+      }
+      return true;
+    }
+
+  public:
+    SteadyState(mabe::MABE & control,
+                const std::string & name="SteadyState",
+                const std::string & desc="Module to run steady-state evolution, evaluating offspring as they are born.")
+      : Module(control, name, desc)
+    {
+      SetSelectMod(true);              ///< Mark this module as a selection module.
+    }
+    ~SteadyState() { }
+
+    void SetupConfig() override {
+      LinkPop(pop_id, "target_pop", "Which population should we evolve?");
+      LinkVar(fitness_trait, "fitness_trait", "Which trait provides the fitness value to use?");
+      LinkVar(evaluator_names, "evaluators", "Comma-separated list of modules to evaluate each offspring.");
+      LinkVar(births_per_update, "births_per_update", "Number of offspring to produce each update.");
+      LinkVar(tourny_size, "tournament_size", "Number of orgs in each tournament");
+      LinkMenu(replacement, "replacement", "How should the organism to replace be chosen?",
+               REPLACE_RANDOM, "random", "Replace a random organism.",
+               REPLACE_TOURNAMENT, "tournament", "Replace the least fit organism in a random tournament.",
+               REPLACE_WORST, "worst", "Replace the least fit organism in the population.");
+      LinkVar(num_threads, "num_threads", "Number of threads for evaluating offspring (0 = all available)");
+    }
+
+    void SetupModule() override {
+      AddRequiredTrait<double>(fitness_trait); ///< The fitness trait must be set by an evaluator.
+
+      // Identify each evaluator and stop it from evaluating whole populations on its own.
+      emp::vector<std::string> names;
+      std::string name_list = evaluator_names;
+      emp::remove_whitespace(name_list);
+      emp::slice(name_list, names, ',');
+
+      evaluators.resize(0);
+      for (const std::string & name : names) {
+        if (name.empty()) continue;
+        const int mod_id = control.GetModuleID(name);
+        if (mod_id == -1) {
+          AddError("SteadyState: unknown module '", name, "' in evaluators list.");
+          continue;
+        }
+        ModuleBase & mod = control.GetModule(mod_id);
+        mod.Deactivate();
+        evaluators.push_back(&mod);
+      }
+      if (evaluators.size() == 0) {
+        AddWarning("SteadyState has no evaluators; offspring will keep their parent's fitness.");
+      }
+
+      if (tourny_size == 0) tourny_size = 1;
+      thread_pool.Resize(num_threads);
+    }
+
+    /// Organisms injected into our population need a fitness before they can compete.
+    void OnInjectReady(Organism & org, Population & pop) override {
+      if ((int) pop.GetID() != pop_id) return;
+      if (!Evaluate(org)) AddError("SteadyState: unable to evaluate injected organism.");
+    }
+
+    void OnUpdate(size_t /* update */) override {
+      Population & pop = control.GetPopulation(pop_id);
+
+      if (pop.GetNumOrgs() == 0) {
+        AddError("Trying to run SteadyState on an Empty Population.");
+        return;
+      }
+
+      // Each batch protects its parents and victims, so keep it small relative to the pop.
+      const size_t batch_max = std::max<size_t>(1, std::min(thread_pool.GetNumThreads(), pop.GetSize() / 2));
+
+      for (size_t births = 0; births < births_per_update; births += parents.size()) {
+        const size_t batch_size = std::min(batch_max, births_per_update - births);
+
+        // Choose parents and build offspring on the main thread (using the master RNG).
+        parents.resize(batch_size);
+        offspring.resize(batch_size);
+        eval_ok.resize(batch_size);
+        for (size_t i = 0; i < batch_size; i++) {
+          parents[i] = SelectParent(pop);
+          offspring[i] = control.MakeOffspring(parents[i], pop);
+        }
+
+        // Evaluate the full batch in parallel.
+        thread_pool.ParallelFor(batch_size, [this](size_t i){ eval_ok[i] = Evaluate(*offspring[i]); });
+
+        // Place each offspring in order, never replacing a parent still waiting on its offspring.
+        victims.resize(0);
+        bool all_ok = true;
+        for (size_t i = 0; i < batch_size; i++) {
+          next_parent = i + 1;
+          if (!eval_ok[i]) {
+            offspring[i].Delete();
+            all_ok = false;
+            continue;
+          }
+          OrgPosition victim_pos = SelectVictim(pop);
+          emp_assert(victim_pos.IsValid());
+          control.PlaceOffspring(offspring[i], parents[i], victim_pos);
+          victims.push_back(victim_pos);
+        }
+
+        if (!all_ok) {
+          AddError("SteadyState: evaluators must support evaluating individual organisms.");
+          return;
+        }
+      }
+    }
+  };
+
+  MABE_REGISTER_MODULE(SteadyState, "Steady-state evolution, evaluating offspring as they are born.");
+}
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  ColumnFile.hpp
+ *  @brief Tools to write and read typed, column-chunked binary data files.
+ *
+ *  A column file stores a table of numbers where every column has a fixed type.  Rows are
+ *  buffered into chunks, and each chunk stores all of its values for one column contiguously,
+ *  so a reader can load whole columns directly into arrays.
+ *
+ *  File layout (version 1; all values use the byte order of the machine that wrote them,
+ *  which is little-endian on all currently supported platforms):
+ *
+ *    Header : char[8] "MABECOLS", uint32 version, uint32 column count,
+ *             then for each column: uint32 type (0 = int64, 1 = double),
+ *                                   uint32 name length, name bytes;
+ *             zero padding to the next multiple of 8 bytes.
+ *    Chunks : char[4] "CHNK", uint32 row count (R),
+ *             then for each column in order: R values of 8 bytes each.
+ *
+ *  Chunks are simply appended until the file ends; a file with no chunks has no rows.  See
+ *  build/read_columns.py for a Python reader.
+ */
+
+#ifndef MABE_COLUMN_FILE_H
+#define MABE_COLUMN_FILE_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+
+namespace mabe {
+
+  class ColumnFile {
+  public:
+    enum class Type : uint32_t { INT64=0, DOUBLE=1 };
+
+    struct ColumnInfo {
+      std::string name;
+      Type type;
+    };
+
+    static constexpr uint32_t VERSION = 1;
+
+  protected:
+    emp::vector<ColumnInfo> columns;
+
+    /// Each column stores 8-byte values; doubles and int64s are kept as raw bits.
+    emp::vector<emp::vector<uint64_t>> data;
+
+  public:
+    size_t GetNumColumns() const { return columns.size(); }
+    const ColumnInfo & GetColumnInfo(size_t col) const { return columns[col]; }
+    const std::string & GetColumnName(size_t col) const { return columns[col].name; }
+    Type GetColumnType(size_t col) const { return columns[col].type; }
+    size_t GetNumRows() const { return data.size() ? data[0].size() : 0; }
+
+    /// Return the position of the named column, or -1 if it does not exist.
+    int GetColumnID(const std::string & name) const {
+      for (size_t i = 0; i < columns.size(); i++) if (columns[i].name == name) return (int) i;
+      return -1;
+    }
+  };
+
+  /// Accumulate rows and write them out in column-chunked blocks.
+  class ColumnFileWriter : public ColumnFile {
+  private:
+    size_t chunk_rows = 64;   ///< Number of rows to buffer before writing a chunk.
+    size_t next_col = 0;      ///< Which column should the next value go into?
+
+  public:
+    ColumnFileWriter() { }
+
+    void SetChunkRows(size_t in_rows) { chunk_rows = in_rows ? in_rows : 1; }
+    size_t GetNumPendingRows() const { return GetNumRows(); }
+
+    /// Add a new column; all columns must be added before any rows.
+    void AddColumn(const std::string & name, Type type) {
+      emp_assert(GetNumRows() == 0 && next_col == 0, "Columns must be added before rows.");
+      columns.push_back(ColumnInfo{name, type});
+      data.emplace_back();
+    }
+
+    /// Write out the header information for this file.
+    void WriteHeader(std::ostream & os) const {
+      const uint32_t num_cols = (uint32_t) columns.size();
+      os.write("MABECOLS", 8);
+      os.write((const char *) &VERSION, sizeof(VERSION));
+      os.write((const char *) &num_cols, sizeof(num_cols));
+      size_t header_size = 16;
+      for (const ColumnInfo & info : columns) {
+        const uint32_t name_size = (uint32_t) info.name.size();
+        os.write((const char *) &info.type, sizeof(info.type));
+        os.write((const char *) &name_size, sizeof(name_size));
+        os.write(info.name.data(), name_size);
+        header_size += 8 + name_size;
+      }
+      while (header_size % 8) { os.put('\0'); header_size++; }
+    }
+
+    /// Add the next value in the current row (values must be provided in column order).
+    void AddValue(int64_t value) {
+      emp_assert(next_col < columns.size());
+      emp_assert(columns[next_col].type == Type::INT64, columns[next_col].name);
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      data[next_col++].push_back(bits);
+    }
+
+    void AddValue(double value) {
+      emp_assert(next_col < columns.size());
+      emp_assert(columns[next_col].type == Type::DOUBLE, columns[next_col].name);
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      data[next_col++].push_back(bits);
+    }
+
+    /// Finish the current row; write out a chunk if enough rows are buffered.
+    void EndRow(std::ostream & os) {
+      emp_assert(next_col == columns.size(), "All columns must be filled before a row ends.",
+                 next_col, columns.size());
+      next_col = 0;
+      if (GetNumRows() >= chunk_rows) WriteChunk(os);
+    }
+
+    /// Write all buffered rows as a chunk (if there are any).
+    void WriteChunk(std::ostream & os) {
+      emp_assert(next_col == 0, "Cannot write a chunk in the middle of a row.");
+      const uint32_t num_rows = (uint32_t) GetNumRows();
+      if (num_rows == 0) return;
+      os.write("CHNK", 4);
+      os.write((const char *) &num_rows, sizeof(num_rows));
+      for (auto & col_data : data) {
+        os.write((const char *) col_data.data(), (std::streamsize) (num_rows * sizeof(uint64_t)));
+        col_data.resize(0);
+      }
+    }
+  };
+
+  /// Load a full column file into memory.
+  class ColumnFileReader : public ColumnFile {
+  private:
+    std::string error;
+
+    bool Fail(const std::string & msg) { error = msg; return false; }
+
+  public:
+    ColumnFileReader() { }
+    ColumnFileReader(const std::string & filename) { Load(filename); }
+
+    const std::string & GetError() const { return error; }
+
+    /// Load the contents of the file; return success.
+    bool Load(std::istream & is) {
+      columns.resize(0);
+      data.resize(0);
+
+      char magic[8];
+      uint32_t version = 0, num_cols = 0;
+      is.read(magic, 8);
+      is.read((char *) &version, sizeof(version));
+      is.read((char *) &num_cols, sizeof(num_cols));
+      if (!is || std::memcmp(magic, "MABECOLS", 8) != 0) return Fail("Not a MABE column file.");
+      if (version != VERSION) return Fail("Unknown column file version " + std::to_string(version) + ".");
+
+      size_t header_size = 16;
+      for (uint32_t i = 0; i < num_cols; i++) {
+        uint32_t type = 0, name_size = 0;
+        is.read((char *) &type, sizeof(type));
+        is.read((char *) &name_size, sizeof(name_size));
+        std::string name(name_size, '\0');
+        is.read(name.data(), name_size);
+        if (!is || type > (uint32_t) Type::DOUBLE) return Fail("Corrupt column file header.");
+        columns.push_back(ColumnInfo{name, (Type) type});
+        header_size += 8 + name_size;
+      }
+      data.resize(num_cols);
+      is.ignore((std::streamsize) ((8 - header_size % 8) % 8));
+
+      // Load chunks until the end of the file.
+      char tag[4];
+      while (is.read(tag, 4)) {
+        uint32_t num_rows = 0;
+        is.read((char *) &num_rows, sizeof(num_rows));
+        if (!is || std::memcmp(tag, "CHNK", 4) != 0) return Fail("Corrupt chunk in column file.");
+        for (auto & col_data : data) {
+          const size_t start = col_data.size();
+          col_data.resize(start + num_rows);
+          is.read((char *) (col_data.data() + start), (std::streamsize) (num_rows * sizeof(uint64_t)));
+        }
+        if (!is) return Fail("Column file ends in the middle of a chunk.");
+      }
+      return true;
+    }
+
+    bool Load(const std::string & filename) {
+      std::ifstream is(filename, std::ios::binary);
+      if (!is) return Fail("Unable to open '" + filename + "'.");
+      return Load(is);
+    }
+
+    /// Get a single value from the table (converting as needed).
+    double GetDouble(size_t row, size_t col) const {
+      const uint64_t bits = data[col][row];
+      if (columns[col].type == Type::INT64) {
+        int64_t value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return (double) value;
+      }
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+
+    int64_t GetInt(size_t row, size_t col) const {
+      const uint64_t bits = data[col][row];
+      if (columns[col].type == Type::DOUBLE) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return (int64_t) value;
+      }
+      int64_t value;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+
+    /// Get a full column as doubles.
+    emp::vector<double> GetColumn(size_t col) const {
+      emp::vector<double> out(GetNumRows());
+      for (size_t row = 0; row < out.size(); row++) out[row] = GetDouble(row, col);
+      return out;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  EventFile.hpp
+ *  @brief Tools to write a binary journal of organism birth and death events.
+ *
+ *  Each event is a fixed-size record: the update it occurred in, the event type, the ID of
+ *  the organism, the ID of its parent (births only; 0 for none), and the population and
+ *  position involved.  Records are buffered into blocks; a block is either stored raw (as
+ *  an array of 32-byte records) or compressed by delta-encoding each field against the
+ *  previous record and storing the results as variable-length integers.  Consecutive events
+ *  tend to share an update, have nearby IDs, and births usually sit close to their parent's
+ *  ID, so most compressed records take 5-8 bytes.
+ *
+ *  File layout (version 1; all values use the byte order of the machine that wrote them,
+ *  which is little-endian on all currently supported platforms):
+ *
+ *    Header : char[8] "MABEEVNT", uint32 version, uint32 flags (bit 0 = compressed),
+ *             uint32 record size (32), uint32 zero padding.
+ *    Blocks : char[4] "EVBK", uint32 record count (R), uint64 payload size in bytes,
+ *             then the payload.
+ *
+ *  Raw records are: uint64 update, uint64 org id, uint64 parent id, uint32 position,
+ *  uint16 population id, uint8 event type, uint8 zero padding.
+ *
+ *  Compressed records are a sequence of unsigned LEB128 varints (zigzag-encoded where the
+ *  difference may be negative), relative to the previous record in the same block (all
+ *  fields start at zero at the beginning of each block):
+ *
+ *    update - prev update, event type, zigzag(org id - prev org id),
+ *    (org id - parent id) or 0 if there is no parent, zigzag(position - prev position),
+ *    population id.
+ *
+ *  See build/read_events.py for a Python reader.
+ */
+
+#ifndef MABE_EVENT_FILE_H
+#define MABE_EVENT_FILE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+
+namespace mabe {
+
+  class EventFileWriter {
+  public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t FLAG_COMPRESSED = 1;
+
+    enum class Type : uint8_t { BIRTH = 0, DEATH = 1, MOVE = 2 };
+
+    struct Record {
+      uint64_t update = 0;
+      uint64_t org_id = 0;
+      uint64_t parent_id = 0;    ///< ID of parent organism (0 if none or not a birth).
+      uint32_t pos = 0;
+      uint16_t pop_id = 0;
+      Type type = Type::BIRTH;
+      uint8_t padding = 0;
+    };
+    static_assert(sizeof(Record) == 32, "Event records must be exactly 32 bytes.");
+
+  private:
+    emp::vector<Record> records;  ///< Records waiting to be written.
+    size_t block_records = 4096;  ///< Number of records to buffer per block.
+    bool compress = false;        ///< Should blocks be delta/varint compressed?
+
+    static void AppendVarint(std::string & out, uint64_t value) {
+      while (value >= 0x80) {
+        out += (char) ((value & 0x7f) | 0x80);
+        value >>= 7;
+      }
+      out += (char) value;
+    }
+
+    static uint64_t ZigZag(uint64_t a, uint64_t b) {
+      const int64_t diff = (int64_t) (a - b);
+      return ((uint64_t) diff << 1) ^ (uint64_t) (diff >> 63);
+    }
+
+    void EncodeRecords(std::string & out) const {
+      Record prev;
+      for (const Record & rec : records) {
+        emp_assert(rec.update >= prev.update, "Events must be journaled in update order.");
+        AppendVarint(out, rec.update - prev.update);
+        out += (char) rec.type;
+        AppendVarint(out, ZigZag(rec.org_id, prev.org_id));
+        AppendVarint(out, rec.parent_id ? rec.org_id - rec.parent_id : 0);
+        AppendVarint(out, ZigZag(rec.pos, prev.pos));
+        AppendVarint(out, rec.pop_id);
+        prev = rec;
+      }
+    }
+
+  public:
+    EventFileWriter() { }
+
+    void SetBlockRecords(size_t in_records) { block_records = in_records ? in_records : 1; }
+    void SetCompress(bool in_compress) { compress = in_compress; }
+    size_t GetNumPending() const { return records.size(); }
+
+    /// Append the header information for this file to a buffer.
+    void WriteHeader(std::string & out) const {
+      const uint32_t header[4] = { VERSION, compress ? FLAG_COMPRESSED : 0,
+                                   (uint32_t) sizeof(Record), 0 };
+      out.append("MABEEVNT", 8);
+      out.append((const char *) header, sizeof(header));
+    }
+
+    /// Add an event; returns true once a full block is ready to be written.
+    bool AddEvent(Type type, uint64_t update, uint64_t org_id, uint64_t parent_id,
+                  size_t pos, size_t pop_id) {
+      emp_assert(parent_id < org_id || parent_id == 0, "Parents must predate offspring.");
+      records.emplace_back();
+      Record & rec = records.back();
+      rec.update = update;
+      rec.org_id = org_id;
+      rec.parent_id = parent_id;
+      rec.pos = (uint32_t) pos;
+      rec.pop_id = (uint16_t) pop_id;
+      rec.type = type;
+      return records.size() >= block_records;
+    }
+
+    /// Append all buffered records to a buffer as a block (if there are any).
+    void WriteBlock(std::string & out) {
+      const uint32_t num_records = (uint32_t) records.size();
+      if (num_records == 0) return;
+
+      const size_t header_pos = out.size();
+      out.append("EVBK", 4);
+      out.append((const char *) &num_records, sizeof(num_records));
+      out.append(sizeof(uint64_t), '\0');           // Payload size is filled in below.
+
+      const size_t payload_start = out.size();
+      if (compress) EncodeRecords(out);
+      else out.append((const char *) records.data(), records.size() * sizeof(Record));
+
+      const uint64_t payload_size = out.size() - payload_start;
+      std::memcpy(&out[header_pos + 8], &payload_size, sizeof(payload_size));
+      records.resize(0);
+    }
+  };
+
+}
+
+#endif
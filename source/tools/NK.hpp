@@ -114,6 +114,13 @@ namespace mabe {
       return landscape[n][state];
     }
 
+    /// Set the fitness contribution of position [n] when it (and its K neighbors) have the value
+    /// [state]; used to restore a saved landscape.
+    void SetFitness(size_t n, size_t state, double fitness) {
+      emp_assert(state < state_count, state, state_count);
+      landscape[n][state] = fitness;
+    }
+
     /// Get the fitness of a whole  bitstring
     double GetFitness( std::vector<size_t> states ) const {
       emp_assert(states.size() == N);
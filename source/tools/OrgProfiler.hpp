@@ -0,0 +1,97 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  OrgProfiler.hpp
+ *  @brief Aggregate instruction counts and evaluation times for program-based organisms.
+ *
+ *  Organism types that execute programs (e.g., SimpleProgramOrg and AvidaGPOrg) can profile
+ *  their evaluations when MABE is compiled with MABE_PROFILE_ORGS defined (e.g., with
+ *  "make profile").  Each evaluation counts the instructions it executes of each type and
+ *  times itself, then adds the results to the manager's OrgProfiler with AddEval(); this is
+ *  thread safe.  Once per update, Flush() reports the totals (typically as time series) and
+ *  clears them:
+ *
+ *    evals          : Number of evaluations.
+ *    insts          : Total instructions executed.
+ *    insts_per_eval : Mean instructions per evaluation.
+ *    max_insts      : Most instructions in a single evaluation.
+ *    eval_us        : Mean time per evaluation, in microseconds.
+ *    max_eval_us    : Longest single evaluation, in microseconds.
+ *    total_eval_ms  : Total time spent evaluating, in milliseconds.
+ *    op.<name>      : Number of times each instruction was executed.
+ */
+
+#ifndef MABE_ORG_PROFILER_H
+#define MABE_ORG_PROFILER_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+
+namespace mabe {
+
+  class OrgProfiler {
+  private:
+    emp::vector<std::string> op_names;  ///< Name of each instruction being counted.
+    emp::vector<uint64_t> op_counts;    ///< Executions of each instruction since last flush.
+    size_t num_evals = 0;
+    uint64_t total_insts = 0;
+    uint64_t max_insts = 0;
+    double total_us = 0.0;
+    double max_us = 0.0;
+    std::mutex mutex;
+
+  public:
+    OrgProfiler() { }
+
+    /// Set the names of all instructions that will be counted (in ID order).
+    void SetOps(const emp::vector<std::string> & names) {
+      std::lock_guard<std::mutex> lock(mutex);
+      op_names = names;
+      op_counts.resize(0);
+      op_counts.resize(names.size(), 0);
+    }
+
+    size_t GetNumOps() const { return op_names.size(); }
+
+    /// Add the results of one evaluation; counts (if provided) must have GetNumOps() entries.
+    void AddEval(const uint64_t * counts, uint64_t num_insts, double eval_us) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (counts) for (size_t i = 0; i < op_counts.size(); i++) op_counts[i] += counts[i];
+      num_evals++;
+      total_insts += num_insts;
+      if (num_insts > max_insts) max_insts = num_insts;
+      total_us += eval_us;
+      if (eval_us > max_us) max_us = eval_us;
+    }
+
+    /// Report all totals through record_fun(name, value) and then reset them.
+    template <typename FUN_T>
+    void Flush(FUN_T && record_fun) {
+      std::lock_guard<std::mutex> lock(mutex);
+      const double evals = (double) num_evals;
+      record_fun("evals", evals);
+      record_fun("insts", (double) total_insts);
+      record_fun("insts_per_eval", num_evals ? (double) total_insts / evals : 0.0);
+      record_fun("max_insts", (double) max_insts);
+      record_fun("eval_us", num_evals ? total_us / evals : 0.0);
+      record_fun("max_eval_us", max_us);
+      record_fun("total_eval_ms", total_us / 1000.0);
+      for (size_t i = 0; i < op_names.size(); i++) {
+        record_fun("op." + op_names[i], (double) op_counts[i]);
+        op_counts[i] = 0;
+      }
+      num_evals = 0;
+      total_insts = max_insts = 0;
+      total_us = max_us = 0.0;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,415 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  SimpleProgramVM.hpp
+ *  @brief A small, fast virtual machine for the programs used by SimpleProgramOrg.
+ *
+ *  A genome is GENOME_SIZE instructions of four bytes each: an instruction ID (taken modulo
+ *  the number of instructions, so every byte value is legal) followed by three arguments.
+ *  Arguments name one of 16 variables: A-J (0-9) are registers, and the final six are
+ *  indirections through registers E-J into internal (0-511), input (512-767), and output
+ *  (768-1023) memory.  For the CONST instructions, ARG2 instead selects a constant.
+ *
+ *  IF, WHILE, and COUNTDOWN each open a scope that is closed by the matching END_SCOPE (or by
+ *  the end of the genome).  IF skips its scope if ARG1 is zero; WHILE does the same, but
+ *  returns to re-test ARG1 whenever its scope ends; COUNTDOWN skips its scope if ARG1 is not
+ *  positive and otherwise decrements ARG1 before each pass.  CONTINUE returns to the start of
+ *  the innermost loop (or the start of the genome), and BREAK leaves the innermost loop (or
+ *  halts the program).  Execution wraps around to the start of the genome when it runs off
+ *  the end.
+ *
+ *  Rather than interpreting the genome directly, it is decoded once into a program: a compact
+ *  array of 16-byte instructions with arguments masked, constants looked up, and every jump
+ *  target resolved, so scope structure never needs to be rescanned during execution.
+ *  END_SCOPE, CONTINUE, and BREAK are decoded into JUMPs, NOPs, or HALTs, and scopes left
+ *  open at the end of the genome get implicit closing instructions.  Programs are run with
+ *  computed-goto dispatch where the compiler supports it (GCC and Clang), or a switch
+ *  otherwise; define MABE_NO_COMPUTED_GOTO to force the switch.
+ *
+ *  If MABE_PROFILE_ORGS is defined, the VM also counts how many times each (decoded)
+ *  instruction is executed; see GetOpCounts().
+ */
+
+#ifndef MABE_SIMPLE_PROGRAM_VM_H
+#define MABE_SIMPLE_PROGRAM_VM_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "emp/base/array.hpp"
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+
+#if defined(__GNUC__) && !defined(MABE_NO_COMPUTED_GOTO)
+#define MABE_SPVM_COMPUTED_GOTO 1
+#endif
+
+namespace mabe {
+
+  class SimpleProgramVM {
+  public:
+    enum class Inst : uint8_t {
+      GET_CONST, ADD_CONST, MULT_CONST,  // (3) Modify ARG1 by ARG2c
+      ADD, SUB, MULT, DIV, MOD, NAND,    // (6) Basic two-input math (ARG3 = ARG1 op ARG2)
+      TEST_EQU, TEST_NEQU, TEST_LESS,    // (3) COMPARE ARG1 and ARG2; put 0/1 result in ARG3
+      COPY,                              // (1) Copy ARG1 into ARG2
+      IF,                                // (1) Open scope; skip it if ARG1 is 0.
+      WHILE,                             // (1) Open scope; repeat as long as ARG1 is non-zero
+      COUNTDOWN,                         // (1) Open scope; repeat and dec ARG1 while positive
+      CONTINUE,                          // (1) Jump back to WHILE or COUNTDOWN start, or prog start
+      BREAK,                             // (1) Jump to end of WHILE or COUNTDOWN scope, or halt prog
+      END_SCOPE,                         // (1) Close the current scope.
+      PUSH, POP,                         // (2) Treat ARG1 as stack pointer; push/pop with ARG2
+      NUM_BASE_INSTS,                    // 21 - Marker for total instruction count in base set
+
+      // Internal instructions; genomes are decoded into these but cannot contain them.
+      JUMP = NUM_BASE_INSTS,             // Jump to target.
+      NOP,                               // Do nothing.
+      HALT,                              // Stop execution.
+      NUM_OPS,                           // Marker for total number of decoded instructions.
+
+      ERROR                              // Invalid instruction!
+    };
+
+    static constexpr size_t NUM_INSTS = (size_t) Inst::NUM_BASE_INSTS;
+    static constexpr size_t NUM_OPS = (size_t) Inst::NUM_OPS;
+
+    static constexpr size_t GENOME_SIZE = 64;
+    static constexpr size_t INST_BYTES = 4;
+
+    static constexpr size_t NUM_REGS = 16;
+    static constexpr size_t MEM_SIZE = 1024;
+    static constexpr size_t MEM_IO_SIZE = 256;
+    static constexpr size_t MEM_INTERNAL_START = 0;
+    static constexpr size_t MEM_INPUT_START = 512;
+    static constexpr size_t MEM_OUTPUT_START = MEM_INPUT_START + MEM_IO_SIZE;
+    static_assert(MEM_OUTPUT_START + MEM_IO_SIZE <= MEM_SIZE, "IO must fit inside other memoery.");
+
+    static constexpr size_t MEM_MASK = MEM_SIZE - 1;
+    static constexpr size_t REG_MASK = NUM_REGS - 1;
+
+    using genome_t = emp::array<unsigned char, GENOME_SIZE*INST_BYTES>;
+    using memory_t = emp::array<double, MEM_SIZE>;
+
+    /// A single decoded instruction.
+    struct Op {
+      Inst inst = Inst::NOP;
+      uint8_t arg1 = 0;
+      uint8_t arg2 = 0;
+      uint8_t arg3 = 0;
+      uint32_t target = 0;  ///< Where to jump (for IF, WHILE, COUNTDOWN, and JUMP).
+      double value = 0.0;   ///< Constant value (for CONST instructions).
+    };
+    static_assert(sizeof(Op) == 16, "Decoded instructions should be 16 bytes.");
+
+    /// A decoded program; never longer than PROGRAM_MAX_SIZE.
+    using program_t = emp::vector<Op>;
+    static constexpr size_t PROGRAM_MAX_SIZE = 2 * GENOME_SIZE + 1;
+
+  private:
+    memory_t mem;              ///< Memory for program to manipulate (registers come first).
+    size_t inst_ptr = 0;       ///< Position in program to execute next.
+    bool halted = false;       ///< Has the program executed a HALT?
+#ifdef MABE_PROFILE_ORGS
+    emp::array<uint64_t, NUM_OPS> op_counts;  ///< Executions of each instruction since Reset().
+#endif
+
+    // Convert a value to an integer for use as bits or a memory position; values that are out
+    // of range (including NaN) become zero.
+    static int64_t ToInt(double value) {
+      return (value > -9.0e18 && value < 9.0e18) ? (int64_t) value : 0;
+    }
+    static size_t ToMemPos(double value, size_t offset) {
+      return (offset + (size_t) ToInt(value)) & MEM_MASK;
+    }
+
+    // Convert an argument to the associated variable.
+    double & Var(const uint8_t arg) {
+      // We're assuming 16 registers, where the last 6 are indirections.
+      if (arg < 10) return mem[arg];
+      switch (arg) {
+        case 10: return mem[ToMemPos(mem[4], MEM_INTERNAL_START)]; // Internal memory.
+        case 11: return mem[ToMemPos(mem[5], MEM_INTERNAL_START)]; // Internal memory.
+        case 12: return mem[ToMemPos(mem[6], MEM_INPUT_START)];    // Input memory.
+        case 13: return mem[ToMemPos(mem[7], MEM_INPUT_START)];    // Input memory.
+        case 14: return mem[ToMemPos(mem[8], MEM_OUTPUT_START)];   // Output memory.
+        default: return mem[ToMemPos(mem[9], MEM_OUTPUT_START)];   // Output memory.
+      };
+    }
+
+    struct Scope {
+      uint32_t start;       ///< Position of the IF, WHILE, or COUNTDOWN that opened this scope.
+      uint32_t break_mark;  ///< Number of pending BREAKs when the scope opened.
+    };
+
+    // Close the innermost open scope with the instruction about to be added at prog.size().
+    static void CloseScope(program_t & prog, emp::vector<Scope> & scopes,
+                           emp::vector<uint32_t> & breaks, Op & closer) {
+      const Scope scope = scopes.back();
+      scopes.pop_back();
+      const uint32_t end_pos = (uint32_t) prog.size() + 1;
+      Op & start = prog[scope.start];
+      start.target = end_pos;
+      if (start.inst == Inst::IF) { closer.inst = Inst::NOP; return; }
+
+      // Loops return to their start; BREAKs inside leave to just past the end.
+      closer.inst = Inst::JUMP;
+      closer.target = scope.start;
+      for (size_t i = scope.break_mark; i < breaks.size(); i++) prog[breaks[i]].target = end_pos;
+      breaks.resize(scope.break_mark);
+    }
+
+    // Find the innermost loop that is currently open; return -1 if none.
+    static int FindLoop(const program_t & prog, const emp::vector<Scope> & scopes) {
+      for (size_t i = scopes.size(); i > 0; i--) {
+        if (prog[scopes[i-1].start].inst != Inst::IF) return (int) scopes[i-1].start;
+      }
+      return -1;
+    }
+
+  public:
+    SimpleProgramVM() { Reset(); }
+
+    /// Convert an argument to the associated constant.
+    static double GetArgConst(const unsigned char arg) {
+      // Easy access to a range of potentially useful constants.
+      constexpr double CONSTS[NUM_REGS] = { -2.0, -1.0, 0.0, 0.25, 0.5, 1.0, 2.0, 3.0,
+                                            4.0, 8.0, 16.0, 32.0, 64.0, 128.0, 256.0, 512.0 };
+      return CONSTS[arg & REG_MASK];
+    }
+
+    /// Translate a genome into a program, with all scope jumps resolved.
+    static void Decode(const genome_t & genome, program_t & prog) {
+      emp::vector<Scope> scopes;
+      emp::vector<uint32_t> breaks;   // BREAKs waiting for the end of their loop.
+      prog.resize(0);
+      prog.reserve(PROGRAM_MAX_SIZE);
+
+      for (size_t i = 0; i < GENOME_SIZE; i++) {
+        const unsigned char * bytes = genome.data() + i * INST_BYTES;
+        Op op;
+        op.inst = (Inst) (bytes[0] % NUM_INSTS);
+        op.arg1 = bytes[1] & REG_MASK;
+        op.arg2 = bytes[2] & REG_MASK;
+        op.arg3 = bytes[3] & REG_MASK;
+
+        switch (op.inst) {
+        case Inst::GET_CONST:
+        case Inst::ADD_CONST:
+        case Inst::MULT_CONST:
+          op.value = GetArgConst(op.arg2);
+          break;
+        case Inst::IF:
+        case Inst::WHILE:
+        case Inst::COUNTDOWN:
+          scopes.push_back(Scope{(uint32_t) prog.size(), (uint32_t) breaks.size()});
+          break;
+        case Inst::END_SCOPE:
+          if (scopes.size()) CloseScope(prog, scopes, breaks, op);
+          else op.inst = Inst::NOP;   // No scope?  Ignore it!
+          break;
+        case Inst::CONTINUE: {
+          const int loop_pos = FindLoop(prog, scopes);
+          op.inst = Inst::JUMP;
+          op.target = (loop_pos < 0) ? 0 : (uint32_t) loop_pos;
+          break;
+        }
+        case Inst::BREAK:
+          if (FindLoop(prog, scopes) < 0) op.inst = Inst::HALT;
+          else {
+            op.inst = Inst::JUMP;
+            breaks.push_back((uint32_t) prog.size());
+          }
+          break;
+        default:
+          break;
+        }
+
+        prog.push_back(op);
+      }
+
+      // Close any scopes still open, then loop back to the start.
+      while (scopes.size()) {
+        Op closer;
+        CloseScope(prog, scopes, breaks, closer);
+        prog.push_back(closer);
+      }
+      Op wrap;
+      wrap.inst = Inst::JUMP;
+      prog.push_back(wrap);
+
+      emp_assert(breaks.size() == 0);
+      emp_assert(prog.size() <= PROGRAM_MAX_SIZE, prog.size());
+    }
+
+    /// Clear all memory and return to the start of the program.
+    void Reset() {
+      mem.fill(0.0);
+      inst_ptr = 0;
+      halted = false;
+#ifdef MABE_PROFILE_ORGS
+      op_counts.fill(0);
+#endif
+    }
+
+    bool IsHalted() const { return halted; }
+    size_t GetInstPtr() const { return inst_ptr; }
+#ifdef MABE_PROFILE_ORGS
+    const emp::array<uint64_t, NUM_OPS> & GetOpCounts() const { return op_counts; }
+#endif
+
+    double GetInput(size_t id) const { return mem[MEM_INPUT_START + (id & (MEM_IO_SIZE-1))]; }
+    double GetOutput(size_t id) const { return mem[MEM_OUTPUT_START + (id & (MEM_IO_SIZE-1))]; }
+    void SetInput(size_t id, double value) { mem[MEM_INPUT_START + (id & (MEM_IO_SIZE-1))] = value; }
+
+#ifdef MABE_SPVM_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"   // Computed gotos are a GCC/Clang extension.
+#endif
+
+    /// Run a decoded program for up to max_cycles instructions (stopping early if it halts);
+    /// return the number of instructions executed.
+    size_t Run(const program_t & prog, size_t max_cycles) {
+      emp_assert(prog.size() && prog.back().inst == Inst::JUMP, "Programs must be decoded before running.");
+      if (halted) return 0;
+
+      const Op * const ops = prog.data();
+      const Op * op = nullptr;
+      size_t ip = inst_ptr;
+      size_t cycles = 0;
+
+#ifdef MABE_PROFILE_ORGS
+      #define MABE_SPVM_COUNT() ++op_counts[(size_t) op->inst]
+#else
+      #define MABE_SPVM_COUNT()
+#endif
+
+#ifdef MABE_SPVM_COMPUTED_GOTO
+      // Labels in the same order as Inst; instructions that are never decoded act as NOP.
+      static const void * const labels[NUM_OPS] = {
+        &&do_GET_CONST, &&do_ADD_CONST, &&do_MULT_CONST,
+        &&do_ADD, &&do_SUB, &&do_MULT, &&do_DIV, &&do_MOD, &&do_NAND,
+        &&do_TEST_EQU, &&do_TEST_NEQU, &&do_TEST_LESS, &&do_COPY,
+        &&do_IF, &&do_WHILE, &&do_COUNTDOWN, &&do_NOP, &&do_NOP, &&do_NOP,
+        &&do_PUSH, &&do_POP, &&do_JUMP, &&do_NOP, &&do_HALT
+      };
+      #define MABE_SPVM_CASE(INST) do_##INST
+      #define MABE_SPVM_NEXT() if (cycles == max_cycles) goto done; \
+                               op = ops + ip++; ++cycles; MABE_SPVM_COUNT(); \
+                               goto *labels[(size_t) op->inst]
+      MABE_SPVM_NEXT();
+#else
+      #define MABE_SPVM_CASE(INST) case Inst::INST
+      #define MABE_SPVM_NEXT() continue
+      while (cycles < max_cycles) {
+        op = ops + ip++;
+        ++cycles;
+        MABE_SPVM_COUNT();
+        switch (op->inst) {
+        case Inst::END_SCOPE:
+        case Inst::CONTINUE:
+        case Inst::BREAK:
+        case Inst::NUM_OPS:
+        case Inst::ERROR:
+#endif
+
+        MABE_SPVM_CASE(NOP):
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(GET_CONST):       // Set ARG1 to the constant value represented by ARG2
+          Var(op->arg1) = op->value;
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(ADD_CONST):
+          Var(op->arg1) += op->value;
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(MULT_CONST):
+          Var(op->arg1) *= op->value;
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(ADD):
+          Var(op->arg3) = Var(op->arg1) + Var(op->arg2);
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(SUB):
+          Var(op->arg3) = Var(op->arg1) - Var(op->arg2);
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(MULT):
+          Var(op->arg3) = Var(op->arg1) * Var(op->arg2);
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(DIV): {           // Division by zero does nothing.
+          const double denom = Var(op->arg2);
+          if (denom != 0.0) Var(op->arg3) = Var(op->arg1) / denom;
+          MABE_SPVM_NEXT();
+        }
+        MABE_SPVM_CASE(MOD): {
+          const double denom = Var(op->arg2);
+          if (denom != 0.0) Var(op->arg3) = std::remainder(Var(op->arg1), denom);
+          MABE_SPVM_NEXT();
+        }
+        MABE_SPVM_CASE(NAND): {
+          const uint64_t bits = ~((uint64_t) ToInt(Var(op->arg1)) & (uint64_t) ToInt(Var(op->arg2)));
+          Var(op->arg3) = (double) (int64_t) bits;
+          MABE_SPVM_NEXT();
+        }
+        MABE_SPVM_CASE(TEST_EQU):
+          Var(op->arg3) = (Var(op->arg1) == Var(op->arg2));
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(TEST_NEQU):
+          Var(op->arg3) = (Var(op->arg1) != Var(op->arg2));
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(TEST_LESS):
+          Var(op->arg3) = (Var(op->arg1) < Var(op->arg2));
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(COPY):
+          Var(op->arg2) = Var(op->arg1);
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(IF):              // IF and WHILE differ only at the end of their scope.
+        MABE_SPVM_CASE(WHILE):
+          if (Var(op->arg1) == 0.0) ip = op->target;
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(COUNTDOWN): {
+          double & counter = Var(op->arg1);
+          if (counter > 0.0) counter -= 1.0;
+          else ip = op->target;
+          MABE_SPVM_NEXT();
+        }
+        MABE_SPVM_CASE(PUSH): {
+          double & stack_ptr = Var(op->arg1);
+          mem[ToMemPos(stack_ptr, 0)] = Var(op->arg2);
+          stack_ptr += 1.0;
+          MABE_SPVM_NEXT();
+        }
+        MABE_SPVM_CASE(POP): {
+          double & stack_ptr = Var(op->arg1);
+          stack_ptr -= 1.0;
+          Var(op->arg2) = mem[ToMemPos(stack_ptr, 0)];
+          MABE_SPVM_NEXT();
+        }
+        MABE_SPVM_CASE(JUMP):
+          ip = op->target;
+          MABE_SPVM_NEXT();
+        MABE_SPVM_CASE(HALT):
+          halted = true;
+          goto done;
+
+#ifndef MABE_SPVM_COMPUTED_GOTO
+        }
+      }
+#endif
+      #undef MABE_SPVM_CASE
+      #undef MABE_SPVM_NEXT
+      #undef MABE_SPVM_COUNT
+
+    done:
+      inst_ptr = ip;
+      return cycles;
+    }
+
+#ifdef MABE_SPVM_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+  };
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ *  @note This file is part of MABE, https://github.com/mercere99/MABE2
+ *  @copyright Copyright (C) Michigan State University, MIT Software license; see doc/LICENSE.md
+ *  @date 2021.
+ *
+ *  @file  ThreadPool.hpp
+ *  @brief A small set of persistent worker threads for running parallel loops.
+ *
+ *  A ThreadPool keeps its worker threads alive between calls so that modules can run many
+ *  short parallel loops (e.g., once per update, or once per batch of births) without paying
+ *  thread start-up costs each time.  The calling thread always participates in the work, so
+ *  a pool built for N threads launches N-1 helpers; a pool of size 1 runs everything inline.
+ *
+ *  ParallelFor() hands out indices dynamically, so uneven work is balanced automatically.
+ *  The function provided must be safe to call concurrently for different indices.
+ */
+
+#ifndef MABE_THREAD_POOL_H
+#define MABE_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "emp/base/assert.hpp"
+#include "emp/base/vector.hpp"
+
+namespace mabe {
+
+  class ThreadPool {
+  private:
+    using job_fun_t = std::function<void(size_t)>;
+
+    emp::vector<std::thread> helpers;      ///< Helper threads (the caller is the final worker)
+    std::mutex job_mutex;                  ///< Protects all job information below.
+    std::condition_variable start_cv;      ///< Wakes helpers when a new job is posted.
+    std::condition_variable done_cv;       ///< Wakes the caller when all helpers finish.
+    job_fun_t job_fun;                     ///< Function to run on each index.
+    size_t job_size = 0;                   ///< Number of indices in the current job.
+    std::atomic<size_t> next_index{0};     ///< Next index to be handed out.
+    size_t busy_helpers = 0;               ///< Helpers still working on the current job.
+    size_t job_count = 0;                  ///< Number of jobs posted (lets helpers spot new ones)
+    bool stop = false;                     ///< Should helper threads exit?
+
+    void RunJob() {
+      for (size_t id = next_index++; id < job_size; id = next_index++) job_fun(id);
+    }
+
+    /// Run jobs posted after the first jobs_seen; stop when requested.
+    void HelperLoop(size_t jobs_seen) {
+      std::unique_lock<std::mutex> lock(job_mutex);
+      while (true) {
+        start_cv.wait(lock, [this,jobs_seen](){ return stop || job_count != jobs_seen; });
+        if (stop) return;
+        jobs_seen = job_count;
+
+        lock.unlock();
+        RunJob();
+        lock.lock();
+
+        if (--busy_helpers == 0) done_cv.notify_all();
+      }
+    }
+
+    void StopHelpers() {
+      {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        stop = true;
+      }
+      start_cv.notify_all();
+      for (std::thread & helper : helpers) helper.join();
+      helpers.resize(0);
+      stop = false;
+    }
+
+  public:
+    ThreadPool(size_t num_threads=1) { Resize(num_threads); }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+    ~ThreadPool() { StopHelpers(); }
+
+    /// How many threads (including the caller) will work on each job?
+    size_t GetNumThreads() const { return helpers.size() + 1; }
+
+    /// Change the number of threads; zero means use all available hardware threads.
+    void Resize(size_t num_threads) {
+      if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+      if (num_threads == GetNumThreads()) return;
+      StopHelpers();
+      // New helpers must skip all jobs posted before they existed.
+      std::lock_guard<std::mutex> lock(job_mutex);
+      for (size_t i = 1; i < num_threads; i++) {
+        helpers.emplace_back([this, jobs_seen=job_count](){ HelperLoop(jobs_seen); });
+      }
+    }
+
+    /// Call fun(i) for every i in [0, count), spread across all threads; returns when done.
+    void ParallelFor(size_t count, const job_fun_t & fun) {
+      // Run small jobs (or any job without helpers) directly.
+      if (helpers.size() == 0 || count < 2) {
+        for (size_t i = 0; i < count; i++) fun(i);
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        emp_assert(busy_helpers == 0, "ThreadPool::ParallelFor() cannot be nested.");
+        job_fun = fun;
+        job_size = count;
+        next_index = 0;
+        busy_helpers = helpers.size();
+        job_count++;
+      }
+      start_cv.notify_all();
+
+      RunJob();  // The calling thread works too.
+
+      std::unique_lock<std::mutex> lock(job_mutex);
+      done_cv.wait(lock, [this](){ return busy_helpers == 0; });
+      job_fun = nullptr;
+    }
+
+    /// Split [0, count) into contiguous chunks (one or more per thread) and call
+    /// fun(chunk_id, start, end) on each.  Returns the number of chunks used.
+    size_t ParallelChunks(size_t count, size_t min_chunk_size,
+                          const std::function<void(size_t, size_t, size_t)> & fun) {
+      if (min_chunk_size == 0) min_chunk_size = 1;
+      size_t num_chunks = std::min(GetNumThreads() * 4, (count + min_chunk_size - 1) / min_chunk_size);
+      if (num_chunks == 0) num_chunks = 1;
+      const size_t chunk_size = (count + num_chunks - 1) / num_chunks;
+      ParallelFor(num_chunks, [&fun, count, chunk_size](size_t chunk_id){
+        const size_t start = chunk_id * chunk_size;
+        const size_t end = std::min(count, start + chunk_size);
+        if (start < end) fun(chunk_id, start, end);
+      });
+      return num_chunks;
+    }
+  };
+
+}
+
+#endif